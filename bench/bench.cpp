@@ -0,0 +1,1213 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "crud.h"
+#include "exporter.h"
+#include "files.h"
+#include "flight_calendar.h"
+#include "importer.h"
+#include "journal.h"
+#include "parallel.h"
+#include "replication.h"
+#include "snapshot.h"
+#include "state.h"
+
+using namespace std;
+
+/**
+ * Benchmarks for the airline data layer.
+ * Usage: airline_bench <benchmark> [scale]
+ */
+
+using Clock = chrono::steady_clock;
+
+double millisecondsSince(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+/**
+ * @brief Fills the `data` namespace with a reproducible synthetic dataset
+ * @param scale The number of planes; every plane gets 20 flights with 150 tickets each
+ */
+void generateDataset(unsigned int scale) {
+    files::clear();
+    mt19937 random(42);
+
+    for (unsigned int i = 0; i < 50; i++) {
+        ostringstream name;
+        name << "Airport " << setw(3) << setfill('0') << i;
+
+        Airport *airport = new Airport(name.str());
+        airport->addTransportPlaceInfo(TransportPlace { "Central Station", 41.1f, -8.6f, TransportType::TRAIN, 2.5f, { Time(8, 0), Time(12, 30) } });
+        data::airports.push_back(airport);
+    }
+
+    for (unsigned int i = 0; i < scale; i++) {
+        ostringstream plate;
+        plate << "PL-" << setw(6) << setfill('0') << i;
+
+        Plane *plane = new Plane(plate.str(), "Airbus A320", 180);
+        plane->scheduleService(*new Service(ServiceType::CLEANING, Datetime(2022, 1, 1 + i % 28, 6, 0), "Jane Doe", *plane));
+        data::planes.push_back(plane);
+
+        for (unsigned int j = 0; j < 20; j++) {
+            size_t origin_index = random() % data::airports.size();
+            size_t destination_index = (origin_index + 1 + random() % (data::airports.size() - 1)) % data::airports.size();
+
+            Airport &origin = *data::airports[origin_index];
+            Airport &destination = *data::airports[destination_index];
+
+            ostringstream id;
+            id << "TP" << setw(4) << setfill('0') << (i * 20 + j) % 10000;
+
+            Flight *flight = new Flight(id.str(), Datetime(2022, 1 + j % 12, 1 + i % 28, j % 24, (i * 7) % 60), Time(2, 15), origin, destination, *plane);
+            for (unsigned int k = 0; k < 150; k++) {
+                Ticket *ticket = new Ticket(*flight, "Passenger " + to_string(k), 18 + random() % 60, k);
+                flight->addTicket(*ticket);
+
+                if (k % 3 == 0)
+                    flight->addLuggage(*new Luggage(*ticket, 10 + random() % 20));
+            }
+
+            plane->addFlight(*flight);
+            data::flights.push_back(flight);
+        }
+    }
+
+    HandlingCar *car = new HandlingCar(4, 4, 10);
+    car->setFlight(*data::flights.front());
+    for (Ticket *ticket : data::flights.front()->getTickets())
+        car->addLuggage(*new Luggage(*ticket, 15));
+
+    data::handlingCars.push_back(car);
+}
+
+string readWholeFile(const string &path) {
+    ifstream file(path);
+    ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+/**
+ * @brief Compares the time it takes to load the same dataset from the text format and from the binary snapshot
+ */
+void benchmarkLoad(unsigned int scale) {
+    generateDataset(scale);
+    cout << "Dataset: " << data::planes.size() << " planes, " << data::flights.size() << " flights, "
+         << data::flights.size() * 150 << " tickets\n" << endl;
+
+    files::writeText("bench_data.txt");
+    snapshot::write("bench_data.bin");
+
+    files::load_stats = files::LoadStats();
+    auto start = Clock::now();
+    files::readText("bench_data.txt");
+    double text_time = millisecondsSince(start);
+    files::LoadStats text_stats = files::load_stats;
+    files::writeText("bench_from_text.txt");
+
+    files::clear();
+    files::load_stats = files::LoadStats();
+    start = Clock::now();
+    snapshot::read("bench_data.bin");
+    double snapshot_time = millisecondsSince(start);
+    files::LoadStats snapshot_stats = files::load_stats;
+
+    // The snapshot leaves tickets and luggage to be loaded when their flight is first used
+    start = Clock::now();
+    for (const Flight *flight : data::flights)
+        flight->getLuggage();
+    double passenger_time = millisecondsSince(start);
+
+    files::writeText("bench_from_snapshot.txt");
+
+    cout << fixed << setprecision(1)
+         << "Text load:     " << text_time << " ms\n"
+         << "Snapshot load: " << snapshot_time << " ms\n"
+         << "Speedup:       " << text_time / snapshot_time << "x\n"
+         << "Every flight's passengers, loaded afterwards: " << passenger_time << " ms\n"
+         << "Same state:    " << (readWholeFile("bench_from_text.txt") == readWholeFile("bench_from_snapshot.txt") ? "yes" : "NO") << "\n\n";
+
+    cout << "Phase           Text      Snapshot\n";
+    auto printPhase = [&](const char *name, double files::LoadStats::*phase) {
+        cout << left << setw(16) << name << right << setw(6) << text_stats.*phase << " ms" << setw(8) << snapshot_stats.*phase << " ms\n";
+    };
+
+    printPhase("Mapping", &files::LoadStats::mapping);
+    printPhase("Verification", &files::LoadStats::verification);
+    printPhase("Airports", &files::LoadStats::airports);
+    printPhase("Planes", &files::LoadStats::planes);
+    printPhase("Flights", &files::LoadStats::flights);
+    printPhase("Handling cars", &files::LoadStats::handling_cars);
+    printPhase("Indexing", &files::LoadStats::indexing);
+    cout << endl;
+
+    for (const char *path : { "bench_data.txt", "bench_data.bin", "bench_from_text.txt", "bench_from_snapshot.txt" })
+        remove(path);
+}
+
+/**
+ * @brief Measures the time it takes to save the same dataset in the text format and in the binary snapshot
+ */
+void benchmarkSave(unsigned int scale) {
+    generateDataset(scale);
+
+    // Fills every handling car, so that the car luggage is a sizeable part of the save
+    for (unsigned int i = 0; i < 20; i++) {
+        HandlingCar *car = new HandlingCar(10, 10, 10);
+        Flight *flight = data::flights[i * data::flights.size() / 20];
+        car->setFlight(*flight);
+
+        for (Ticket *ticket : flight->getTickets())
+            car->addLuggage(*new Luggage(*ticket, 20));
+
+        data::handlingCars.push_back(car);
+    }
+
+    cout << "Dataset: " << data::planes.size() << " planes, " << data::flights.size() << " flights, "
+         << data::handlingCars.size() << " handling cars\n" << endl;
+
+    auto start = Clock::now();
+    files::writeText("bench_data.txt");
+    double text_time = millisecondsSince(start);
+
+    start = Clock::now();
+    snapshot::write("bench_data.bin");
+    double snapshot_time = millisecondsSince(start);
+
+    cout << fixed << setprecision(1)
+         << "Text save:     " << text_time << " ms\n"
+         << "Snapshot save: " << snapshot_time << " ms" << endl;
+
+    for (const char *path : { "bench_data.txt", "bench_data.bin" })
+        remove(path);
+}
+
+/**
+ * @brief Measures how the snapshot load scales with the number of threads
+ */
+void benchmarkThreads(unsigned int scale) {
+    generateDataset(scale);
+    snapshot::write("bench_data.bin");
+
+    cout << "Dataset: " << data::planes.size() << " planes, " << data::flights.size() << " flights\n"
+         << "Hardware threads: " << thread::hardware_concurrency() << '\n' << endl;
+
+    double single_thread_time = 0;
+    for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+        parallel::setThreadCount(threads);
+
+        files::clear();
+        auto start = Clock::now();
+        snapshot::read("bench_data.bin");
+        double time = millisecondsSince(start);
+
+        if (threads == 1)
+            single_thread_time = time;
+
+        cout << fixed << setprecision(1)
+             << setw(2) << threads << " threads: " << setw(7) << time << " ms  (" << single_thread_time / time << "x)\n";
+    }
+
+    parallel::setThreadCount(0);
+    remove("bench_data.bin");
+}
+
+/**
+ * @brief Counts the flights, tickets and luggage in the `data` namespace
+ */
+string countRecords() {
+    size_t tickets = 0, luggage = 0;
+    for (const Flight *flight : data::flights) {
+        tickets += flight->getTickets().size();
+        luggage += flight->getLuggage().size();
+    }
+
+    ostringstream counts;
+    counts << data::airports.size() << " airports, " << data::planes.size() << " planes, " << data::flights.size() << " flights, "
+           << tickets << " tickets, " << luggage << " pieces of luggage";
+    return counts.str();
+}
+
+/**
+ * @brief Measures the rows per second of the CSV importer, on a feed made from the synthetic dataset
+ */
+void benchmarkImport(unsigned int scale) {
+    generateDataset(scale);
+    string expected = countRecords();
+
+    mkdir("bench_feed", 0755);
+    ofstream airports("bench_feed/airports.csv"), planes("bench_feed/planes.csv"), flights("bench_feed/flights.csv"),
+             tickets("bench_feed/tickets.csv"), luggage("bench_feed/luggage.csv");
+
+    airports << "name\n";
+    for (const Airport *airport : data::airports)
+        airports << airport->getName() << '\n';
+
+    planes << "license_plate,type,capacity\n";
+    flights << "flight_id,departure_time,duration,origin,destination,license_plate\n";
+    tickets << "flight_id,departure_time,customer_name,customer_age,seat_number\n";
+    luggage << "flight_id,departure_time,seat_number,weight\n";
+    size_t rows = data::airports.size() + data::planes.size() + data::flights.size();
+
+    for (const Plane *plane : data::planes)
+        planes << plane->getLicensePlate() << ',' << plane->getType() << ',' << plane->getCapacity() << '\n';
+
+    for (Flight *flight : data::flights) {
+        string key = flight->getFlightId() + ',' + flight->getDepartureTime().str();
+        flights << key << ',' << flight->getDuration().str() << ',' << flight->getOrigin().getName() << ','
+                << flight->getDestination().getName() << ',' << flight->getPlane().getLicensePlate() << '\n';
+
+        for (const Ticket *ticket : flight->getTickets())
+            tickets << key << ',' << ticket->getCustomerName() << ',' << ticket->getCustomerAge() << ',' << ticket->getSeatNumber() << '\n';
+
+        for (Luggage *piece : flight->getLuggage())
+            luggage << key << ',' << piece->getTicket().getSeatNumber() << ',' << piece->getWeight() << '\n';
+
+        rows += flight->getTickets().size() + flight->getLuggage().size();
+    }
+
+    for (ofstream *file : { &airports, &planes, &flights, &tickets, &luggage })
+        file->close();
+
+    cout << "Feed: " << expected << "\n"
+         << "Hardware threads: " << thread::hardware_concurrency() << '\n' << endl;
+
+    string imported;
+    for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+        parallel::setThreadCount(threads);
+        files::clear();
+
+        auto start = Clock::now();
+        importer::importCsv(importer::findCsvSources("bench_feed"));
+        double time = millisecondsSince(start);
+        imported = countRecords();
+
+        cout << fixed << setprecision(1)
+             << setw(2) << threads << " threads: " << setw(7) << time << " ms  (" << setprecision(2) << rows / time / 1000 << " million rows/s)\n";
+    }
+
+    cout << "Same records: " << (imported == expected ? "yes" : "NO") << endl;
+
+    parallel::setThreadCount(0);
+    for (const char *path : { "bench_feed/airports.csv", "bench_feed/planes.csv", "bench_feed/flights.csv", "bench_feed/tickets.csv",
+                              "bench_feed/luggage.csv", "bench_feed" })
+        remove(path);
+}
+
+/**
+ * @brief Writes a synthetic dataset in the OpenFlights format, shaped like the real one: 10k airports and 60k routes,
+ * most of them between a few hundred hubs
+ */
+void generateOpenFlights(const string &directory) {
+    mkdir(directory.c_str(), 0755);
+    mt19937 random(42);
+
+    ofstream airports(directory + "/airports.dat");
+    vector<string> codes;
+    for (unsigned int i = 0; i < 10000; i++) {
+        string code = { char('A' + i / 676 % 26), char('A' + i / 26 % 26), char('A' + i % 26) };
+        codes.push_back(code);
+
+        airports << i + 1 << ",\"Airport " << code << "\",\"City " << i << "\",\"Country " << i % 200 << "\",\"" << code << "\",\"K" << code
+                 << "\"," << int(random() % 140) - 60 << '.' << random() % 1000 << ',' << int(random() % 360) - 180 << '.' << random() % 1000
+                 << ",100,0,\"E\",\"Etc/UTC\",\"airport\",\"OurAirports\"\n";
+    }
+
+    ofstream routes(directory + "/routes.dat");
+    const char *types[] = { "320", "738", "73H", "321", "E90", "AT7", "77W", "788" };
+    for (unsigned int i = 0; i < 60000; i++) {
+        unsigned int origin = random() % 4 == 0 ? random() % 10000 : random() % 300;
+        unsigned int destination = random() % 4 == 0 ? random() % 10000 : random() % 300;
+        string airline = { char('A' + random() % 26), char('A' + random() % 26) };
+
+        routes << airline << ",1," << codes[origin] << ',' << origin + 1 << ',' << codes[destination] << ',' << destination + 1
+               << ',' << (random() % 10 == 0 ? "Y" : "") << ",0," << types[random() % 8] << ' ' << types[random() % 8] << '\n';
+    }
+
+    ofstream planes(directory + "/planes.dat");
+    planes << "\"Airbus A320\",\"320\",\"A320\"\n\"Boeing 737-800\",\"738\",\"B738\"\n\"Airbus A321\",\"321\",\"A321\"\n"
+           << "\"Boeing 777-300ER\",\"77W\",\"B77W\"\n\"Boeing 787-8\",\"788\",\"B788\"\n";
+}
+
+/**
+ * @brief Imports the OpenFlights dataset and measures the snapshot on the result. A copy of the real dataset is used
+ * if there is one in ./openflights, and a synthetic one of the same shape otherwise.
+ * @param scale The number of days of flights of every route
+ */
+void benchmarkOpenFlights(unsigned int scale) {
+    string directory = "openflights";
+    bool is_synthetic = !ifstream(directory + "/routes.dat").is_open();
+    if (is_synthetic) {
+        directory = "bench_openflights";
+        generateOpenFlights(directory);
+    }
+
+    files::clear();
+    importer::OpenFlightsOptions options;
+    options.days = scale;
+
+    auto start = Clock::now();
+    importer::ImportResult result = importer::importOpenFlights(importer::findOpenFlightsSources(directory), options);
+    double import_time = millisecondsSince(start);
+
+    start = Clock::now();
+    snapshot::write("bench_data.bin");
+    double save_time = millisecondsSince(start);
+
+    files::clear();
+    start = Clock::now();
+    snapshot::read("bench_data.bin");
+    double load_time = millisecondsSince(start);
+
+    struct stat info;
+    stat("bench_data.bin", &info);
+
+    cout << (is_synthetic ? "Synthetic" : "Real") << " OpenFlights dataset, " << scale << " days of flights\n"
+         << result.airports << " airports, " << result.planes << " routes, " << result.flights << " flights, "
+         << result.skipped << " routes skipped\n\n"
+         << fixed << setprecision(1)
+         << "Import:        " << import_time << " ms\n"
+         << "Snapshot save: " << save_time << " ms\n"
+         << "Snapshot load: " << load_time << " ms\n"
+         << "Snapshot size: " << info.st_size / double(1 << 20) << " MiB" << endl;
+
+    remove("bench_data.bin");
+    if (is_synthetic) {
+        for (const char *name : { "/airports.dat", "/routes.dat", "/planes.dat", "" })
+            remove((directory + name).c_str());
+    }
+}
+
+/**
+ * @brief Reads a memory figure of this process, such as RssAnon, from /proc/self/status
+ * @return The figure in KiB, or 0 if it isn't available
+ */
+size_t readMemoryKiB(const string &field) {
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line)) {
+        if (line.compare(0, field.size() + 1, field + ":") == 0)
+            return stoul(line.substr(field.size() + 1));
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Measures the JSON lines export of every ticket of a snapshot, and the memory it takes while the passengers stay unloaded
+ */
+void benchmarkExport(unsigned int scale) {
+    generateDataset(scale);
+    snapshot::write("bench_data.bin");
+    files::clear();
+    snapshot::read("bench_data.bin");
+
+    // Flights whose luggage is on a handling car are loaded with the snapshot
+    auto countLoaded = []() {
+        size_t loaded = 0;
+        for (const Flight *flight : data::flights)
+            loaded += flight->hasPassengersLoaded();
+
+        return loaded;
+    };
+
+    size_t loaded_before = countLoaded();
+    // The pages of the mapped snapshot are left out, since the kernel can drop them whenever it needs to
+    size_t heap_before = readMemoryKiB("RssAnon");
+    auto start = Clock::now();
+    size_t tickets = exporter::exportTickets("bench_tickets.jsonl", data::flights);
+    double ticket_time = millisecondsSince(start);
+    size_t heap_after = readMemoryKiB("RssAnon");
+
+    start = Clock::now();
+    size_t flights = exporter::exportRecords("bench_flights.jsonl", data::flights);
+    double flight_time = millisecondsSince(start);
+
+    struct stat info;
+    stat("bench_tickets.jsonl", &info);
+
+    cout << fixed << setprecision(1)
+         << "Tickets: " << tickets << " in " << ticket_time << " ms, " << tickets / ticket_time / 1000 << "M records/s, "
+         << info.st_size / ticket_time / 1000 << " MB/s\n"
+         << "Flights: " << flights << " in " << flight_time << " ms\n"
+         << "Heap memory: " << heap_before / 1024.0 << " MiB before, " << heap_after / 1024.0 << " MiB after\n"
+         << "Flights with their passengers loaded: " << loaded_before << " before, " << countLoaded() << " after, of "
+         << data::flights.size() << endl;
+
+    for (const char *path : { "bench_data.bin", "bench_tickets.jsonl", "bench_flights.jsonl" })
+        remove(path);
+}
+
+/**
+ * @brief Drops a file from the page cache, so that reading it again has to go to the disk
+ */
+void evictFromPageCache(const string &path) {
+    int file = open(path.c_str(), O_RDONLY);
+    fdatasync(file);
+    posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED);
+    close(file);
+}
+
+/**
+ * @brief Measures reading single flights through the snapshot's flight index, against loading the whole snapshot
+ */
+void benchmarkLookup(unsigned int scale) {
+    generateDataset(scale);
+
+    struct Sample {
+        string flight_id;
+        Datetime departure_time;
+        size_t ticket_count;
+    };
+
+    mt19937 random(7);
+    vector<Sample> samples;
+    for (unsigned int i = 0; i < 20; i++) {
+        const Flight *flight = data::flights[random() % data::flights.size()];
+        samples.push_back(Sample { flight->getFlightId(), flight->getDepartureTime(), flight->getTickets().size() });
+    }
+
+    size_t ticket_count = 0;
+    for (const Flight *flight : data::flights)
+        ticket_count += flight->getTickets().size();
+
+    snapshot::write("bench_data.bin");
+    files::clear();
+
+    // The first lookup of the process also pays for setting it up, such as faulting in the code
+    snapshot::findFlight("bench_data.bin", samples.front().flight_id, samples.front().departure_time);
+
+    double cold_total = 0, cold_max = 0, warm_total = 0;
+    bool is_correct = true;
+    for (const Sample &sample : samples) {
+        evictFromPageCache("bench_data.bin");
+        auto start = Clock::now();
+        optional<snapshot::FlightManifest> manifest = snapshot::findFlight("bench_data.bin", sample.flight_id, sample.departure_time);
+        double time = millisecondsSince(start);
+
+        cold_total += time;
+        cold_max = max(cold_max, time);
+        is_correct = is_correct && manifest && manifest->flight->getFlightId() == sample.flight_id && manifest->tickets.size() == sample.ticket_count;
+
+        start = Clock::now();
+        snapshot::findFlight("bench_data.bin", sample.flight_id, sample.departure_time);
+        warm_total += millisecondsSince(start);
+    }
+
+    evictFromPageCache("bench_data.bin");
+    auto start = Clock::now();
+    snapshot::read("bench_data.bin");
+    for (const Flight *flight : data::flights) {
+        if (flight->getFlightId() == samples.front().flight_id && flight->getDepartureTime() == samples.front().departure_time)
+            flight->getTickets();
+    }
+    double load_time = millisecondsSince(start);
+
+    struct stat info;
+    stat("bench_data.bin", &info);
+
+    cout << "Snapshot: " << data::flights.size() << " flights, " << ticket_count << " tickets, " << fixed << setprecision(1)
+         << info.st_size / double(1 << 20) << " MiB\n\n"
+         << setprecision(2)
+         << "Cold point lookup: " << cold_total / samples.size() << " ms on average, " << cold_max << " ms at most\n"
+         << "Warm point lookup: " << warm_total / samples.size() << " ms on average\n"
+         << "Cold full load, then the same flight: " << load_time << " ms\n"
+         << "Every lookup found its flight and tickets: " << (is_correct ? "yes" : "NO") << endl;
+
+    remove("bench_data.bin");
+}
+
+/**
+ * @brief Measures durable bookings per second, where every booking waits until the journal holding it is on the disk
+ * @param scale The number of planes of the dataset, whose free seats are booked
+ */
+void benchmarkBooking(unsigned int scale) {
+    generateDataset(scale);
+    journal::removeBefore(UINT64_MAX);
+    journal::open(0);
+
+    vector<pair<Flight*, unsigned int>> free_seats;
+    for (Flight *flight : data::flights) {
+        for (unsigned int seat = flight->getTickets().size(); seat < flight->getPlane().getCapacity(); seat++)
+            free_seats.emplace_back(flight, seat);
+    }
+
+    // Every run books its own share of the free seats, so no run is left without seats
+    constexpr unsigned int RUNS = 10;
+    size_t next_seat = 0;
+
+    // Books seats on several threads, and returns how many were booked per second
+    auto run = [&](unsigned int threads, mutex *serializer) {
+        size_t first = next_seat, last = next_seat + free_seats.size() / RUNS;
+        atomic<size_t> next = first;
+        next_seat = last;
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.emplace_back([&]() {
+                for (size_t index = next++; index < last; index = next++) {
+                    auto [flight, seat] = free_seats[index];
+                    if (serializer != nullptr) {
+                        lock_guard<mutex> lock(*serializer);
+                        crud::bookTicket(*flight, "Jane Doe", 30, seat);
+                    } else {
+                        crud::bookTicket(*flight, "Jane Doe", 30, seat);
+                    }
+                }
+            });
+        }
+
+        for (thread &worker : workers)
+            worker.join();
+
+        return (last - first) / millisecondsSince(start) * 1000;
+    };
+
+    mutex serializer;
+    cout << "Free seats: " << free_seats.size() << " on " << data::flights.size() << " flights\n\n" << fixed << setprecision(0);
+    for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+        double one_flush_each = run(threads, &serializer);
+        double shared_flushes = run(threads, nullptr);
+
+        cout << setw(2) << threads << " threads: " << setw(6) << shared_flushes << " bookings/s with shared flushes, "
+             << setw(6) << one_flush_each << " with one flush per booking\n";
+    }
+
+    cout << "Seats booked: " << next_seat << " of " << free_seats.size() << endl;
+
+    journal::close();
+    journal::removeBefore(UINT64_MAX);
+}
+
+/**
+ * @brief Measures how fast a standby process applies the bookings made on the primary, and how far behind it stays
+ * @param scale The number of planes of the dataset, whose free seats are booked
+ */
+void benchmarkReplication(unsigned int scale) {
+    const string standby_directory = "bench_standby";
+    const string socket_path = "bench_replication.sock";
+    filesystem::create_directory(standby_directory);
+
+    // The standby is forked before anything else runs, and starts from an empty directory
+    pid_t standby = fork();
+    if (standby == 0) {
+        if (chdir(standby_directory.c_str()) != 0)
+            _exit(1);
+
+        remove(files::getSnapshotPath().c_str());
+        journal::removeBefore(UINT64_MAX);
+        files::read();
+
+        replication::runStandby("../" + socket_path, nullptr);
+        replication::StandbyStats stats = replication::getStandbyStats();
+        cout << fixed << setprecision(1)
+             << "Standby: " << stats.records << " records applied in " << stats.apply_time << " ms, "
+             << stats.records / stats.apply_time * 1000 << " records/s, " << stats.snapshots << " snapshots received" << endl;
+
+        files::writeText("standby.txt");
+        files::close();
+        _exit(0);
+    }
+
+    generateDataset(scale);
+    remove(files::getSnapshotPath().c_str());
+    journal::removeBefore(UINT64_MAX);
+    journal::open(0);
+    files::write();
+    files::read();
+
+    replication::startPrimary(socket_path);
+
+    vector<pair<Flight*, unsigned int>> free_seats;
+    for (Flight *flight : data::flights) {
+        for (unsigned int seat = flight->getTickets().size(); seat < flight->getPlane().getCapacity(); seat++)
+            free_seats.emplace_back(flight, seat);
+    }
+
+    // Waits until the standby has applied everything written so far
+    auto waitForStandby = [&]() {
+        auto start = Clock::now();
+        while (replication::getPrimaryStats().snapshots == 0 || replication::getPrimaryStats().bytes_behind != 0)
+            this_thread::sleep_for(chrono::milliseconds(1));
+
+        return millisecondsSince(start);
+    };
+
+    auto book = [&](size_t first, size_t last, unsigned int threads) {
+        atomic<size_t> next = first;
+        double max_lag = 0;
+        atomic<bool> is_booking = true;
+
+        thread sampler([&]() {
+            while (is_booking) {
+                max_lag = max(max_lag, replication::getPrimaryStats().lag);
+                this_thread::sleep_for(chrono::milliseconds(5));
+            }
+        });
+
+        auto start = Clock::now();
+        vector<thread> workers;
+        for (unsigned int i = 0; i < threads; i++) {
+            workers.emplace_back([&]() {
+                for (size_t index = next++; index < last; index = next++)
+                    crud::bookTicket(*free_seats[index].first, "Jane Doe", 30, free_seats[index].second);
+            });
+        }
+
+        for (thread &worker : workers)
+            worker.join();
+
+        double booking_time = millisecondsSince(start);
+        double catch_up_time = waitForStandby();
+        is_booking = false;
+        sampler.join();
+
+        cout << fixed << setprecision(1)
+             << (last - first) << " bookings on " << threads << " threads: " << (last - first) / booking_time * 1000 << " bookings/s, "
+             << "standby caught up " << catch_up_time << " ms after the last one, lag up to " << max_lag << " ms\n";
+    };
+
+    waitForStandby();
+    cout << "Free seats: " << free_seats.size() << " on " << data::flights.size() << " flights\n\n";
+
+    size_t half = free_seats.size() / 2;
+    book(0, half / 2, 1);
+    book(half / 2, half, 8);
+
+    // A save rotates the journal, and the standby is sent the new snapshot
+    auto start = Clock::now();
+    files::write();
+    while (replication::getPrimaryStats().snapshots < 2)
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    waitForStandby();
+    cout << "Standby caught up with a save in " << millisecondsSince(start) << " ms\n";
+    book(half, free_seats.size(), 8);
+
+    kill(standby, SIGUSR1);
+    waitpid(standby, nullptr, 0);
+
+    replication::PrimaryStats stats = replication::getPrimaryStats();
+    cout << "Primary: " << stats.shipped_bytes << " bytes shipped, " << stats.acknowledged_bytes << " acknowledged\n";
+
+    files::writeText("bench_primary.txt");
+    cout << "Same state: " << (readWholeFile("bench_primary.txt") == readWholeFile(standby_directory + "/standby.txt") ? "yes" : "no") << endl;
+
+    replication::stopPrimary();
+    journal::close();
+    journal::removeBefore(UINT64_MAX);
+    remove(files::getSnapshotPath().c_str());
+    remove("bench_primary.txt");
+    filesystem::remove_all(standby_directory);
+}
+
+/**
+ * @brief Moves a flight to another plane, which creates it again along with its tickets
+ * @return The flight on the new plane
+ */
+Flight *moveFlight(Flight &flight, Plane &plane) {
+    Flight *moved = new Flight(flight.getFlightId(), flight.getDepartureTime(), flight.getDuration(), flight.getOrigin(), flight.getDestination(), plane);
+    for (Ticket *ticket : flight.getTickets())
+        moved->addTicket(*new Ticket(*moved, ticket->getCustomerName(), ticket->getCustomerAge(), ticket->getSeatNumber()));
+
+    crud::deleteFlight(flight);
+    crud::insertFlight(*moved);
+    return moved;
+}
+
+/**
+ * @brief Makes about 1% of the records of the synthetic dataset differ, touching every kind of change a patch can make
+ */
+void changeDataset(mt19937 &random) {
+    size_t changed = data::flights.size() / 100 + 1;
+
+    // Tickets are renamed, cancelled and sold, and bags are checked in
+    for (size_t i = 0; i < changed; i++) {
+        Flight &flight = *data::flights[random() % data::flights.size()];
+        flight.getTickets()[random() % flight.getTickets().size()]->setCustomerName("Renamed Passenger");
+
+        // Every third seat has luggage, which stays with its ticket
+        Ticket *cancelled = crud::findTicketsBySeatNumber(flight, 1 + 3 * (random() % 49));
+        if (cancelled != nullptr) {
+            flight.removeTicket(*cancelled);
+            delete cancelled;
+        }
+
+        unsigned int seat = 150 + random() % 30;
+        if (crud::findTicketsBySeatNumber(flight, seat) == nullptr)
+            flight.addTicket(*new Ticket(flight, "New Passenger", 30, seat));
+
+        flight.addLuggage(*new Luggage(*flight.getTickets().front(), 7));
+    }
+
+    // Flights are cancelled, delayed and moved to another plane
+    for (size_t i = 0; i < changed / 10 + 1; i++) {
+        crud::deleteFlight(*data::flights[random() % data::flights.size()]);
+
+        Time duration(3, 5);
+        data::flights[random() % data::flights.size()]->setDuration(duration);
+
+        Flight &flight = *data::flights[random() % data::flights.size()];
+        Plane &plane = *data::planes[random() % data::planes.size()];
+        if (&plane != &flight.getPlane())
+            moveFlight(flight, plane);
+    }
+
+    // Planes are bought, sold, resized and serviced
+    for (unsigned int i = 0; i < 5; i++) {
+        Plane *plane = new Plane("PL-9" + to_string(10000 + i), "Boeing 737", 160);
+        crud::insertPlane(*plane);
+
+        Flight *flight = new Flight("NEW" + to_string(i), Datetime(2022, 6, 1, 12, 0), Time(1, 0), *data::airports[0], *data::airports[1], *plane);
+        crud::insertFlight(*flight);
+        for (unsigned int seat = 0; seat < 10; seat++)
+            flight->addTicket(*new Ticket(*flight, "Passenger " + to_string(seat), 40, seat));
+    }
+
+    crud::deletePlane(*data::planes[random() % data::planes.size()]);
+    data::planes[random() % data::planes.size()]->setCapacity(200);
+    data::planes[random() % data::planes.size()]->completeService();
+
+    // Airports get new transport places, and the last one is closed
+    data::airports[random() % 50]->addTransportPlaceInfo(TransportPlace { "Bus Stop", 41.2f, -8.7f, TransportType::BUS, 0.5f, { Time(9, 15) } });
+    crud::insertAirport(*new Airport("Airport 050"));
+    crud::deleteAirport(*data::airports.back());
+
+    // The first handling car is unloaded a little, and the second one is replaced by a bigger one
+    delete data::handlingCars.front()->unloadNextLuggage();
+    crud::deleteCar(*data::handlingCars.back());
+    crud::insertCar(*new HandlingCar(5, 5, 5));
+    data::handlingCars.back()->setFlight(*data::flights.back());
+
+    // The flight of the car in the middle is moved to another plane, and the car is loaded with the same bags again
+    HandlingCar &car = *data::handlingCars[1];
+    if (car.getFlight() != nullptr) {
+        vector<pair<unsigned int, float>> bags;
+        for (const Carriage &carriage : car.getCarriages()) {
+            for (const LuggageStack &stack : carriage) {
+                for (Luggage *bag : stack) {
+                    bags.emplace_back(bag->getTicket().getSeatNumber(), bag->getWeight());
+                    delete bag;
+                }
+            }
+        }
+
+        Flight &flight = *car.getFlight();
+        Plane &plane = **find_if(data::planes.begin(), data::planes.end(), [&flight](const Plane *plane) { return plane != &flight.getPlane(); });
+        Flight *moved = moveFlight(flight, plane);
+
+        car.setFlight(*moved);
+        for (const auto &[seat, weight] : bags)
+            car.addLuggage(*new Luggage(*crud::findTicketsBySeatNumber(*moved, seat), weight));
+    }
+
+    // A plane that no car is waiting for is made smaller, so the tickets of the seats it loses are cancelled along with their bags
+    Plane &smaller = **find_if(data::planes.begin(), data::planes.end(), [](const Plane *plane) {
+        return none_of(data::handlingCars.begin(), data::handlingCars.end(), [plane](const HandlingCar *car) {
+            return car->getFlight() != nullptr && &car->getFlight()->getPlane() == plane;
+        });
+    });
+
+    smaller.setCapacity(140);
+    for (Flight *flight : data::flights) {
+        if (&flight->getPlane() != &smaller)
+            continue;
+
+        vector<Luggage*> luggage = flight->getLuggage();
+        flight->clearLuggage();
+        for (Luggage *piece : luggage) {
+            if (piece->getTicket().getSeatNumber() < smaller.getCapacity())
+                flight->addLuggage(*piece);
+            else
+                delete piece;
+        }
+
+        vector<Ticket*> tickets = flight->getTickets();
+        for (Ticket *ticket : tickets) {
+            if (ticket->getSeatNumber() >= smaller.getCapacity()) {
+                flight->removeTicket(*ticket);
+                delete ticket;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Compares two snapshots of the synthetic dataset that differ in about 1% of their records,
+ * and checks that the patch turns the data of the first into the data of the second
+ */
+void benchmarkDiff(unsigned int scale) {
+    generateDataset(scale);
+
+    // The patch finds flights by key, which only works while they are sorted by id, as they are once loaded
+    stable_sort(data::flights.begin(), data::flights.end(), [](const Flight *a, const Flight *b) {
+        return a->getFlightId() < b->getFlightId();
+    });
+
+    crud::insertAirport(*new Airport("Airport zzz"));
+
+    // This car doesn't change, but the flight it serves is moved to another plane
+    HandlingCar *car = new HandlingCar(4, 4, 4);
+    crud::insertCar(*car);
+    car->setFlight(*data::flights[1]);
+    for (unsigned int seat = 0; seat < 6; seat++)
+        car->addLuggage(*new Luggage(*data::flights[1]->getTickets()[seat], 12));
+
+    crud::insertCar(*new HandlingCar(3, 3, 3));
+    snapshot::write("bench_old.bin");
+
+    mt19937 random(7);
+    changeDataset(random);
+    snapshot::write("bench_new.bin");
+
+    uint64_t entity_count = data::airports.size() + data::planes.size() + data::handlingCars.size();
+    for (const Flight *flight : data::flights)
+        entity_count += 1 + flight->getTicketCount();
+
+    cout << "Entities per snapshot: " << entity_count << '\n';
+
+    files::clear();
+    snapshot::read("bench_new.bin");
+    files::writeText("bench_new.txt");
+    files::clear();
+
+    auto start = Clock::now();
+    snapshot::diff("bench_old.bin", "bench_new.bin");
+    double compare_time = millisecondsSince(start);
+
+    start = Clock::now();
+    snapshot::Difference difference = snapshot::diff("bench_old.bin", "bench_new.bin", "bench.patch");
+    double patch_time = millisecondsSince(start);
+
+    auto printCount = [](const char *name, const snapshot::ChangeCount &count) {
+        cout << "  " << left << setw(15) << name << right << count.added << " added, " << count.removed << " removed, " << count.modified << " modified\n";
+    };
+
+    cout << "Changes:\n";
+    printCount("Airports", difference.airports);
+    printCount("Planes", difference.planes);
+    printCount("Flights", difference.flights);
+    printCount("Tickets", difference.tickets);
+    printCount("Handling cars", difference.handling_cars);
+
+    cout << fixed << setprecision(1)
+         << "Comparison:           " << compare_time << " ms on " << parallel::getThreadCount() << " threads\n"
+         << "Comparison and patch: " << patch_time << " ms, " << difference.patch_records << " records, "
+         << filesystem::file_size("bench.patch") / 1024 << " KiB\n";
+
+    snapshot::read("bench_old.bin");
+    start = Clock::now();
+    importer::applyPatch("bench.patch");
+    cout << "Patch applied in:     " << millisecondsSince(start) << " ms\n";
+
+    files::writeText("bench_patched.txt");
+    cout << "Same state: " << (readWholeFile("bench_patched.txt") == readWholeFile("bench_new.txt") ? "yes" : "NO") << endl;
+
+    for (const char *path : { "bench_old.bin", "bench_new.bin", "bench.patch", "bench_new.txt", "bench_patched.txt" })
+        remove(path);
+}
+
+/**
+ * @brief Measures the operations that order and look up flights by their departure
+ * @param scale The number of flights, in thousands
+ */
+void benchmarkDatetime(unsigned int scale) {
+    struct FlightRow {
+        Datetime departure_time;
+        uint32_t flight;
+    };
+
+    size_t flight_count = size_t(scale) * 1000;
+    mt19937 random(42);
+    vector<FlightRow> rows;
+    rows.reserve(flight_count);
+    for (size_t i = 0; i < flight_count; i++)
+        rows.push_back(FlightRow { Datetime(2015 + random() % 10, 1 + random() % 12, 1 + random() % 28, random() % 24, random() % 60), uint32_t(i) });
+
+    vector<Datetime> probes;
+    for (size_t i = 0; i < 1000000; i++)
+        probes.push_back(rows[random() % rows.size()].departure_time);
+
+    auto start = Clock::now();
+    sort(rows.begin(), rows.end(), [](const FlightRow &a, const FlightRow &b) {
+        return a.departure_time < b.departure_time;
+    });
+    double sort_time = millisecondsSince(start);
+
+    bool is_sorted = true;
+    for (size_t i = 1; i < rows.size(); i++)
+        is_sorted = is_sorted && !(rows[i].departure_time < rows[i - 1].departure_time);
+
+    start = Clock::now();
+    size_t found = 0;
+    for (const Datetime &probe : probes) {
+        auto row = lower_bound(rows.begin(), rows.end(), probe, [](const FlightRow &row, const Datetime &departure_time) {
+            return row.departure_time < departure_time;
+        });
+        found += row != rows.end() && row->departure_time == probe;
+    }
+    double search_time = millisecondsSince(start);
+
+    size_t hashed_count = min<size_t>(rows.size(), 1000000);
+    start = Clock::now();
+    unordered_map<FlightKey, uint32_t, FlightKeyHash> flights_by_key;
+    flights_by_key.reserve(hashed_count);
+    for (size_t i = 0; i < hashed_count; i++)
+        flights_by_key.emplace(FlightKey { "TP1234", rows[i].departure_time }, rows[i].flight);
+    double hash_time = millisecondsSince(start);
+
+    cout << fixed << setprecision(1)
+         << "Sorted " << rows.size() << " flights by departure: " << sort_time << " ms\n"
+         << "Searched " << probes.size() << " departures: " << search_time << " ms\n"
+         << "Hashed " << hashed_count << " flight keys: " << hash_time << " ms, " << flights_by_key.size() << " distinct\n"
+         << "Every departure was found in order: " << (is_sorted && found == probes.size() ? "yes" : "NO") << endl;
+}
+
+/**
+ * @brief Measures the cost of formatting datetimes, as strings and into a buffer
+ * @param scale The number of calls of each kind, in thousands
+ */
+void benchmarkFormat(unsigned int scale) {
+    mt19937 random(42);
+    vector<Datetime> datetimes;
+    for (unsigned int i = 0; i < 1024; i++)
+        datetimes.push_back(Datetime(2015 + random() % 10, 1 + random() % 12, 1 + random() % 28, random() % 24, random() % 60));
+
+    size_t call_count = size_t(scale) * 1000;
+    size_t length = 0;
+
+    auto measure = [&](const function<void(const Datetime&)> &format) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < call_count; i++)
+            format(datetimes[i % datetimes.size()]);
+
+        return millisecondsSince(start) * 1e6 / call_count;
+    };
+
+    double datetime_str = measure([&](const Datetime &datetime) { length += datetime.str().size(); });
+    double datetime_chars = measure([&](const Datetime &datetime) {
+        char text[Datetime::MAX_TEXT_SIZE];
+        length += datetime.toChars(text, text + sizeof(text)).ptr - text;
+    });
+
+    double time_str = measure([&](const Datetime &datetime) { length += Time(datetime).str().size(); });
+    double time_chars = measure([&](const Datetime &datetime) {
+        char text[Time::MAX_TEXT_SIZE];
+        length += Time(datetime).toChars(text, text + sizeof(text)).ptr - text;
+    });
+
+    string expected;
+    for (const Datetime &datetime : datetimes)
+        expected += datetime.str();
+
+    string formatted;
+    for (const Datetime &datetime : datetimes) {
+        char text[Datetime::MAX_TEXT_SIZE];
+        formatted.append(text, datetime.toChars(text, text + sizeof(text)).ptr);
+    }
+
+    cout << fixed << setprecision(1)
+         << "Datetime::str:    " << datetime_str << " ns per call\n"
+         << "Datetime::toChars: " << datetime_chars << " ns per call\n"
+         << "Time::str:        " << time_str << " ns per call\n"
+         << "Time::toChars:     " << time_chars << " ns per call\n"
+         << "Characters written: " << length << "\n"
+         << "Both give the same text: " << (formatted == expected && expected.size() == 16 * datetimes.size() ? "yes" : "NO") << endl;
+}
+
+/**
+ * @brief Measures the cost of parsing datetimes, one at a time and as a column
+ * @param scale The number of datetimes, in thousands
+ */
+void benchmarkParse(unsigned int scale) {
+    mt19937 random(42);
+    size_t count = size_t(scale) * 1000;
+
+    vector<string> texts;
+    for (size_t i = 0; i < count; i++)
+        texts.push_back(Datetime(2015 + random() % 10, 1 + random() % 12, 1 + random() % 28, random() % 24, random() % 60).str());
+
+    vector<string_view> column(texts.begin(), texts.end());
+    // As in a ticket file, where every ticket of a flight repeats its departure
+    vector<string_view> repeated_column;
+    for (size_t i = 0; i < count; i++)
+        repeated_column.push_back(texts[i / 150]);
+
+    auto start = Clock::now();
+    size_t minutes = 0;
+    for (size_t i = 0; i < min<size_t>(count, 1000000); i++)
+        minutes += Datetime::readFromString(texts[i]).getHour();
+    double read_time = millisecondsSince(start) * 1e6 / min<size_t>(count, 1000000);
+
+    start = Clock::now();
+    Datetime datetime(0, 1, 1, 0, 0);
+    bool is_valid = true;
+    for (string_view text : column) {
+        is_valid = is_valid && Datetime::parse(text, datetime) == errc();
+        minutes += datetime.getEpochMinutes();
+    }
+    double parse_time = millisecondsSince(start) * 1e6 / count;
+
+    vector<Datetime> values;
+    start = Clock::now();
+    auto [parsed, error] = Datetime::parseColumn(column, values);
+    double column_time = millisecondsSince(start) * 1e6 / count;
+
+    vector<Datetime> repeated_values;
+    start = Clock::now();
+    Datetime::parseColumn(repeated_column, repeated_values);
+    double repeated_time = millisecondsSince(start) * 1e6 / count;
+
+    bool is_correct = is_valid && parsed == count && error == errc();
+    for (size_t i = 0; i < count && is_correct; i++)
+        is_correct = values[i].str() == texts[i] && repeated_values[i].str() == texts[i / 150];
+
+    cout << fixed << setprecision(1)
+         << "Datetime::readFromString:          " << read_time << " ns per datetime\n"
+         << "Datetime::parse:                   " << parse_time << " ns per datetime\n"
+         << "Datetime::parseColumn:             " << column_time << " ns per datetime\n"
+         << "Datetime::parseColumn, repeated:   " << repeated_time << " ns per datetime\n"
+         << "Checksum: " << minutes << "\n"
+         << "Every datetime was parsed back: " << (is_correct ? "yes" : "NO") << endl;
+}
+
+/**
+ * @brief Compares finding the departures of a time window with the flight calendar and with a scan of every flight,
+ * and checks that the calendar follows flights as they are added, rescheduled and deleted
+ */
+void benchmarkCalendar(unsigned int scale) {
+    generateDataset(scale);
+    mt19937 random(7);
+
+    vector<pair<Datetime, Datetime>> windows;
+    for (unsigned int i = 0; i < 1000; i++) {
+        Datetime begin(2022, 1 + random() % 12, 1 + random() % 28, 6 + random() % 12, 0);
+        windows.emplace_back(begin, begin.plusMinutes(3 * 60));
+    }
+
+    auto scan = [](const Datetime &begin, const Datetime &end) {
+        vector<Flight*> flights;
+        for (Flight *flight : data::flights) {
+            if (!(flight->getDepartureTime() < begin) && flight->getDepartureTime() < end)
+                flights.push_back(flight);
+        }
+
+        return flights;
+    };
+
+    auto start = Clock::now();
+    size_t found = 0;
+    for (const auto &[begin, end] : windows) {
+        string first = begin.str(), last = end.str();
+        for (const Flight *flight : data::flights) {
+            string departure = flight->getDepartureTime().str();
+            found += first <= departure && departure < last;
+        }
+    }
+    double text_scan_time = millisecondsSince(start) * 1000 / windows.size();
+
+    start = Clock::now();
+    for (const auto &[begin, end] : windows)
+        found += scan(begin, end).size();
+    double scan_time = millisecondsSince(start) * 1000 / windows.size();
+
+    start = Clock::now();
+    flight_calendar::findDepartures(windows[0].first, windows[0].second);
+    double build_time = millisecondsSince(start);
+
+    start = Clock::now();
+    for (const auto &[begin, end] : windows)
+        found += flight_calendar::findDepartures(begin, end).size();
+    double calendar_time = millisecondsSince(start) * 1000 / windows.size();
+
+    // Flights are delayed, cancelled and scheduled through crud, which keeps the calendar up to date
+    start = Clock::now();
+    size_t changed = data::flights.size() / 10 + 1;
+    for (size_t i = 0; i < changed; i++) {
+        Flight &flight = *data::flights[random() % data::flights.size()];
+        Datetime departure_time = flight.getDepartureTime().plusMinutes(1 + random() % 300);
+        if (crud::findFlightByKey(flight.getFlightId(), departure_time) == nullptr)
+            crud::rescheduleFlight(flight, departure_time);
+
+        crud::deleteFlight(*data::flights[random() % data::flights.size()]);
+
+        Datetime new_departure_time = windows[random() % windows.size()].first.plusMinutes(random() % 180);
+        crud::insertFlight(*new Flight("NEW" + to_string(i), new_departure_time, Time(1, 30), *data::airports[0], *data::airports[1], *data::planes[0]));
+    }
+    double change_time = millisecondsSince(start) * 1e6 / (3 * changed);
+
+    auto byAddress = [](vector<Flight*> flights) {
+        sort(flights.begin(), flights.end());
+        return flights;
+    };
+
+    bool is_correct = true;
+    for (const auto &[begin, end] : windows) {
+        vector<Flight*> departures = flight_calendar::findDepartures(begin, end);
+        is_correct = is_correct && is_sorted(departures.begin(), departures.end(), [](const Flight *a, const Flight *b) {
+            return a->getDepartureTime() < b->getDepartureTime();
+        });
+        is_correct = is_correct && byAddress(departures) == byAddress(scan(begin, end));
+    }
+
+    cout << fixed << setprecision(1)
+         << "Flights: " << data::flights.size() << ", windows of 3 hours: " << windows.size() << "\n"
+         << "Scan comparing strings:  " << text_scan_time << " us per window\n"
+         << "Scan comparing datetimes: " << scan_time << " us per window\n"
+         << "Calendar:                 " << calendar_time << " us per window, after building it in " << build_time << " ms\n"
+         << "Changes through crud:     " << change_time << " ns per added, rescheduled or deleted flight\n"
+         << "Departures found: " << found << "\n"
+         << "Calendar matches a scan after the changes: " << (is_correct ? "yes" : "NO") << endl;
+}
+
+int main(int argc, char **argv) {
+    map<string, function<void(unsigned int)>> benchmarks = {
+        { "load", benchmarkLoad },
+        { "save", benchmarkSave },
+        { "threads", benchmarkThreads },
+        { "import", benchmarkImport },
+        { "openflights", benchmarkOpenFlights },
+        { "export", benchmarkExport },
+        { "lookup", benchmarkLookup },
+        { "booking", benchmarkBooking },
+        { "replication", benchmarkReplication },
+        { "diff", benchmarkDiff },
+        { "datetime", benchmarkDatetime },
+        { "format", benchmarkFormat },
+        { "parse", benchmarkParse },
+        { "calendar", benchmarkCalendar },
+    };
+
+    if (argc < 2 || benchmarks.count(argv[1]) == 0) {
+        cout << "Usage: " << argv[0] << " <benchmark> [scale]\n\nBenchmarks:\n";
+        for (const auto &benchmark : benchmarks)
+            cout << "  " << benchmark.first << '\n';
+
+        return 1;
+    }
+
+    unsigned int scale = argc > 2 ? atoi(argv[2]) : 100;
+    benchmarks.at(argv[1])(scale);
+    return 0;
+}
@@ -40,7 +40,7 @@ public:
 
     // Getters
 
-    std::set<TransportPlace> getTransportPlaceInfo() const;
+    const std::set<TransportPlace> &getTransportPlaceInfo() const;
     const std::string &getName() const;
 
     // Setters
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "datetime.h"
+#include "flight.h"
+#include "service.h"
+
+/**
+ * Cold storage for departed flights and finished services.
+ *
+ * Old records are moved out of the `data` namespace into `data.archive`, an append-only file made of
+ * compressed blocks. A block only holds flights or only holds services, so the archive can be searched
+ * one block at a time without loading the rest of it.
+ *
+ * Archived flights and services are rebuilt around stand-in planes, which keep the type and capacity the plane
+ * had when they were archived. Their airports are the current ones, or stand-ins if they have since been deleted.
+ */
+namespace archive {
+
+    constexpr char MAGIC[8] = { 'A', 'I', 'R', 'A', 'R', 'C', 'H', '\0' };
+    constexpr std::uint32_t VERSION = 1;
+
+    enum class BlockKind : std::uint32_t {
+        FLIGHTS = 1,
+        SERVICES
+    };
+
+    struct FileHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t reserved;
+    };
+
+    struct BlockHeader {
+        BlockKind kind;
+        std::uint32_t record_count;
+        /** Size of the records once decompressed */
+        std::uint32_t raw_size;
+        std::uint32_t compressed_size;
+    };
+
+    struct ArchiveResult {
+        std::size_t flights = 0;
+        std::size_t services = 0;
+    };
+
+    /**
+     * @brief Appends every flight that departed before the cutoff, and every finished service done before it, to the archive,
+     * then removes them from the `data` namespace.
+     * Flights that a handling car is serving are kept.
+     *
+     * @param cutoff The oldest date and time that is kept in memory
+     * @return How many flights and services were archived
+     *
+     * @throws std::runtime_error if the archive could not be written, in which case nothing is removed
+     */
+    ArchiveResult archiveBefore(const Datetime &cutoff);
+
+    /**
+     * @brief Removes what archiveBefore would archive from the `data` namespace, without writing to the archive.
+     * Used to replay a journal, since the records were archived before the journal recorded it.
+     */
+    void removeBefore(const Datetime &cutoff);
+
+    /**
+     * @brief Calls the visitor with every archived flight, oldest block first.
+     * Only one block is decompressed at a time, and the flights it holds only live during the call.
+     *
+     * @throws std::runtime_error if the archive is malformed
+     */
+    void forEachFlight(const std::function<void(const Flight&)> &visitor);
+
+    /**
+     * @brief Calls the visitor with every archived service, oldest block first.
+     * Only one block is decompressed at a time, and the services it holds only live during the call.
+     *
+     * @throws std::runtime_error if the archive is malformed
+     */
+    void forEachService(const std::function<void(const Service&)> &visitor);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * CRC-32C (Castagnoli) checksums, as used by iSCSI and ext4
+ */
+namespace crc32c {
+
+    /**
+     * @brief Extends a checksum with more data.
+     * Uses the SSE4.2 crc32 instruction when the processor has it, and a lookup table otherwise.
+     *
+     * @param crc The checksum of the data before this one, or 0 to start a new checksum
+     * @param data The data to add
+     * @param size The size of the data, in bytes
+     */
+    std::uint32_t extend(std::uint32_t crc, const void *data, std::size_t size);
+
+    /**
+     * @brief Returns the checksum of the given data
+     */
+    inline std::uint32_t compute(const void *data, std::size_t size) {
+        return extend(0, data, size);
+    }
+
+    /**
+     * @brief Returns whether the hardware implementation is being used
+     */
+    bool isHardwareAccelerated();
+}
@@ -9,13 +9,80 @@
 #include "plane.h"
 #include "ticket.h"
 #include "service.h"
-
-namespace files {
-    void read();
-    void write();
-}
+#include "files.h"
 
 namespace crud {
+    // Lookups
+
+    Plane* findPlaneByLicensePlate(const std::string &license_plate);
+    Flight* findFlightByKey(const std::string &flight_id, const Datetime &departure);
+    Ticket* findTicketsBySeatNumber(Flight &flight, unsigned int seat_number);
+    Airport* findAirportByName(const std::string name);
+    HandlingCar* findCarById(const unsigned &id);
+
+    // Data changes shared by the menus and by the journal replay
+
+    /**
+     * @brief Adds a plane to `data::planes`, keeping it sorted by license plate
+     */
+    void insertPlane(Plane &plane);
+
+    /**
+     * @brief Removes a plane and all of its flights, and frees them
+     */
+    void deletePlane(Plane &plane);
+
+    /**
+     * @brief Adds a flight to `data::flights`, keeping it sorted by flight id, and to its plane
+     */
+    void insertFlight(Flight &flight);
+
+    /**
+     * @brief Changes when a flight departs, keeping the flight calendar up to date
+     */
+    void rescheduleFlight(Flight &flight, Datetime &departure_time);
+
+    /**
+     * @brief Removes a flight from `data::flights`, from its plane and from any handling car serving it, and frees it
+     */
+    void deleteFlight(Flight &flight);
+
+    /**
+     * @brief Adds an airport to `data::airports`, keeping it sorted by name
+     */
+    void insertAirport(Airport &airport);
+
+    /**
+     * @brief Removes an airport from `data::airports` and frees it
+     */
+    void deleteAirport(Airport &airport);
+
+    /**
+     * @brief Adds a handling car to `data::handlingCars`, keeping it sorted by id
+     */
+    void insertCar(HandlingCar &car);
+
+    /**
+     * @brief Removes a handling car from `data::handlingCars` and frees it
+     */
+    void deleteCar(HandlingCar &car);
+
+    /**
+     * @brief Moves every piece of luggage in a handling car into the flight it is serving
+     */
+    void unloadCar(HandlingCar &car);
+
+    /**
+     * @brief Books a seat on a flight and waits until the booking has reached the disk.
+     * Can be called from several threads at once, in which case bookings share the flushes of the journal,
+     * so many of them cost about as much as one.
+     *
+     * @return The new ticket, or nullptr if the seat is taken or the flight is full
+     * @throws validation_error if the plane doesn't have the seat
+     * @throws std::runtime_error if the journal could not be written
+     */
+    Ticket* bookTicket(Flight &flight, const std::string &customer_name, unsigned int customer_age, unsigned int seat_number);
+
     /**
     * @brief Displays a menu where the user can choose options regarding deletion, addition or update of planes
     */
@@ -41,6 +108,11 @@ namespace crud {
     */
     void manageHandlingCars();
 
+    /**
+    * @brief Displays a menu where the user can import or export the data from or to other file formats
+    */
+    void manageFiles();
+
     /**
      * @brief Creates the filters for the Plane
      */
@@ -1,6 +1,70 @@
 #pragma once
 
+#include <charconv>
+#include <cstdint>
+#include <functional>
 #include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+/**
+ * Arithmetic of the Gregorian calendar on plain numbers, which can be evaluated at compile time
+ */
+namespace calendar {
+
+    constexpr unsigned int MINUTES_PER_DAY = 24 * 60;
+
+    struct CivilDate {
+        unsigned int year;
+        unsigned int month;
+        unsigned int day;
+    };
+
+    constexpr bool isLeapYear(unsigned int year) {
+        return year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    }
+
+    constexpr unsigned int daysInMonth(unsigned int year, unsigned int month) {
+        if (month == 2)
+            return isLeapYear(year) ? 29 : 28;
+
+        return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+    }
+
+    /**
+     * @brief Counts the days between 0000/01/01 and a date
+     */
+    constexpr std::uint64_t daysFromCivil(unsigned int year, unsigned int month, unsigned int day) {
+        // Years start in March, so that leap days come last, and are counted from 400 years earlier, so that none is negative
+        std::uint64_t shifted_year = static_cast<std::uint64_t>(year) + 400 - (month <= 2);
+        std::uint64_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+
+        return shifted_year * 365 + shifted_year / 4 - shifted_year / 100 + shifted_year / 400 + day_of_year - 146037;
+    }
+
+    /**
+     * @brief Finds the date a number of days after 0000/01/01, the inverse of daysFromCivil
+     */
+    constexpr CivilDate civilFromDays(std::uint64_t days) {
+        std::uint64_t shifted_days = days + 146037;
+        std::uint64_t era = shifted_days / 146097;
+        std::uint64_t day_of_era = shifted_days - era * 146097;
+        std::uint64_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+        std::uint64_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+        std::uint64_t month_index = (5 * day_of_year + 2) / 153;
+
+        unsigned int day = static_cast<unsigned int>(day_of_year - (153 * month_index + 2) / 5 + 1);
+        unsigned int month = static_cast<unsigned int>(month_index < 10 ? month_index + 3 : month_index - 9);
+        unsigned int year = static_cast<unsigned int>(year_of_era + era * 400 + (month <= 2) - 400);
+
+        return CivilDate { year, month, day };
+    }
+}
 
 class Date {
     unsigned int day;
@@ -21,6 +85,7 @@ public:
      * @brief Copies a Date instance
      */
     Date(const Date &date);
+    Date &operator=(const Date &date) = default;
 
 
     // Setters
@@ -35,15 +100,36 @@ public:
     unsigned int getMonth() const;
     unsigned int getYear() const;
 
+    /** The most characters toChars writes for a Date */
+    static constexpr std::size_t MAX_TEXT_SIZE = 16;
+
+    /**
+     * @brief Writes the date as `YYYY/MM/dd` into [first, last), without allocating, as std::to_chars does
+     * @return Where the text ends, or last and std::errc::value_too_large if it does not fit
+     */
+    std::to_chars_result toChars(char *first, char *last) const;
+
     /**
      * @brief Converts a Date instance to a String
      */
     std::string str() const;
 
+    /**
+     * @brief Parses a whole `YYYY/MM/dd` text without throwing, leaving the date untouched if it fails
+     * @return errc::invalid_argument if the text is malformed, errc::result_out_of_range if a field is out of its range,
+     * or no error
+     */
+    static std::errc parse(std::string_view text, Date &date);
+
     /**
     * @brief Converts a string into a Date intance
     */
     static Date readFromString(const std::string &str);
+
+    /**
+     * @brief Returns the date a number of days after this one, following the Gregorian calendar
+     */
+    Date plusDays(unsigned int days) const;
 };
 
 class Time {
@@ -56,8 +142,14 @@ public:
      * @param hour An hour between 0-23
      * @param minute A minute between 0-59
      */
-    Time(unsigned int hour, unsigned int minute);
-    Time(const Time &time);
+    constexpr Time(unsigned int hour, unsigned int minute) : hour(hour), minute(minute) {
+        if (hour > 23)
+            throw std::invalid_argument("Hour value must be between 0 and 23");
+        if (minute > 59)
+            throw std::invalid_argument("Minute value must be between 0 and 59");
+    }
+
+    constexpr Time(const Time &time) = default;
 
     // Setters
 
@@ -66,14 +158,35 @@ public:
 
     // Getters
 
-    unsigned int getHour() const;
-    unsigned int getMinute() const;
+    constexpr unsigned int getHour() const {
+        return hour;
+    }
+
+    constexpr unsigned int getMinute() const {
+        return minute;
+    }
+
+    /** The most characters toChars writes for a Time */
+    static constexpr std::size_t MAX_TEXT_SIZE = 5;
+
+    /**
+     * @brief Writes the time as `HH:mm` into [first, last), without allocating, as std::to_chars does
+     * @return Where the text ends, or last and std::errc::value_too_large if it does not fit
+     */
+    std::to_chars_result toChars(char *first, char *last) const;
 
     /**
      * @brief Converts a Time instance to a String
      */
     std::string str() const;
 
+    /**
+     * @brief Parses a whole `HH:mm` text without throwing, leaving the time untouched if it fails
+     * @return errc::invalid_argument if the text is malformed, errc::result_out_of_range if a field is out of its range,
+     * or no error
+     */
+    static std::errc parse(std::string_view text, Time &time);
+
     static Time readFromString(const std::string &str);
 
     /**
@@ -82,39 +195,176 @@ public:
     bool operator<(const Time &time) const;
 };
 
-class Datetime: public Date, public Time {
+/**
+ * @brief A date and a time of the day, stored as the minutes since 0000/01/01 00:00 of the Gregorian calendar,
+ * so that comparing, hashing and shifting them are single integer operations.
+ * The fields are worked out again by every getter, so code that needs several of them should convert it to a Date and a Time.
+ * Everything but parsing and formatting can be evaluated at compile time.
+ */
+class Datetime {
+    std::uint32_t minutes;
+
+    explicit constexpr Datetime(std::uint32_t minutes) : minutes(minutes) {}
+
+    constexpr calendar::CivilDate getCivilDate() const {
+        return calendar::civilFromDays(minutes / calendar::MINUTES_PER_DAY);
+    }
+
 public:
+    /** The last year a Datetime can hold, so that its minutes fit in 32 bits */
+    static constexpr unsigned int MAX_YEAR = 8000;
+
     /**
      * @brief Creates an object of type Datetime with the given attributes
      *
-     * @param year A year
+     * @param year A year up to MAX_YEAR
      * @param month A month between 1-12
-     * @param day A day between 1-31
+     * @param day A day of that month
      * @param hour An hour between 0-23
      * @param minute A minute between 0-59
      */
-    Datetime(unsigned int year, unsigned int month, unsigned int day, unsigned int hour, unsigned int minute);
+    constexpr Datetime(unsigned int year, unsigned int month, unsigned int day, unsigned int hour, unsigned int minute)
+        : minutes(0) {
+        // Checks the fields as a Date and a Time do
+        if (day < 1 || day > 31)
+            throw std::invalid_argument("Day value must be between 1 and 31");
+        if (month < 1 || month > 12)
+            throw std::invalid_argument("Month value must be between 1 and 12");
+
+        Time time(hour, minute);
+        if (year > MAX_YEAR)
+            throw std::invalid_argument("Year value must be at most " + std::to_string(MAX_YEAR));
+
+        // A day past the end of the month would be counted as one of the next month
+        if (day > calendar::daysInMonth(year, month))
+            throw std::invalid_argument("Day value must be within the month");
+
+        this->minutes = static_cast<std::uint32_t>(calendar::daysFromCivil(year, month, day) * calendar::MINUTES_PER_DAY
+                                                   + time.getHour() * 60 + time.getMinute());
+    }
 
     /**
      * @brief Copies a Datetime instance
      */
-    Datetime(const Datetime &datetime);
+    constexpr Datetime(const Datetime &datetime) = default;
+    constexpr Datetime &operator=(const Datetime &datetime) = default;
+
+    // Setters
+
+    void setDay(unsigned int day);
+    void setMonth(unsigned int month);
+    void setYear(unsigned int year);
+    void setHour(unsigned int hour);
+    void setMinute(unsigned int minute);
+
+    // Getters
+
+    constexpr unsigned int getDay() const {
+        return getCivilDate().day;
+    }
+
+    constexpr unsigned int getMonth() const {
+        return getCivilDate().month;
+    }
+
+    constexpr unsigned int getYear() const {
+        return getCivilDate().year;
+    }
+
+    constexpr unsigned int getHour() const {
+        return minutes % calendar::MINUTES_PER_DAY / 60;
+    }
+
+    constexpr unsigned int getMinute() const {
+        return minutes % 60;
+    }
+
+    /**
+     * @brief The minutes since 0000/01/01 00:00, which order datetimes the same way they do
+     */
+    constexpr std::uint32_t getEpochMinutes() const {
+        return minutes;
+    }
+
+    operator Date() const;
+
+    constexpr operator Time() const {
+        return Time(getHour(), getMinute());
+    }
+
+    /**
+     * @brief Returns the datetime a number of minutes after this one, or before it if the number is negative,
+     * rolling over days, months and years
+     * @throws std::invalid_argument if it would be outside of the years a Datetime can hold
+     */
+    constexpr Datetime plusMinutes(std::int64_t minutes) const {
+        std::int64_t result = static_cast<std::int64_t>(this->minutes) + minutes;
+        if (result < 0 || result >= static_cast<std::int64_t>(calendar::daysFromCivil(MAX_YEAR + 1, 1, 1) * calendar::MINUTES_PER_DAY))
+            throw std::invalid_argument("Datetimes must be between the years 0 and " + std::to_string(MAX_YEAR));
 
+        return Datetime(static_cast<std::uint32_t>(result));
+    }
+
+    /**
+     * @brief Returns the datetime a duration after this one
+     */
+    constexpr Datetime plus(const Time &duration) const {
+        return plusMinutes(duration.getHour() * 60 + duration.getMinute());
+    }
+
+    /**
+     * @brief Counts the minutes from this datetime to the given one, which are negative if it comes first
+     */
+    constexpr std::int64_t minutesUntil(const Datetime &datetime) const {
+        return static_cast<std::int64_t>(datetime.minutes) - minutes;
+    }
 
     /**
      * @overload Displays a Datetime
      */
     friend std::ostream &operator<<(std::ostream &os, const Datetime &datetime);
 
+    /** The most characters toChars writes for a Datetime, whose year has at most four digits */
+    static constexpr std::size_t MAX_TEXT_SIZE = 16;
+
+    /**
+     * @brief Writes the datetime as `YYYY/MM/dd HH:mm` into [first, last), without allocating, as std::to_chars does
+     * @return Where the text ends, or last and std::errc::value_too_large if it does not fit
+     */
+    std::to_chars_result toChars(char *first, char *last) const;
+
     /**
      * @brief Converts a Datetime instance to a string 
      */
     std::string str() const;
 
     // Relational operators overload
-    bool operator<(const Datetime &datetime) const;
-    bool operator==(const Datetime &datetime) const;
-    
+    constexpr bool operator<(const Datetime &datetime) const {
+        return minutes < datetime.minutes;
+    }
+
+    constexpr bool operator==(const Datetime &datetime) const {
+        return minutes == datetime.minutes;
+    }
+
+    /**
+     * @brief Parses a whole `YYYY/MM/dd HH:mm` text without throwing, leaving the datetime untouched if it fails.
+     * Texts with every field zero padded, as str() writes them, take a faster path.
+     *
+     * @return errc::invalid_argument if the text is malformed, errc::result_out_of_range if a field is out of its range,
+     * or no error
+     */
+    static std::errc parse(std::string_view text, Datetime &datetime);
+
+    /**
+     * @brief Parses a column of datetimes at once, appending them to the values.
+     * It is meant for texts written by str(), which are checked and converted several bytes at a time,
+     * but takes any text that parse() does.
+     *
+     * @return The index of the first text that could not be parsed, with its error, or the number of texts and no error
+     */
+    static std::pair<std::size_t, std::errc> parseColumn(std::span<const std::string_view> texts, std::vector<Datetime> &values);
+
     /**
      * @brief Converts a string to a Datetime instance
      * @param str String representing the datetime
@@ -122,5 +372,11 @@ public:
      * @note The string must be in a valid format: `YYYY/MM/dd HH:mm`
      */
     static Datetime readFromString(const std::string &str);
+};
 
-};
\ No newline at end of file
+template<>
+struct std::hash<Datetime> {
+    std::size_t operator()(const Datetime &datetime) const {
+        return datetime.getEpochMinutes() * 0x9E3779B97F4A7C15ull;
+    }
+};
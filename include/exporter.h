@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "airport.h"
+#include "flight.h"
+#include "handling_car.h"
+#include "plane.h"
+#include "service.h"
+#include "ticket.h"
+
+/**
+ * Machine-readable dumps of the data as JSON lines, where every record is a JSON object on a line of its own.
+ *
+ * Records are streamed through a fixed-size buffer, so the memory an export uses doesn't depend on how many records it writes.
+ * Dates and times are written in ISO 8601, such as "2022-01-31T09:05", and durations in minutes.
+ */
+namespace exporter {
+
+    /** Size of the output buffer, which is written to the file whenever it fills up */
+    constexpr std::size_t BUFFER_SIZE = 64 << 10;
+
+    /** How deeply objects and arrays may be nested */
+    constexpr std::size_t MAX_DEPTH = 8;
+
+    /**
+     * @brief Writes JSON values into a file, one line per top-level object
+     */
+    class JsonLinesWriter {
+        int fd;
+        std::unique_ptr<char[]> buffer;
+        std::size_t used = 0;
+
+        /** Whether the object or array at each depth already has an element, and so needs a comma before the next one */
+        bool has_elements[MAX_DEPTH] = {};
+        std::size_t depth = 0;
+        bool after_key = false;
+        std::size_t line_count = 0;
+
+        void flush();
+        void append(const char *data, std::size_t size);
+        void put(char c);
+        void beforeValue();
+        void open(char bracket);
+        void close(char bracket);
+
+    public:
+        /**
+         * @brief Creates or truncates the file at the given path
+         * @throws std::runtime_error if the file could not be opened
+         */
+        explicit JsonLinesWriter(const std::string &path);
+
+        JsonLinesWriter(const JsonLinesWriter &) = delete;
+        JsonLinesWriter &operator=(const JsonLinesWriter &) = delete;
+
+        /**
+         * @brief Closes the file, writing what is left in the buffer. Errors are ignored, so call finish() to detect them.
+         */
+        ~JsonLinesWriter();
+
+        JsonLinesWriter &beginObject();
+
+        /**
+         * @brief Closes the current object, which ends the line if it is a top-level object
+         */
+        JsonLinesWriter &endObject();
+
+        JsonLinesWriter &beginArray();
+        JsonLinesWriter &endArray();
+
+        /**
+         * @brief Writes the key of the next member of the current object
+         */
+        JsonLinesWriter &key(std::string_view name);
+
+        JsonLinesWriter &text(std::string_view value);
+        JsonLinesWriter &integer(std::int64_t value);
+
+        /**
+         * @brief Writes a number in the shortest form that reads back the same, or null if it isn't finite
+         */
+        JsonLinesWriter &number(double value);
+
+        /**
+         * @overload Keeps the shortest form of the float, such as 41.2, instead of that of its widened double
+         */
+        JsonLinesWriter &number(float value);
+
+        JsonLinesWriter &boolean(bool value);
+        JsonLinesWriter &null();
+
+        /**
+         * @brief Writes a date and time in ISO 8601, such as "2022-01-31T09:05"
+         */
+        JsonLinesWriter &datetime(const Datetime &value);
+
+        /**
+         * @brief Writes a time of the day in ISO 8601, such as "09:05"
+         */
+        JsonLinesWriter &time(const Time &value);
+
+        /**
+         * @brief Writes what is left in the buffer and closes the file
+         * @throws std::runtime_error if the file could not be written
+         */
+        void finish();
+
+        /**
+         * @return How many records, or top-level objects, have been written
+         */
+        std::size_t getLineCount() const;
+    };
+
+    void write(JsonLinesWriter &writer, const Airport &airport);
+    void write(JsonLinesWriter &writer, const Plane &plane);
+    void write(JsonLinesWriter &writer, const Flight &flight);
+    void write(JsonLinesWriter &writer, const Ticket &ticket);
+    void write(JsonLinesWriter &writer, const HandlingCar &car);
+
+    /**
+     * @param is_finished Whether the service was already done, since services don't know it themselves
+     */
+    void write(JsonLinesWriter &writer, const Service &service, bool is_finished);
+
+    /**
+     * @brief Writes the records of a pool, such as the data or the result of a filter, into a file
+     * @param filter Which records to write, such as the ones built with crud::createFlightFilter; every record if empty
+     *
+     * @return How many records were written
+     * @throws std::runtime_error if the file could not be written
+     */
+    template <typename T>
+    std::size_t exportRecords(const std::string &path, const std::vector<T*> &pool, const std::function<bool(const T* const&)> &filter = nullptr) {
+        JsonLinesWriter writer(path);
+        for (const T *record : pool) {
+            if (!filter || filter(record))
+                write(writer, *record);
+        }
+
+        writer.finish();
+        return writer.getLineCount();
+    }
+
+    /**
+     * @brief Writes the tickets of some flights into a file.
+     * Tickets that haven't been loaded yet are read in place and not kept, so every ticket can be exported in constant memory.
+     *
+     * @return How many tickets were written
+     * @throws std::runtime_error if the file could not be written
+     */
+    std::size_t exportTickets(const std::string &path, const std::vector<Flight*> &flights, const std::function<bool(const Ticket* const&)> &filter = nullptr);
+
+    /**
+     * @brief Writes the finished and the scheduled services of some planes into a file
+     *
+     * @return How many services were written
+     * @throws std::runtime_error if the file could not be written
+     */
+    std::size_t exportServices(const std::string &path, const std::vector<Plane*> &planes, const std::function<bool(const Service* const&)> &filter = nullptr);
+
+    /**
+     * @brief Writes every airport, plane, flight, ticket, service and handling car into airports.jsonl, planes.jsonl and so on
+     * @param directory An existing directory
+     *
+     * @return How many records were written
+     * @throws std::runtime_error if a file could not be written
+     */
+    std::size_t exportAll(const std::string &directory);
+}
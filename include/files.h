@@ -0,0 +1,154 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "datetime.h"
+
+namespace files {
+    /**
+     * Time spent in each phase of the last load, in milliseconds
+     */
+    struct LoadStats {
+        /** Mapping the file and validating its layout */
+        double mapping = 0;
+        /** Verifying the checksums of everything but the passengers, which are verified when they are loaded */
+        double verification = 0;
+        double airports = 0;
+        /** Planes and their services */
+        double planes = 0;
+        /**
+         * Flights, their tickets and their luggage.
+         * A snapshot loads planes and flights together, on several threads, and counts all of it here.
+         */
+        double flights = 0;
+        double handling_cars = 0;
+        /** Building the lookup indexes and sorting the loaded data */
+        double indexing = 0;
+        double journal = 0;
+        double total = 0;
+
+        /** Parts of the snapshot that were left out because they are corrupt */
+        std::vector<std::string> quarantined;
+        /** Where the corrupt files were kept aside, each under its own name */
+        std::vector<std::string> kept_copies;
+    };
+
+    inline LoadStats load_stats;
+
+    /**
+     * Adds the time elapsed between its creation and its destruction to one of the load_stats counters
+     */
+    class LoadTimer {
+        double &counter;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    public:
+        explicit LoadTimer(double &counter) : counter(counter) {}
+
+        ~LoadTimer() {
+            counter += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    /**
+     * Figures about the background saves, in milliseconds
+     */
+    struct AutosaveStats {
+        /** Saves that finished, successfully or not */
+        unsigned int count = 0;
+        unsigned int failures = 0;
+        /** Time the data was held still to start the last save, which the menus may have had to wait for */
+        double last_pause = 0;
+        double max_pause = 0;
+        /** Time it took to write the last snapshot */
+        double last_duration = 0;
+    };
+
+    /**
+     * @brief Loads the application data and replays the journal on top of it.
+     * The binary snapshot is preferred; the text file is only used when there is no snapshot yet.
+     */
+    void read();
+
+    /**
+     * @brief Saves the application data into the binary snapshot and starts a new, empty journal
+     */
+    void write();
+
+    /**
+     * @brief The path of the binary snapshot, which may be read while the program runs, such as with snapshot::findFlight.
+     * Changes made since it was last written are only in the journal.
+     */
+    const std::string &getSnapshotPath();
+
+    /**
+     * @brief Returns a path next to the given one where a corrupt copy of it can be kept without replacing an earlier copy:
+     * <path>.corrupt, then <path>.corrupt.1, <path>.corrupt.2 and so on
+     */
+    std::string getQuarantinePath(const std::string &path);
+
+    /**
+     * @brief Flushes the directory that holds a file which was just created or renamed, so that a crash can't lose its name
+     * @throws std::runtime_error if the directory could not be flushed
+     */
+    void syncDirectory(const std::string &path);
+
+    /**
+     * @brief Starts a thread that folds the journal into a new snapshot once it grows too large,
+     * or once it has held changes for a while.
+     *
+     * Saves only start while the program is idle. The thread forks, and the child process writes the snapshot
+     * from its own copy of the data, so the program never waits for the snapshot itself. If the fork fails, the save
+     * is counted as failed and tried again a little later.
+     */
+    void startAutosave();
+
+    /**
+     * @brief Tells the autosave thread whether the program is waiting for the user and leaves the data alone.
+     * Leaving the idle state waits for a fork that is in progress.
+     */
+    void setIdle(bool idle);
+
+    AutosaveStats getAutosaveStats();
+
+    /**
+     * @brief Stops the autosave thread, waiting for any snapshot still being written, and closes the journal.
+     * Every change is already in the journal, so nothing else needs to be saved.
+     */
+    void close();
+
+    /**
+     * @brief Replaces the application data with the contents of a text file
+     * @param path The path of the text file
+     *
+     * @throws std::exception if the file could not be opened or is malformed
+     */
+    void readText(const std::string &path);
+
+    /**
+     * @brief Writes the application data into a text file
+     * @param path The path of the text file
+     *
+     * @throws std::runtime_error if the file could not be written
+     */
+    void writeText(const std::string &path);
+
+    /**
+     * @brief Deletes every plane, flight, airport and handling car
+     */
+    void clear();
+
+    /**
+     * @brief Parses a time written as in the text file, such as "09:05"
+     * @throws std::runtime_error if the text is malformed
+     */
+    Time parseTime(std::string_view text);
+
+    /**
+     * @brief Parses a date and time written as in the text file, such as "2022/01/31 09:05"
+     * @throws std::runtime_error if the text is malformed
+     */
+    Datetime parseDatetime(std::string_view text);
+}
@@ -9,19 +9,87 @@ class Flight;
 #include "ticket.h"
 #include "airport.h"
 #include "luggage.h"
+#include <cstdint>
 #include <functional>
+#include <memory>
 #include <algorithm>
+#include <string_view>
+
+/**
+ * @brief Identifies a flight in a temporary index, such as the ones built while loading or importing data.
+ * The id is only viewed, so it must outlive the key.
+ */
+struct FlightKey {
+    std::string_view flight_id;
+    Datetime departure_time;
+
+    bool operator==(const FlightKey &other) const {
+        return flight_id == other.flight_id && departure_time == other.departure_time;
+    }
+};
+
+struct FlightKeyHash {
+    std::size_t operator()(const FlightKey &key) const {
+        return std::hash<std::string_view>()(key.flight_id) ^ std::hash<Datetime>()(key.departure_time);
+    }
+};
+
+/**
+ * @brief Where a flight's tickets and luggage are stored, as record indexes into its loader's source
+ */
+struct PassengerRange {
+    std::uint64_t first_ticket;
+    std::uint32_t ticket_count;
+    std::uint64_t first_luggage;
+    std::uint32_t luggage_count;
+};
+
+/**
+ * @brief Creates a flight's tickets and luggage the first time they are needed
+ */
+class PassengerLoader {
+public:
+    virtual ~PassengerLoader() = default;
+
+    /**
+     * @brief Adds the tickets and luggage found in the given range to the flight
+     *
+     * @throws std::runtime_error if the passengers could not be loaded
+     */
+    virtual void load(Flight &flight, const PassengerRange &range) const = 0;
+
+    /**
+     * @brief Calls the visitor with every ticket found in the given range, without adding them to the flight.
+     * The tickets only live during the call.
+     *
+     * @return true, if the tickets were visited; false, if they can only be read by loading them, in which case none were visited
+     */
+    virtual bool visitTickets(const Flight &flight, const PassengerRange &range, const std::function<void(const Ticket&)> &visitor) const = 0;
+};
 
 class Flight {
     Plane& plane;
     std::string flight_id;
     Datetime departure_time;
     Time duration;
-    Airport& origin;
-    Airport& destination;
+    /** The departure time plus the duration, kept up to date by the setters */
+    Datetime arrival_time;
+    Airport* origin;
+    Airport* destination;
     std::vector<Ticket*> tickets;
     std::vector<Luggage*> luggage;
 
+    /** Set while the tickets and luggage haven't been loaded yet */
+    std::shared_ptr<const PassengerLoader> passenger_loader;
+    PassengerRange passenger_range = {};
+
+    /**
+     * @brief Loads the tickets and luggage, if they haven't been loaded yet
+     *
+     * @throws std::runtime_error if the loader fails, in which case the flight is left loaded without passengers
+     */
+    void loadPassengers() const;
+
 public:
     /**
      * @brief Creates an object of type Flight with given attributes
@@ -37,15 +105,37 @@ public:
 
     // Getters
 
-    std::string getFlightId() const;
+    const std::string &getFlightId() const;
     Datetime getDepartureTime() const;
     Time getDuration() const;
+    Datetime getArrivalTime() const;
     Airport& getOrigin() const;
     Airport& getDestination() const;
-    std::vector<Ticket*> getTickets() const;
-    std::vector<Luggage*> getLuggage() const;
+    const std::vector<Ticket*> &getTickets() const;
+
+    /**
+     * @brief Calls the visitor with every ticket, in seat order.
+     * Tickets that haven't been loaded yet are read in place and not kept, so every ticket can be visited in constant memory.
+     */
+    void forEachTicket(const std::function<void(const Ticket&)> &visitor) const;
+    const std::vector<Luggage*> &getLuggage() const;
     Plane& getPlane() const;
 
+    /**
+     * @return How many tickets the flight has, without loading them
+     */
+    std::size_t getTicketCount() const;
+
+    /**
+     * @return How much luggage the flight has, without loading it
+     */
+    std::size_t getLuggageCount() const;
+
+    /**
+     * @return true, if the flight is in the air at some point of [begin, end), from its departure up to its arrival
+     */
+    bool overlaps(const Datetime &begin, const Datetime &end) const;
+
     // Setters
 
     void setDepartureTime(Datetime &datetime);
@@ -54,6 +144,28 @@ public:
     void setDestination(Airport &destination);
     void addLuggage(Luggage &luggage);
 
+    /**
+     * @brief Defers the creation of the flight's tickets and luggage until they are first used
+     * @param loader What creates them
+     * @param range Where they are stored
+     */
+    void setPassengerLoader(std::shared_ptr<const PassengerLoader> loader, const PassengerRange &range);
+
+    /**
+     * @return true, if the tickets and luggage have been created; false, if they are still waiting to be loaded
+     */
+    bool hasPassengersLoaded() const;
+
+    /**
+     * @return What will create the tickets and luggage, or nullptr if they have been created
+     */
+    const PassengerLoader *getPassengerLoader() const;
+
+    /**
+     * @return Where the tickets and luggage are stored, while they are still waiting to be loaded
+     */
+    const PassengerRange &getPassengerRange() const;
+
     std::string str() const;
 
     /**
@@ -64,6 +176,14 @@ public:
      */
     bool addTicket(Ticket &ticket);
 
+    /**
+     * @brief Adds several tickets to the flight's purchased tickets with a single merge
+     * @param tickets The flight's new tickets, sorted by seat number
+     *
+     * @return true, if there was room on the flight for all of them; false, if none were added
+     */
+    bool addTickets(const std::vector<Ticket*> &tickets);
+
     /**
      * @brief Removes a ticket from the flight's purchased tickets
      * @param ticket A flight's ticket
@@ -85,6 +205,11 @@ public:
      */
     void clearTickets();
 
+    /**
+     * @brief Removes all existing luggage
+     */
+    void clearLuggage();
+
     /**
      * @overload Displays a Flight instance
      */
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+#include "datetime.h"
+#include "flight.h"
+
+/**
+ * An index of `data::flights` by departure time.
+ *
+ * Flights are put in buckets by the day they depart, and every bucket is kept sorted by departure time, so the departures
+ * of a time window are found with a binary search and a walk over the flights in it, without going through every flight.
+ *
+ * The index is built from `data::flights` the first time it is queried, and `crud` keeps it up to date from then on as it
+ * adds, reschedules and deletes flights. Code that replaces `data::flights` in bulk calls invalidate() instead, so that
+ * loading data never pays for an index that may not be used.
+ */
+namespace flight_calendar {
+
+    /**
+     * @brief Adds a flight that was just added to `data::flights`
+     */
+    void add(Flight &flight);
+
+    /**
+     * @brief Removes a flight that is about to be removed from `data::flights`
+     */
+    void remove(const Flight &flight);
+
+    /**
+     * @brief Moves a flight whose departure time was just changed
+     * @param departure_time The departure time it had before
+     */
+    void move(Flight &flight, const Datetime &departure_time);
+
+    /**
+     * @brief Drops the index, which is built again from `data::flights` when it is next queried
+     */
+    void invalidate();
+
+    /**
+     * @brief Finds the flights that depart in [begin, end), in departure order,
+     * in O(log n + k) for k flights once the index is built
+     */
+    std::vector<Flight*> findDepartures(const Datetime &begin, const Datetime &end);
+}
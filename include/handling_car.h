@@ -1,10 +1,11 @@
 #pragma once
 
-#include <stack>
 #include <deque>
+#include <vector>
 #include "luggage.h"
 
-using LuggageStack = std::stack<Luggage*>;
+/** A stack of luggage, stored from the bottom to the top so it can be walked without being emptied */
+using LuggageStack = std::vector<Luggage*>;
 using Carriage = std::deque<LuggageStack>;
 
 class HandlingCar {
@@ -60,7 +61,7 @@ public:
 
     // Getters
 
-    unsigned int getId();
+    unsigned int getId() const;
     unsigned int getNumberOfCarriages() const;
     unsigned int getStacksPerCarriage() const;
     unsigned int getLuggagePerStack() const;
@@ -86,10 +87,15 @@ public:
      */
     bool addLuggage(Luggage &luggage);
 
-    std::deque<Carriage> getCarriages() const;
+    const std::deque<Carriage> &getCarriages() const;
 
     Flight* getFlight() const;
     void setFlight(Flight &flight);
 
+    /**
+     * @brief Stops serving any flight, dropping the luggage that was loaded for it
+     */
+    void clearFlight();
+
     friend std::ostream& operator<<(std::ostream &out, const HandlingCar &car);
 };
\ No newline at end of file
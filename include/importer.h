@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "datetime.h"
+
+/**
+ * Bulk imports of data feeds, which add to the current data instead of replacing it like files::readText.
+ *
+ * Imports are all or nothing: every row is checked before any of them is added. They aren't journaled,
+ * so files::write must be called afterwards to keep what was imported.
+ */
+namespace importer {
+
+    /**
+     * @brief Paths of the CSV files of a feed. Empty paths are skipped.
+     *
+     * The first line of every file is a header, and is skipped. The columns are:
+     * - airports: name
+     * - planes: license_plate, type, capacity
+     * - flights: flight_id, departure_time, duration, origin, destination, license_plate
+     * - tickets: flight_id, departure_time, customer_name, customer_age, seat_number
+     * - luggage: flight_id, departure_time, seat_number, weight
+     *
+     * Dates and times are written as in the text file, such as "2022/01/31 09:05" and "01:30".
+     * Fields may be quoted, with doubled quotes inside, but can't span several lines.
+     */
+    struct CsvSources {
+        std::string airports;
+        std::string planes;
+        std::string flights;
+        std::string tickets;
+        std::string luggage;
+    };
+
+    struct ImportResult {
+        std::size_t airports = 0;
+        std::size_t planes = 0;
+        std::size_t flights = 0;
+        std::size_t tickets = 0;
+        std::size_t luggage = 0;
+        /** Rows that were left out on purpose, such as routes between unknown airports */
+        std::size_t skipped = 0;
+    };
+
+    /**
+     * @brief Paths of the files of the OpenFlights dataset, in the format described at https://openflights.org/data.html.
+     * The planes file is only used to name the plane types, and may be left empty.
+     */
+    struct OpenFlightsSources {
+        std::string airports;
+        std::string routes;
+        std::string planes;
+    };
+
+    /**
+     * @brief How the routes of the OpenFlights dataset are turned into flights
+     */
+    struct OpenFlightsOptions {
+        /** The day of the first flight of every route */
+        Date first_day = Date(1, 1, 2023);
+        /** How many days of flights every route gets, one flight a day */
+        unsigned int days = 30;
+        /** Seats of every plane, since the dataset doesn't have them */
+        unsigned int capacity = 180;
+    };
+
+    /**
+     * @brief Finds the files of a feed in a directory, named airports.csv, planes.csv, flights.csv, tickets.csv and luggage.csv
+     * @param directory The directory of the feed, where some of the files may be missing
+     *
+     * @throws std::runtime_error if none of the files are there
+     */
+    CsvSources findCsvSources(const std::string &directory);
+
+    /**
+     * @brief Adds the rows of a CSV feed to the data.
+     * Files are split into chunks that are parsed on several threads, and every container is then merged with the new
+     * records once, so millions of rows can be imported in a few seconds.
+     *
+     * Rows may refer to records that already exist or to records of the same feed.
+     *
+     * @return How many records of each kind were added
+     * @throws std::runtime_error naming the file and line of the first invalid row, in which case nothing is added
+     */
+    ImportResult importCsv(const CsvSources &sources);
+
+    /**
+     * @brief Finds the files of the OpenFlights dataset in a directory, named airports.dat, routes.dat and planes.dat
+     * @throws std::runtime_error if the airports or the routes are missing
+     */
+    OpenFlightsSources findOpenFlightsSources(const std::string &directory);
+
+    /**
+     * @brief Adds the airports of the OpenFlights dataset, along with a plane and a daily flight for every route.
+     *
+     * Airports are named after their name and code, such as "Francisco de Sa Carneiro Airport (OPO)", and airports that
+     * already exist are reused. Every route that isn't a codeshare gets its own plane, with a license plate such as OF-000001
+     * and the first type of its equipment. Its flights are named after the airline, depart at the same time every day,
+     * and fly at 800 km/h plus 30 minutes for taxiing. Routes between unknown airports are skipped.
+     *
+     * The same files and options always give the same data, so the dataset can be rebuilt anywhere.
+     *
+     * @return How many records of each kind were added, and how many routes were skipped
+     * @throws std::runtime_error naming the file and line of the first malformed row, or if a plane or flight already exists,
+     * in which case nothing is added
+     */
+    ImportResult importOpenFlights(const OpenFlightsSources &sources, const OpenFlightsOptions &options);
+
+    /**
+     * @brief Applies a patch made by snapshot::diff, which turns the data of the snapshot it was made from into that of the other one.
+     * Unlike the feeds, a patch also changes and removes records.
+     *
+     * @return How many changes were applied
+     * @throws std::runtime_error if the file isn't a complete patch, or a change doesn't fit the data, such as one that removes
+     * a flight that doesn't exist, in which case the data is loaded again from the disk, so nothing is changed
+     */
+    std::uint64_t applyPatch(const std::string &path);
+}
@@ -36,6 +36,10 @@ class Menu {
     std::list<MenuBlock> blocks;
     MenuBlock special_block;
 
+    /** Called when a menu starts and stops waiting for the user to pick an option */
+    static std::function<void()> wait_handler;
+    static std::function<void()> resume_handler;
+
     /**
     * @brief Displays all the options on the console according to the menu
     */
@@ -47,6 +51,12 @@ class Menu {
     */
     MenuOption const &getSelectedOption() const;
 
+    /**
+    * @brief Reads user's selected option, calling the wait handlers around it
+    * @return The selected option, if valid
+    */
+    MenuOption const &getSelectedOptionWhileWaiting() const;
+
 public:
 
     /**
@@ -67,6 +77,13 @@ public:
     */
     void setSpecialBlock(const MenuBlock &block);
 
+    /**
+    * @brief Sets the functions to call when any menu starts and stops waiting for the user to pick an option
+    * @param on_wait Called before reading the option
+    * @param on_resume Called after reading the option, even if the input ended
+    */
+    static void setWaitHandlers(const std::function<void()> &on_wait, const std::function<void()> &on_resume);
+
     /**
     * @brief Display's the menu's title and options, if they exist
     */
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "airport.h"
+#include "datetime.h"
+#include "flight.h"
+#include "handling_car.h"
+#include "plane.h"
+#include "service.h"
+#include "ticket.h"
+
+/**
+ * Append-only journal of every change made to the `data` namespace.
+ *
+ * Journals are numbered by generation (`data.journal.<generation>`). A snapshot stores the first generation
+ * it does not include, so loading the snapshot and replaying every journal from that generation onwards
+ * rebuilds the latest state. Every change is written as soon as it is made, so a crash loses nothing, and sync()
+ * makes the changes survive a power loss too.
+ *
+ * A Follower reads the records of a journal as they are written, so they can be shipped to another process,
+ * which replays them with applyRecords().
+ *
+ * A patch is a file of records that is applied on its own, with applyPatch(), instead of being replayed on top of a snapshot.
+ * Its records are built from the fields of the entities, by a Patch, so that changes can be described without loading them.
+ */
+namespace journal {
+
+    enum class Operation : std::uint8_t {
+        PUT_PLANE = 1,
+        SCHEDULE_SERVICE,
+        COMPLETE_SERVICE,
+        DELETE_PLANE,
+        CREATE_FLIGHT,
+        UPDATE_FLIGHT,
+        DELETE_FLIGHT,
+        PUT_TICKET,
+        DELETE_TICKET,
+        PUT_AIRPORT,
+        DELETE_AIRPORT,
+        CREATE_HANDLING_CAR,
+        SET_HANDLING_CAR_FLIGHT,
+        LOAD_LUGGAGE,
+        UNLOAD_HANDLING_CAR,
+        DELETE_HANDLING_CAR,
+        ARCHIVE_BEFORE,
+        /** Replaces every service of a plane */
+        PUT_SERVICES,
+        /** Replaces the luggage of a flight */
+        PUT_FLIGHT_LUGGAGE,
+        /** Drops the luggage of a handling car along with its flight */
+        CLEAR_HANDLING_CAR
+    };
+
+    /** A place in the journals: a generation and an offset into its file */
+    struct Position {
+        std::uint64_t generation;
+        std::uint64_t offset;
+    };
+
+    /**
+     * @brief Replays every journal that isn't part of the loaded snapshot and opens the latest one for appending
+     * @param generation The first journal generation that isn't part of the loaded snapshot
+     * @return false if a journal could not be replayed. The faulty journal and every later one are renamed to
+     * `<name>.corrupt`, and every change before the faulty record is kept, so the data should be saved again.
+     *
+     * @throws std::runtime_error if the journal could not be opened for appending
+     */
+    bool open(std::uint64_t generation);
+
+    /**
+     * @brief Flushes and closes the journal that is currently open
+     */
+    void close();
+
+    /**
+     * @brief Starts a new, empty journal. Everything written before belongs to older generations, and is flushed.
+     * @return The generation of the new journal
+     * @throws std::runtime_error if the old journal could not be flushed or the new one could not be opened
+     */
+    std::uint64_t rotate();
+
+    /**
+     * @brief Waits until every change written so far has reached the disk, so it survives a power loss and not only a crash.
+     * Threads that call it at the same time share a single flush, along with whatever was written while they waited.
+     *
+     * @throws std::runtime_error if the journal could not be flushed
+     */
+    void sync();
+
+    /**
+     * @brief Deletes the journals of every generation older than the given one
+     */
+    void removeBefore(std::uint64_t generation);
+
+    /**
+     * @brief Returns the size, in bytes, of the journal that is currently open
+     */
+    std::uint64_t getSize();
+
+    /**
+     * @brief Returns whether no change has been written to the journal that is currently open
+     */
+    bool isEmpty();
+
+    /**
+     * @brief Returns where the next record will be written
+     */
+    Position getPosition();
+
+    /**
+     * @brief Applies records read from another journal by a Follower, and appends them to the journal that is currently open
+     * @return How many records were applied
+     * @throws std::runtime_error if a record could not be applied or written. The records before it are kept.
+     */
+    std::size_t applyRecords(std::string_view records);
+
+    /**
+     * @brief Reads the records of one generation of the journal, waiting for new ones once it reaches the end.
+     * Only records that were completely written are read.
+     */
+    class Follower {
+        int file;
+        std::uint64_t generation;
+        std::uint64_t offset;
+        bool is_finished = false;
+
+    public:
+        /**
+         * @brief Starts reading from the first record of a generation
+         * @throws std::runtime_error if there is no journal of that generation, such as one that was folded into a snapshot
+         */
+        explicit Follower(std::uint64_t generation);
+
+        Follower(const Follower &) = delete;
+        Follower &operator=(const Follower &) = delete;
+
+        ~Follower();
+
+        /**
+         * @brief Waits until there are records left to read, or the timeout runs out, and reads them
+         * @param max_size How many bytes of records to read at most, unless the next record alone is larger
+         *
+         * @return The records, or nothing if the timeout ran out or the generation is finished
+         * @throws std::runtime_error if the journal could not be read
+         */
+        std::string read(std::size_t max_size, std::chrono::milliseconds timeout);
+
+        /**
+         * @brief Returns whether the journal was rotated and every record of this generation was read
+         */
+        bool isFinished() const;
+
+        /**
+         * @brief Returns where the next record will be read
+         */
+        Position getPosition() const;
+    };
+
+    /** A service as a patch holds it, without its plane */
+    struct ServiceEntry {
+        ServiceType type;
+        Datetime datetime;
+        std::string worker;
+    };
+
+    /** A piece of luggage as a patch holds it, by the seat of its owner's ticket */
+    struct LuggageEntry {
+        unsigned int seat_number;
+        float weight;
+    };
+
+    /**
+     * @brief Builds records from the fields of the entities they change, for the journal or for a patch.
+     * Flights are identified by their id and departure time, and handling cars by their position in `data::handlingCars`.
+     */
+    class Patch {
+        std::string records;
+        std::size_t record_count = 0;
+
+    public:
+        void putPlane(std::string_view license_plate, std::string_view type, unsigned int capacity);
+
+        /**
+         * @brief Replaces every service of a plane
+         */
+        void putServices(std::string_view license_plate, const std::vector<ServiceEntry> &finished, const std::vector<ServiceEntry> &scheduled);
+        void scheduleService(std::string_view license_plate, const ServiceEntry &service);
+        void completeService(std::string_view license_plate);
+        void deletePlane(std::string_view license_plate);
+
+        void createFlight(std::string_view flight_id, const Datetime &departure_time, const Time &duration,
+                          std::string_view origin, std::string_view destination, std::string_view license_plate);
+
+        /**
+         * @brief Changes everything about a flight but its plane
+         * @param departure_time The departure time of the flight before the change, which identifies it
+         */
+        void updateFlight(std::string_view flight_id, const Datetime &departure_time, const Datetime &new_departure_time,
+                          const Time &duration, std::string_view origin, std::string_view destination);
+        void deleteFlight(std::string_view flight_id, const Datetime &departure_time);
+
+        void putTicket(std::string_view flight_id, const Datetime &departure_time, unsigned int seat_number,
+                       std::string_view customer_name, unsigned int customer_age);
+        void deleteTicket(std::string_view flight_id, const Datetime &departure_time, unsigned int seat_number);
+
+        /**
+         * @brief Replaces the luggage of a flight, whose tickets must already be there
+         */
+        void putFlightLuggage(std::string_view flight_id, const Datetime &departure_time, const std::vector<LuggageEntry> &luggage);
+
+        void putAirport(std::string_view name, const std::set<TransportPlace> &places);
+        void deleteAirport(std::string_view name);
+
+        void createHandlingCar(unsigned int number_of_carriages, unsigned int stacks_per_carriage, unsigned int luggage_per_stack);
+        void setHandlingCarFlight(std::uint32_t car, std::string_view flight_id, const Datetime &departure_time);
+        void loadLuggage(std::uint32_t car, unsigned int seat_number, float weight);
+        void unloadHandlingCar(std::uint32_t car);
+
+        /**
+         * @brief Drops the luggage of a handling car, without unloading it into its flight, along with its flight
+         */
+        void clearHandlingCar(std::uint32_t car);
+        void deleteHandlingCar(std::uint32_t car);
+
+        void archiveBefore(const Datetime &cutoff);
+
+        const std::string &getRecords() const;
+        std::size_t getRecordCount() const;
+        bool isEmpty() const;
+    };
+
+    /**
+     * @brief Writes patches into a file, one after the other
+     */
+    class PatchWriter {
+        std::ofstream file;
+        std::uint64_t record_count = 0;
+
+    public:
+        /**
+         * @throws std::runtime_error if the file could not be created
+         */
+        explicit PatchWriter(const std::string &path);
+
+        void append(const Patch &patch);
+
+        /**
+         * @brief Completes the file, which can't be applied before
+         * @return How many records it holds
+         * @throws std::runtime_error if the file could not be written
+         */
+        std::uint64_t finish();
+    };
+
+    /**
+     * @brief Applies the records of a patch file to the data, without journaling them, so files::write must be called afterwards
+     * @return How many records were applied
+     *
+     * @throws std::runtime_error if the file isn't a complete patch, or a record could not be applied, such as one that refers to
+     * an entity that doesn't exist. The records before it are kept.
+     */
+    std::uint64_t applyPatch(const std::string &path);
+
+    // Records
+
+    /** Records the creation of a plane or a change to its type or capacity */
+    void logPlane(const Plane &plane);
+    void logServiceScheduled(const Service &service);
+    void logServiceCompleted(const Plane &plane);
+    void logPlaneDeleted(const Plane &plane);
+
+    void logFlightCreated(const Flight &flight);
+
+    /**
+     * @brief Records a change to a flight
+     * @param departure_time The departure time of the flight before the change, which identifies it
+     */
+    void logFlightUpdated(const Flight &flight, const Datetime &departure_time);
+    void logFlightDeleted(const Flight &flight);
+
+    /** Records the creation of a ticket or a change to its customer */
+    void logTicket(const Ticket &ticket);
+    void logTicketDeleted(const Ticket &ticket);
+
+    /** Records the creation of an airport or a change to its transport places */
+    void logAirport(const Airport &airport);
+    void logAirportDeleted(const Airport &airport);
+
+    void logHandlingCarCreated(const HandlingCar &car);
+    void logHandlingCarFlight(const HandlingCar &car);
+
+    /**
+     * @brief Records a piece of luggage being loaded into a handling car
+     * @param ticket The ticket of the luggage's owner
+     */
+    void logLuggageLoaded(const HandlingCar &car, const Ticket &ticket, float weight);
+    void logHandlingCarUnloaded(const HandlingCar &car);
+    void logHandlingCarDeleted(const HandlingCar &car);
+
+    /**
+     * @brief Records that everything older than the cutoff was moved to the archive.
+     * Must be called once the archive holds it, since replaying it only removes it from memory.
+     */
+    void logArchived(const Datetime &cutoff);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Compression in the LZ4 block format, as described at https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md.
+ *
+ * It trades ratio for speed: compressing runs at hundreds of MB/s and decompressing at several GB/s, so reading
+ * compressed data costs less than reading the bytes it saves from the disk.
+ */
+namespace lz4 {
+
+    /**
+     * @brief Returns the largest size a block of the given size can take once compressed
+     */
+    constexpr std::size_t compressBound(std::size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    /**
+     * @brief Compresses a block
+     * @param capacity The room in the destination. A capacity smaller than the source gives up on blocks that don't shrink enough.
+     *
+     * @return The size of the compressed block, or 0 if it doesn't fit in the destination
+     */
+    std::size_t compress(const char *source, std::size_t size, char *destination, std::size_t capacity);
+
+    /**
+     * @brief Decompresses a block
+     * @param destination_size The size the block had before it was compressed
+     *
+     * @return false if the block is malformed or doesn't decompress to exactly destination_size bytes.
+     * Nothing is ever read or written out of bounds, whatever the block holds.
+     */
+    bool decompress(const char *source, std::size_t size, char *destination, std::size_t destination_size);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief A read-only view of a whole file, backed by mmap
+ */
+class MappedFile {
+    const char *data = nullptr;
+    std::size_t size = 0;
+
+public:
+    /**
+     * @brief Maps the file at the given path into memory
+     * @param path The path of the file to map
+     * @param is_sequential Whether the file will be read from start to end, so that the kernel reads far ahead.
+     * Otherwise only a little around every page that is touched is read.
+     *
+     * @throws std::runtime_error if the file could not be opened or mapped
+     */
+    explicit MappedFile(const std::string &path, bool is_sequential = true);
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    // Getters
+
+    const char *getData() const;
+    std::size_t getSize() const;
+
+    /**
+     * @brief Returns the whole mapped file as a string_view
+     */
+    std::string_view view() const;
+};
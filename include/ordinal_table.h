@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "airport.h"
+#include "flight.h"
+#include "ticket.h"
+
+/**
+ * @brief Numbers the airports, flights and tickets in the order the writers emit them:
+ * airports in `data::airports` order, flights plane by plane, and tickets by their position in their flight.
+ * It is built once per save, so that every cross-reference is written as an index in constant time,
+ * except for tickets, which are found by seat with a binary search in their flight's tickets.
+ */
+class OrdinalTable {
+    std::unordered_map<const Airport*, std::uint32_t> airports;
+    std::unordered_map<const Flight*, std::uint32_t> flights;
+
+public:
+    /**
+     * @brief Numbers everything currently in the `data` namespace
+     * @throws std::runtime_error if there are more airports or flights than an ordinal can number
+     */
+    OrdinalTable();
+
+    /**
+     * @throws std::runtime_error if the airport isn't in `data::airports`
+     */
+    std::uint32_t getAirport(const Airport &airport) const;
+
+    /**
+     * @throws std::runtime_error if the flight doesn't belong to any plane in `data::planes`
+     */
+    std::uint32_t getFlight(const Flight &flight) const;
+
+    /**
+     * @brief Returns the position of a ticket within the tickets of a flight
+     * @throws std::runtime_error if the ticket isn't one of the flight's tickets
+     */
+    std::uint32_t getTicket(const Flight &flight, const Ticket &ticket) const;
+};
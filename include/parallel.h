@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * Runs independent pieces of work on several threads
+ */
+namespace parallel {
+
+    /**
+     * @brief Returns how many threads forEach uses: the hardware concurrency unless it was overridden
+     */
+    unsigned int getThreadCount();
+
+    /**
+     * @brief Overrides how many threads forEach uses
+     * @param count The number of threads, or 0 to go back to the hardware concurrency
+     */
+    void setThreadCount(unsigned int count);
+
+    /**
+     * @brief Calls task(i) for every i in [0, count), spread over getThreadCount() threads.
+     * Indexes are handed out one at a time, so uneven tasks still keep every thread busy.
+     *
+     * @throws The first exception thrown by a task, once every thread has stopped
+     */
+    void forEach(std::size_t count, const std::function<void(std::size_t)> &task);
+}
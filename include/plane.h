@@ -30,12 +30,12 @@ public:
 
     // Getters
 
-    std::string getLicensePlate() const;
-    std::string getType() const;
+    const std::string &getLicensePlate() const;
+    const std::string &getType() const;
     unsigned int getCapacity() const;
-    std::list<Flight*> getFlights() const;
-    std::queue<Service*> getScheduledServices() const;
-    std::vector<Service*> getFinishedServices() const;
+    const std::list<Flight*> &getFlights() const;
+    const std::queue<Service*> &getScheduledServices() const;
+    const std::vector<Service*> &getFinishedServices() const;
 
     // Setters
 
@@ -89,6 +89,14 @@ public:
      */
     bool completeService();
 
+    /**
+     * @brief Removes all finished services of the plane that fulfill the removal condition
+     * @param selector A selection method to choose the services to remove
+     *
+     * @return true, if at least one service was removed; false, if no services were removed
+     */
+    bool removeAllFinishedServices(const std::function <bool (const Service&)> &selector);
+
     /**
      * @overload Displays a Plane instance
      */
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * Log shipping to warm standbys over a local Unix socket.
+ *
+ * The primary listens on the socket. When a standby connects, the primary sends it the snapshot that is on the disk,
+ * followed by every record of the journal from that snapshot onwards, as soon as each record is written. The standby
+ * replaces its own snapshot and journals with them and applies every record to its `data` namespace, so it always holds
+ * a copy that is ready to serve and that survives a restart of its own. Once the primary folds its journal into a new
+ * snapshot, which may hold changes that never went through the journal, such as imports, the standby is sent that snapshot.
+ *
+ * A standby keeps reconnecting until it is promoted, by sending it SIGUSR1, after which it runs as any other instance.
+ * Nothing keeps the old primary from running too, so it must be stopped first.
+ */
+namespace replication {
+
+    /**
+     * Figures about the standbys of this process
+     */
+    struct PrimaryStats {
+        /** Standbys connected right now */
+        unsigned int standbys = 0;
+        /** Snapshots sent, to standbys that connected or after the journal was folded into a new snapshot */
+        unsigned int snapshots = 0;
+        /** Bytes of journal records sent to every standby, and acknowledged by them as applied */
+        std::uint64_t shipped_bytes = 0;
+        std::uint64_t acknowledged_bytes = 0;
+        /** Time between sending the last acknowledged records and hearing that they were applied, in milliseconds */
+        double lag = 0;
+        /** Bytes of the current journal that the standby which acknowledged last hasn't applied */
+        std::uint64_t bytes_behind = 0;
+    };
+
+    /**
+     * Figures about the records this process applied as a standby
+     */
+    struct StandbyStats {
+        bool is_connected = false;
+        unsigned int snapshots = 0;
+        std::uint64_t records = 0;
+        std::uint64_t bytes = 0;
+        /** Time spent applying records, in milliseconds */
+        double apply_time = 0;
+        /** Records applied per second, over about the last second */
+        double throughput = 0;
+        /** Time between the primary sending the last records and this process applying them, in milliseconds */
+        double lag = 0;
+        /** Bytes of the primary's current journal that weren't applied yet, as of the last message from the primary */
+        std::uint64_t bytes_behind = 0;
+    };
+
+    /**
+     * @brief Starts shipping the journal to every standby that connects to the socket.
+     * Saves the data first if there is no snapshot yet, since standbys start from one.
+     *
+     * @throws std::runtime_error if the socket could not be created
+     */
+    void startPrimary(const std::string &socket_path);
+
+    /**
+     * @brief Disconnects every standby and stops listening
+     */
+    void stopPrimary();
+
+    PrimaryStats getPrimaryStats();
+
+    /**
+     * @brief Follows the primary listening on the socket until this process is sent SIGUSR1.
+     * The data must already be loaded; it is replaced by the primary's once it is reached.
+     *
+     * @param report Called about once per second with the current figures
+     */
+    void runStandby(const std::string &socket_path, const std::function<void(const StandbyStats&)> &report);
+
+    StandbyStats getStandbyStats();
+}
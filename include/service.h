@@ -33,7 +33,7 @@ public:
 
     ServiceType getType() const;
     Datetime getDatetime() const;
-    std::string getWorker() const;
+    const std::string &getWorker() const;
     Plane& getPlane() const;
 
     /**
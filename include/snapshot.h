@@ -0,0 +1,303 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "airport.h"
+#include "flight.h"
+#include "luggage.h"
+#include "plane.h"
+#include "ticket.h"
+
+/**
+ * Binary snapshot format.
+ *
+ * A snapshot starts with a fixed Header, followed by `section_count` sections.
+ * Every section starts with a SectionHeader and stores `record_count` fixed-width records.
+ * Strings are kept in the STRINGS section and referenced by (offset, length) pairs.
+ *
+ * Records are stored in the same order `files::write` walks the data:
+ * every plane is followed (in the other sections) by its finished services, its scheduled services and its flights,
+ * and every flight by its tickets and luggage, so the loader only needs to walk each section once.
+ *
+ * The PLANE_BLOCKS section is a table of contents: it tells where each plane's records start in the other sections,
+ * so that planes can be loaded independently of each other, on several threads.
+ *
+ * The FLIGHT_ORDER section lists the flights in the order `data::flights` keeps them, sorted by id, as indexes into the
+ * FLIGHTS section. Loading a snapshot then only has to place the flights instead of sorting them again.
+ *
+ * The FLIGHT_INDEX section is a B+tree of the flights, keyed by flight id and departure time, made of INDEX_NODE_SIZE nodes.
+ * Its leaves come first, in key order, followed by each level of inner nodes, so the root is the last node.
+ * It lets a single flight be read without loading the rest of the snapshot.
+ *
+ * The strings of tickets come after every other string, so loading everything but the passengers reads a small part of the file.
+ *
+ * The CHECKSUMS section comes last. It holds the CRC-32C of the headers, followed by the CRC-32C of every
+ * CHECKSUM_CHUNK_SIZE bytes of every other section, in file order. Chunks are verified when they are first read,
+ * so a corrupt chunk only costs the records stored in it.
+ *
+ * Every SectionHeader is followed by a SectionEncoding. A section encoded as LZ4 is stored chunk by chunk: each chunk is
+ * run through a delta filter, which subtracts from every byte the byte `delta_stride` bytes before it in the chunk, and is
+ * then compressed on its own. Records that look alike, such as the tickets of a flight, leave mostly zeros behind,
+ * which compress well. The section starts with where every stored chunk ends, as uint32 offsets from the end of that table,
+ * followed by the chunks. A chunk that doesn't get smaller is stored as it is, without the filter. The checksums of an LZ4
+ * section cover its stored chunks, and its table is checksummed along with the headers. Chunks are decompressed into
+ * memory when they are first read, so a section is still read as an array of records.
+ *
+ * Strings are only stored once per plane, and once among the strings that don't belong to any plane.
+ */
+namespace snapshot {
+
+    constexpr char MAGIC[8] = { 'A', 'I', 'R', 'S', 'N', 'A', 'P', '\0' };
+    constexpr std::uint32_t VERSION = 7;
+
+    /**
+     * The oldest version that can still be read. Version 2 snapshots have no PLANE_BLOCKS section, version 3 ones have no CHECKSUMS,
+     * version 4 ones have no FLIGHT_ORDER, version 5 ones have no FLIGHT_INDEX, and version 6 ones have no SectionEncoding.
+     */
+    constexpr std::uint32_t MIN_VERSION = 2;
+
+    /** Size of the pieces of a section that are checksummed on their own */
+    constexpr std::size_t CHECKSUM_CHUNK_SIZE = 64 << 10;
+
+    /** Size of the nodes of the flight index, which are read one at a time */
+    constexpr std::size_t INDEX_NODE_SIZE = 4096;
+
+    /** How much of a flight id the flight index keeps. Ids that only differ after it are told apart by their flight records. */
+    constexpr std::size_t INDEX_KEY_LENGTH = 12;
+
+    /** Marks the absence of a reference */
+    constexpr std::uint32_t NONE = UINT32_MAX;
+
+    enum class SectionTag : std::uint32_t {
+        STRINGS = 1,
+        AIRPORTS,
+        TRANSPORT_PLACES,
+        SCHEDULES,
+        PLANES,
+        SERVICES,
+        FLIGHTS,
+        TICKETS,
+        LUGGAGE,
+        HANDLING_CARS,
+        CAR_LUGGAGE,
+        PLANE_BLOCKS,
+        CHECKSUMS,
+        /** Comes after CHECKSUMS in the numbering, since it was added later, but is written before it */
+        FLIGHT_ORDER,
+        FLIGHT_INDEX
+    };
+
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t section_count;
+        std::uint64_t file_size;
+        /** The first journal generation whose changes are not part of the snapshot */
+        std::uint64_t journal_generation;
+    };
+
+    struct SectionHeader {
+        SectionTag tag;
+        std::uint32_t record_size;
+        std::uint64_t record_count;
+    };
+
+    enum class Encoding : std::uint32_t {
+        RAW = 0,
+        LZ4
+    };
+
+    struct SectionEncoding {
+        Encoding encoding;
+        /** The distance of the delta filter, or 0 if there is none */
+        std::uint32_t delta_stride;
+        /** How many bytes the section takes in the file */
+        std::uint64_t stored_size;
+    };
+
+    struct StringRef {
+        std::uint32_t offset;
+        std::uint32_t length;
+    };
+
+    struct PackedDatetime {
+        std::uint16_t year;
+        std::uint8_t month, day, hour, minute;
+        std::uint8_t padding[2];
+    };
+
+    struct PackedTime {
+        std::uint8_t hour, minute;
+    };
+
+    struct AirportRecord {
+        StringRef name;
+        std::uint32_t place_count;
+    };
+
+    struct TransportPlaceRecord {
+        StringRef name;
+        float latitude, longitude, airport_distance;
+        std::uint32_t transport_type;
+        std::uint32_t schedule_count;
+    };
+
+    struct PlaneRecord {
+        StringRef license_plate;
+        StringRef type;
+        std::uint32_t capacity;
+        std::uint32_t finished_service_count;
+        std::uint32_t scheduled_service_count;
+        std::uint32_t flight_count;
+    };
+
+    struct ServiceRecord {
+        StringRef worker;
+        PackedDatetime datetime;
+        std::uint32_t type;
+    };
+
+    struct FlightRecord {
+        StringRef flight_id;
+        PackedDatetime departure_time;
+        PackedTime duration;
+        std::uint8_t padding[2];
+        std::uint32_t origin;
+        std::uint32_t destination;
+        std::uint32_t ticket_count;
+        std::uint32_t luggage_count;
+    };
+
+    struct TicketRecord {
+        StringRef customer_name;
+        std::uint32_t customer_age;
+        std::uint32_t seat_number;
+    };
+
+    /** Used both for a flight's luggage and for the luggage inside a handling car */
+    struct LuggageRecord {
+        /** Index of the owner's ticket within the flight's tickets */
+        std::uint32_t ticket;
+        float weight;
+    };
+
+    /** Where a plane's records start, as record indexes into each section */
+    struct PlaneBlockRecord {
+        std::uint64_t service, flight, ticket, luggage;
+    };
+
+    struct HandlingCarRecord {
+        std::uint32_t number_of_carriages, stacks_per_carriage, luggage_per_stack;
+        /** Index of the flight in the FLIGHTS section, or NONE */
+        std::uint32_t flight;
+        std::uint32_t luggage_count;
+    };
+
+    struct IndexEntry {
+        /** The start of the flight id, padded with zeros */
+        char flight_id[INDEX_KEY_LENGTH];
+        PackedDatetime departure_time;
+        /** In a leaf, the index of the flight in the FLIGHTS section; in an inner node, the index of the child node */
+        std::uint32_t target;
+        /** In a leaf, the index of the flight's plane in the PLANES section */
+        std::uint32_t plane;
+    };
+
+    /** In an inner node, every entry holds the smallest key of its child */
+    struct IndexNode {
+        /** 0 for leaves */
+        std::uint32_t level;
+        std::uint32_t entry_count;
+        IndexEntry entries[(INDEX_NODE_SIZE - 2 * sizeof(std::uint32_t)) / sizeof(IndexEntry)];
+    };
+
+    /**
+     * @brief A flight read on its own from a snapshot, with its tickets and luggage.
+     * Its plane and airports are copies that only know about this flight.
+     */
+    struct FlightManifest {
+        std::unique_ptr<Airport> origin;
+        std::unique_ptr<Airport> destination;
+        std::unique_ptr<Plane> plane;
+        std::unique_ptr<Flight> flight;
+        std::vector<std::unique_ptr<Ticket>> tickets;
+        std::vector<std::unique_ptr<Luggage>> luggage;
+    };
+
+    /**
+     * @brief Replaces the contents of the `data` namespace with the contents of a snapshot
+     * @param path The path of the snapshot
+     * @return The first journal generation whose changes must be replayed on top of the snapshot
+     *
+     * Parts of the snapshot whose checksums don't match are left out and listed in `files::load_stats.quarantined`,
+     * while everything else is loaded.
+     *
+     * @throws std::runtime_error if the snapshot could not be read, is malformed or has corrupt headers
+     */
+    std::uint64_t read(const std::string &path);
+
+    /**
+     * @brief Writes the contents of the `data` namespace into a snapshot.
+     * The snapshot is written to a temporary file first, which then replaces the old snapshot.
+     *
+     * @param path The path of the snapshot
+     * @param journal_generation The first journal generation whose changes are not part of the snapshot
+     * @throws std::runtime_error if the snapshot could not be written, or its strings are too large for the format to refer to
+     * @throws std::runtime_error if the snapshot could not be written
+     */
+    void write(const std::string &path, std::uint64_t journal_generation = 0);
+
+    /**
+     * @brief Reads one flight from a snapshot through its flight index, which only touches the few pages on the way to it.
+     * Changes that were journaled after the snapshot was written are not seen.
+     *
+     * @param path The path of the snapshot
+     * @return The flight, or nothing if the snapshot doesn't have it
+     *
+     * @throws std::runtime_error if the snapshot has no flight index, is malformed, or any part of it that was read is corrupt
+     */
+    std::optional<FlightManifest> findFlight(const std::string &path, const std::string &flight_id, const Datetime &departure_time);
+
+    /** How many entities of one kind differ between two snapshots */
+    struct ChangeCount {
+        std::uint64_t added = 0;
+        std::uint64_t removed = 0;
+        std::uint64_t modified = 0;
+    };
+
+    /**
+     * @brief What differs between two snapshots.
+     *
+     * Entities are matched by their keys: planes by license plate, flights by id and departure time, tickets by flight and seat,
+     * airports by name and handling cars by position, since their ids are only assigned while the program runs.
+     * Services belong to their plane, transport places to their airport and luggage to its ticket's flight,
+     * so a change to any of them modifies their owner.
+     */
+    struct Difference {
+        ChangeCount airports;
+        ChangeCount planes;
+        ChangeCount flights;
+        ChangeCount tickets;
+        ChangeCount handling_cars;
+        /** The first few changes, such as "+ plane PL-000001" or "~ ticket of seat 12 on flight TP0001 at 2022/01/01 10:00" */
+        std::vector<std::string> examples;
+        /** How many records the patch holds */
+        std::uint64_t patch_records = 0;
+    };
+
+    /**
+     * @brief Compares two snapshots, without loading either of them.
+     * Every entity is hashed by its key and its contents, on several threads, and looked up by the hash of its key in the other
+     * snapshot, so the comparison takes linear time. Tickets are matched by walking the tickets of both flights, which are sorted by seat.
+     *
+     * @param patch_path Where to write the patch that turns the data of the old snapshot into that of the new one, which
+     * importer::applyPatch applies, or empty to only compare them
+     *
+     * @throws std::runtime_error if either snapshot could not be read, is malformed or corrupt, or the patch could not be written
+     */
+    Difference diff(const std::string &old_path, const std::string &new_path, const std::string &patch_path = "");
+}
@@ -9,8 +9,8 @@
 
 /** Data that is stored during the runtime of the application */
 namespace data {
-    static std::vector<Plane*> planes;
-    static std::vector<Flight*> flights;
-    static std::vector<HandlingCar*> handlingCars;
-    static std::vector<Airport*> airports;
-}
\ No newline at end of file
+    inline std::vector<Plane*> planes;
+    inline std::vector<Flight*> flights;
+    inline std::vector<HandlingCar*> handlingCars;
+    inline std::vector<Airport*> airports;
+}
@@ -29,7 +29,7 @@ public:
     // Getters
 
     Flight &getFlight() const;
-    std::string getCustomerName() const;
+    const std::string &getCustomerName() const;
     unsigned int getCustomerAge() const;
     unsigned int getSeatNumber() const;
 
@@ -1,12 +1,194 @@
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <string>
+#include <unistd.h>
 #include "interact.h"
 #include "crud.h"
+#include "importer.h"
+#include "replication.h"
+#include "snapshot.h"
 
 using namespace std;
 
-int main() {
+/**
+ * @brief Runs an import without going through the menus, so that it can be scheduled, and saves what it added
+ * @return The exit status of the program
+ */
+int runImport(const function<importer::ImportResult()> &import) {
+    try {
+        importer::ImportResult result = import();
+        files::write();
+
+        cout << "Imported " << result.airports << " airports, " << result.planes << " planes, " << result.flights << " flights, "
+             << result.tickets << " tickets and " << result.luggage << " pieces of luggage";
+        if (result.skipped != 0)
+            cout << ", skipping " << result.skipped << " rows";
+
+        cout << endl;
+    } catch (exception &exception) {
+        cerr << "The data could not be imported: " << exception.what() << endl;
+        files::close();
+        return 1;
+    }
+
+    files::close();
+    return 0;
+}
+
+/**
+ * @brief Applies a patch made by --diff, and saves what it changed
+ * @return The exit status of the program
+ */
+int runPatch(const string &path) {
+    try {
+        uint64_t count = importer::applyPatch(path);
+        files::write();
+
+        cout << "Applied " << count << " changes" << endl;
+    } catch (exception &exception) {
+        cerr << "The patch could not be applied: " << exception.what() << endl;
+        files::close();
+        return 1;
+    }
+
+    files::close();
+    return 0;
+}
+
+/**
+ * @brief Prints what differs between two snapshots, and writes the patch that turns the old one into the new one if a path is given
+ * @return The exit status of the program
+ */
+int showDifference(const string &old_path, const string &new_path, const string &patch_path) {
+    try {
+        snapshot::Difference difference = snapshot::diff(old_path, new_path, patch_path);
+
+        auto printCount = [](const string &name, const snapshot::ChangeCount &count) {
+            cout << left << setw(15) << name << count.added << " added, " << count.removed << " removed, " << count.modified << " modified\n";
+        };
+
+        printCount("Airports:", difference.airports);
+        printCount("Planes:", difference.planes);
+        printCount("Flights:", difference.flights);
+        printCount("Tickets:", difference.tickets);
+        printCount("Handling cars:", difference.handling_cars);
+
+        if (!difference.examples.empty()) {
+            cout << "\nFirst changes:\n";
+            for (const string &example : difference.examples)
+                cout << "  " << example << '\n';
+        }
+
+        if (!patch_path.empty())
+            cout << "\nWrote " << difference.patch_records << " changes to " << patch_path << ", which --apply-patch applies\n";
+
+        cout << flush;
+    } catch (exception &exception) {
+        cerr << "The snapshots could not be compared: " << exception.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Prints a flight and its tickets straight from the snapshot, without loading the rest of the data,
+ * so that reports can be made while the program runs
+ * @return The exit status of the program
+ */
+int showFlight(const string &flight_id, const string &departure_time) {
+    try {
+        optional<snapshot::FlightManifest> manifest = snapshot::findFlight(files::getSnapshotPath(), flight_id, Datetime::readFromString(departure_time));
+        if (!manifest) {
+            cerr << "There is no such flight in the snapshot" << endl;
+            return 1;
+        }
+
+        cout << manifest->flight->str() << "\nPlane: " << manifest->plane->getLicensePlate() << "\n"
+             << manifest->tickets.size() << " tickets, " << manifest->luggage.size() << " pieces of luggage\n";
+
+        for (const auto &ticket : manifest->tickets)
+            cout << "  Seat " << ticket->getSeatNumber() << ": " << ticket->getCustomerName() << ", " << ticket->getCustomerAge() << '\n';
+
+        cout << flush;
+    } catch (exception &exception) {
+        cerr << "The flight could not be read: " << exception.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Shows how a standby is keeping up with its primary, on a single line that is rewritten every time
+ */
+void printStandbyStatus(const replication::StandbyStats &stats) {
+    cout << "\r\x1B[K" << fixed << setprecision(1)
+         << (stats.is_connected ? "Following the primary: " : "Waiting for the primary: ")
+         << stats.records << " records applied, " << stats.throughput << " records/s, "
+         << stats.lag << " ms behind, " << stats.bytes_behind << " bytes to apply" << flush;
+}
+
+int main(int argc, char **argv) {
+
+    if (argc == 4 && string(argv[1]) == "--show-flight")
+        return showFlight(argv[2], argv[3]);
+
+    if ((argc == 4 || argc == 5) && string(argv[1]) == "--diff")
+        return showDifference(argv[2], argv[3], argc == 5 ? argv[4] : "");
 
     files::read();
+
+    if (argc == 3 && string(argv[1]) == "--apply-patch")
+        return runPatch(argv[2]);
+
+    if (argc == 3 && string(argv[1]) == "--import-csv") {
+        return runImport([&]() {
+            return importer::importCsv(importer::findCsvSources(argv[2]));
+        });
+    }
+
+    if ((argc == 3 || argc == 4) && string(argv[1]) == "--import-openflights") {
+        return runImport([&]() {
+            importer::OpenFlightsOptions options;
+            if (argc == 4)
+                options.days = stoul(argv[3]);
+
+            return importer::importOpenFlights(importer::findOpenFlightsSources(argv[2]), options);
+        });
+    }
+
+    bool is_standby = argc == 3 && string(argv[1]) == "--standby";
+    bool is_primary = argc == 3 && string(argv[1]) == "--replicate";
+
+    if (argc != 1 && !is_standby && !is_primary) {
+        cerr << "Usage: " << argv[0] << " [--import-csv <directory> | --import-openflights <directory> [days]"
+             << " | --show-flight <flight id> <\"YYYY/MM/dd HH:mm\"> | --diff <old snapshot> <new snapshot> [patch]"
+             << " | --apply-patch <patch> | --replicate <socket> | --standby <socket>]" << endl;
+        files::close();
+        return 2;
+    }
+
+    if (is_standby) {
+        cout << "Running as a standby of " << argv[2] << ", send SIGUSR1 to process " << getpid() << " to promote it" << endl;
+        replication::runStandby(argv[2], printStandbyStatus);
+        cout << "\nPromoted, the data can now be changed\n" << endl;
+    }
+
+    if (is_primary) {
+        try {
+            replication::startPrimary(argv[2]);
+        } catch (exception &exception) {
+            cerr << "Standbys could not be served: " << exception.what() << endl;
+            files::close();
+            return 1;
+        }
+    }
+
+    files::startAutosave();
+    Menu::setWaitHandlers([]() { files::setIdle(true); }, []() { files::setIdle(false); });
+
     try {
         Menu menu("Please select an area you want to manage!");
 
@@ -15,6 +197,7 @@ int main() {
         planeBlock.addOption("Flights", crud::manageFlights);
         planeBlock.addOption("Airports", crud::manageAirports);
         planeBlock.addOption("Handling Cars", crud::manageHandlingCars);
+        planeBlock.addOption("Data Files", crud::manageFiles);
 
         bool is_running = true;
         MenuBlock exitBlock;
@@ -28,6 +211,7 @@ int main() {
             
     } catch (end_of_file_exception exception) {}
 
-    files::write();
+    replication::stopPrimary();
+    files::close();
     return 0;
 }
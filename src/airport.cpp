@@ -4,7 +4,7 @@
 
 using namespace std;
 
-set<TransportPlace> Airport::getTransportPlaceInfo() const {
+const set<TransportPlace> &Airport::getTransportPlaceInfo() const {
     return transport_place_info;
 }
 
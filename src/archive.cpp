@@ -0,0 +1,524 @@
+#include "archive.h"
+#include "crud.h"
+#include "flight_calendar.h"
+#include "mapped_file.h"
+#include "state.h"
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+using namespace std;
+
+namespace archive {
+
+    static const string PATH = "data.archive";
+
+    /** Records gathered before a block is compressed and appended */
+    constexpr size_t FLIGHTS_PER_BLOCK = 256;
+    constexpr size_t SERVICES_PER_BLOCK = 4096;
+
+    /*----------ENCODING----------*/
+
+    class RecordEncoder {
+        string bytes;
+
+        template <typename T>
+        RecordEncoder &putRaw(const T &value) {
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+            return *this;
+        }
+
+    public:
+        RecordEncoder &putUnsigned(uint32_t value) {
+            return putRaw(value);
+        }
+
+        RecordEncoder &putFloat(float value) {
+            return putRaw(value);
+        }
+
+        RecordEncoder &putString(const string &value) {
+            putUnsigned(value.size());
+            bytes.append(value);
+            return *this;
+        }
+
+        RecordEncoder &putTime(const Time &time) {
+            bytes.push_back(static_cast<char>(time.getHour()));
+            bytes.push_back(static_cast<char>(time.getMinute()));
+            return *this;
+        }
+
+        RecordEncoder &putDatetime(const Datetime &datetime) {
+            Date date = datetime;
+            putRaw(static_cast<uint16_t>(date.getYear()));
+            bytes.push_back(static_cast<char>(date.getMonth()));
+            bytes.push_back(static_cast<char>(date.getDay()));
+            return putTime(datetime);
+        }
+
+        RecordEncoder &putPlane(const Plane &plane) {
+            return putString(plane.getLicensePlate()).putString(plane.getType()).putUnsigned(plane.getCapacity());
+        }
+
+        const string &getBytes() const {
+            return bytes;
+        }
+
+        void clear() {
+            bytes.clear();
+        }
+    };
+
+    class RecordDecoder {
+        string_view bytes;
+
+        template <typename T>
+        T getRaw() {
+            if (bytes.size() < sizeof(T))
+                throw runtime_error("Archive record is truncated");
+
+            T value;
+            memcpy(&value, bytes.data(), sizeof(T));
+            bytes.remove_prefix(sizeof(T));
+            return value;
+        }
+
+    public:
+        explicit RecordDecoder(string_view bytes) : bytes(bytes) {}
+
+        uint32_t getUnsigned() {
+            return getRaw<uint32_t>();
+        }
+
+        float getFloat() {
+            return getRaw<float>();
+        }
+
+        string getString() {
+            uint32_t length = getUnsigned();
+            if (bytes.size() < length)
+                throw runtime_error("Archive record is truncated");
+
+            string value(bytes.substr(0, length));
+            bytes.remove_prefix(length);
+            return value;
+        }
+
+        Time getTime() {
+            unsigned int hour = getRaw<uint8_t>();
+            unsigned int minute = getRaw<uint8_t>();
+            return Time(hour, minute);
+        }
+
+        Datetime getDatetime() {
+            unsigned int year = getRaw<uint16_t>();
+            unsigned int month = getRaw<uint8_t>();
+            unsigned int day = getRaw<uint8_t>();
+            Time time = getTime();
+            return Datetime(year, month, day, time.getHour(), time.getMinute());
+        }
+    };
+
+    void encodeFlight(RecordEncoder &encoder, const Flight &flight) {
+        encoder.putPlane(flight.getPlane())
+               .putString(flight.getFlightId())
+               .putDatetime(flight.getDepartureTime())
+               .putTime(flight.getDuration())
+               .putString(flight.getOrigin().getName())
+               .putString(flight.getDestination().getName());
+
+        const vector<Ticket*> &tickets = flight.getTickets();
+        unordered_map<const Ticket*, uint32_t> ticket_indexes;
+
+        encoder.putUnsigned(tickets.size());
+        for (const Ticket *ticket : tickets) {
+            ticket_indexes.emplace(ticket, ticket_indexes.size());
+            encoder.putString(ticket->getCustomerName()).putUnsigned(ticket->getCustomerAge()).putUnsigned(ticket->getSeatNumber());
+        }
+
+        const vector<Luggage*> &luggage = flight.getLuggage();
+        encoder.putUnsigned(luggage.size());
+        for (Luggage *bag : luggage) {
+            auto it = ticket_indexes.find(&bag->getTicket());
+            if (it == ticket_indexes.end())
+                throw runtime_error("Owner of luggage doesn't have a ticket");
+
+            encoder.putUnsigned(it->second).putFloat(bag->getWeight());
+        }
+    }
+
+    void encodeService(RecordEncoder &encoder, const Service &service) {
+        encoder.putPlane(service.getPlane())
+               .putUnsigned(static_cast<uint32_t>(service.getType()))
+               .putDatetime(service.getDatetime())
+               .putString(service.getWorker());
+    }
+
+    /*----------FILE----------*/
+
+    /**
+     * @brief Returns where the last complete block ends.
+     * Whatever follows it was left by a write that didn't finish.
+     */
+    size_t getValidSize(const MappedFile &file) {
+        const char *data = file.getData();
+        size_t size = file.getSize();
+
+        FileHeader header;
+        if (size < sizeof(header))
+            return 0;
+
+        memcpy(&header, data, sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+            throw runtime_error("Not an archive file");
+
+        if (header.version != VERSION)
+            throw runtime_error("Unsupported archive version");
+
+        size_t offset = sizeof(header);
+        while (size - offset >= sizeof(BlockHeader)) {
+            BlockHeader block;
+            memcpy(&block, data + offset, sizeof(block));
+
+            if (block.compressed_size > size - offset - sizeof(block))
+                break;
+
+            offset += sizeof(block) + block.compressed_size;
+        }
+
+        return offset;
+    }
+
+    /**
+     * @brief Appends blocks to the archive, creating it or dropping an unfinished block at its end first.
+     * Blocks that were not committed are dropped again when the writer is destroyed.
+     */
+    class ArchiveWriter {
+        int file;
+        size_t start_size = 0;
+        bool is_committed = false;
+
+    public:
+        ArchiveWriter() {
+            size_t valid_size = 0;
+            struct stat info;
+            if (stat(PATH.c_str(), &info) == 0)
+                valid_size = getValidSize(MappedFile(PATH));
+
+            file = open(PATH.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+            if (file < 0)
+                throw runtime_error("Could not open the archive");
+
+            if (ftruncate(file, valid_size) != 0) {
+                close(file);
+                throw runtime_error("Could not repair the archive");
+            }
+
+            start_size = valid_size;
+            if (valid_size == 0) {
+                FileHeader header = {};
+                memcpy(header.magic, MAGIC, sizeof(MAGIC));
+                header.version = VERSION;
+
+                if (::write(file, &header, sizeof(header)) != sizeof(header)) {
+                    close(file);
+                    throw runtime_error("Could not write to the archive");
+                }
+            }
+        }
+
+        ArchiveWriter(const ArchiveWriter &) = delete;
+        ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+        ~ArchiveWriter() {
+            if (!is_committed)
+                ftruncate(file, start_size);
+
+            close(file);
+        }
+
+        /**
+         * @brief Compresses the records and appends them as one block, with a single write
+         */
+        void addBlock(BlockKind kind, uint32_t record_count, const string &records) {
+            if (record_count == 0)
+                return;
+
+            uLongf compressed_size = compressBound(records.size());
+            string block(sizeof(BlockHeader) + compressed_size, '\0');
+
+            int result = compress2(reinterpret_cast<Bytef*>(block.data() + sizeof(BlockHeader)), &compressed_size,
+                                   reinterpret_cast<const Bytef*>(records.data()), records.size(), Z_BEST_COMPRESSION);
+            if (result != Z_OK)
+                throw runtime_error("Could not compress archive block");
+
+            BlockHeader header = { kind, record_count, static_cast<uint32_t>(records.size()), static_cast<uint32_t>(compressed_size) };
+            memcpy(block.data(), &header, sizeof(header));
+            block.resize(sizeof(BlockHeader) + compressed_size);
+
+            if (::write(file, block.data(), block.size()) != static_cast<ssize_t>(block.size()))
+                throw runtime_error("Could not write to the archive");
+        }
+
+        /**
+         * @brief Makes sure every appended block has reached the disk, and keeps them
+         */
+        void commit() {
+            if (fdatasync(file) != 0)
+                throw runtime_error("Could not write to the archive");
+
+            is_committed = true;
+        }
+    };
+
+    /**
+     * @brief Calls the visitor with the decompressed records of every block of the given kind, in order
+     */
+    void forEachBlock(BlockKind kind, const function<void(uint32_t, string_view)> &visitor) {
+        struct stat info;
+        if (stat(PATH.c_str(), &info) != 0)
+            return;
+
+        MappedFile file(PATH);
+        size_t size = getValidSize(file);
+        size_t offset = sizeof(FileHeader);
+        string records;
+
+        while (offset < size) {
+            BlockHeader block;
+            memcpy(&block, file.getData() + offset, sizeof(block));
+            offset += sizeof(block);
+
+            if (block.kind == kind) {
+                records.resize(block.raw_size);
+                uLongf raw_size = block.raw_size;
+
+                int result = uncompress(reinterpret_cast<Bytef*>(records.data()), &raw_size,
+                                        reinterpret_cast<const Bytef*>(file.getData() + offset), block.compressed_size);
+                if (result != Z_OK || raw_size != block.raw_size)
+                    throw runtime_error("Archive block is corrupted");
+
+                visitor(block.record_count, records);
+            }
+
+            offset += block.compressed_size;
+        }
+    }
+
+    /*----------ARCHIVING----------*/
+
+    vector<Flight*> getFlightsBefore(const Datetime &cutoff) {
+        unordered_set<const Flight*> served_flights;
+        for (const HandlingCar *car : data::handlingCars) {
+            if (car->getFlight() != nullptr)
+                served_flights.insert(car->getFlight());
+        }
+
+        vector<Flight*> flights;
+        for (Flight *flight : data::flights) {
+            if (flight->getDepartureTime() < cutoff && served_flights.count(flight) == 0)
+                flights.push_back(flight);
+        }
+
+        return flights;
+    }
+
+    bool isServiceBefore(const Service &service, const Datetime &cutoff) {
+        return service.getDatetime() < cutoff;
+    }
+
+    void removeBefore(const Datetime &cutoff) {
+        // Flights served by a handling car are never archived, so no car refers to the ones removed here
+        vector<Flight*> flights = getFlightsBefore(cutoff);
+        unordered_set<const Flight*> archived_flights(flights.begin(), flights.end());
+        auto isArchived = [&archived_flights](const Flight &flight) {
+            return archived_flights.count(&flight) != 0;
+        };
+
+        if (!flights.empty()) {
+            data::flights.erase(remove_if(data::flights.begin(), data::flights.end(), [&isArchived](const Flight *flight) {
+                return isArchived(*flight);
+            }), data::flights.end());
+
+            for (Plane *plane : data::planes)
+                plane->removeAllFlights(isArchived);
+
+            flight_calendar::invalidate();
+            for (Flight *flight : flights)
+                delete flight;
+        }
+
+        for (Plane *plane : data::planes) {
+            vector<Service*> services;
+            for (Service *service : plane->getFinishedServices()) {
+                if (isServiceBefore(*service, cutoff))
+                    services.push_back(service);
+            }
+
+            plane->removeAllFinishedServices([&cutoff](const Service &service) {
+                return isServiceBefore(service, cutoff);
+            });
+
+            for (Service *service : services)
+                delete service;
+        }
+    }
+
+    ArchiveResult archiveBefore(const Datetime &cutoff) {
+        ArchiveResult result;
+        ArchiveWriter writer;
+        RecordEncoder encoder;
+        uint32_t record_count = 0;
+
+        auto flushBlock = [&](BlockKind kind) {
+            writer.addBlock(kind, record_count, encoder.getBytes());
+            encoder.clear();
+            record_count = 0;
+        };
+
+        // Archived in departure order, so older blocks hold older flights
+        vector<Flight*> flights = getFlightsBefore(cutoff);
+        stable_sort(flights.begin(), flights.end(), [](const Flight *a, const Flight *b) {
+            return a->getDepartureTime() < b->getDepartureTime();
+        });
+
+        for (const Flight *flight : flights) {
+            encodeFlight(encoder, *flight);
+            if (++record_count == FLIGHTS_PER_BLOCK)
+                flushBlock(BlockKind::FLIGHTS);
+        }
+
+        flushBlock(BlockKind::FLIGHTS);
+        result.flights = flights.size();
+
+        for (const Plane *plane : data::planes) {
+            for (const Service *service : plane->getFinishedServices()) {
+                if (!isServiceBefore(*service, cutoff))
+                    continue;
+
+                encodeService(encoder, *service);
+                result.services++;
+
+                if (++record_count == SERVICES_PER_BLOCK)
+                    flushBlock(BlockKind::SERVICES);
+            }
+        }
+
+        flushBlock(BlockKind::SERVICES);
+        writer.commit();
+
+        removeBefore(cutoff);
+        return result;
+    }
+
+    /*----------READING----------*/
+
+    /**
+     * @brief Owns the planes and airports that archived records are rebuilt around, while a block is being visited
+     */
+    class StandIns {
+        map<string, unique_ptr<Plane>> planes;
+        map<string, unique_ptr<Airport>> airports;
+
+    public:
+        Plane &getPlane(RecordDecoder &decoder) {
+            string license_plate = decoder.getString();
+            string type = decoder.getString();
+            unsigned int capacity = decoder.getUnsigned();
+
+            unique_ptr<Plane> &plane = planes[license_plate];
+            if (plane == nullptr || plane->getType() != type || plane->getCapacity() != capacity)
+                plane = make_unique<Plane>(license_plate, type, capacity);
+
+            return *plane;
+        }
+
+        Airport &getAirport(const string &name) {
+            Airport *airport = crud::findAirportByName(name);
+            if (airport != nullptr)
+                return *airport;
+
+            unique_ptr<Airport> &stand_in = airports[name];
+            if (stand_in == nullptr)
+                stand_in = make_unique<Airport>(name);
+
+            return *stand_in;
+        }
+    };
+
+    ServiceType toServiceType(uint32_t value) {
+        switch (value) {
+            case static_cast<uint32_t>(ServiceType::MAINTENANCE):
+                return ServiceType::MAINTENANCE;
+            case static_cast<uint32_t>(ServiceType::CLEANING):
+                return ServiceType::CLEANING;
+            default:
+                throw runtime_error("Unknown service type");
+        }
+    }
+
+    void forEachFlight(const function<void(const Flight&)> &visitor) {
+        forEachBlock(BlockKind::FLIGHTS, [&visitor](uint32_t record_count, string_view records) {
+            RecordDecoder decoder(records);
+            StandIns stand_ins;
+
+            for (uint32_t i = 0; i < record_count; i++) {
+                Plane &plane = stand_ins.getPlane(decoder);
+                string flight_id = decoder.getString();
+                Datetime departure_time = decoder.getDatetime();
+                Time duration = decoder.getTime();
+                Airport &origin = stand_ins.getAirport(decoder.getString());
+                Airport &destination = stand_ins.getAirport(decoder.getString());
+
+                Flight flight(flight_id, departure_time, duration, origin, destination, plane);
+
+                vector<unique_ptr<Ticket>> tickets(decoder.getUnsigned());
+                for (unique_ptr<Ticket> &ticket : tickets) {
+                    string customer_name = decoder.getString();
+                    unsigned int customer_age = decoder.getUnsigned();
+                    ticket = make_unique<Ticket>(flight, customer_name, customer_age, decoder.getUnsigned());
+                    flight.addTicket(*ticket);
+                }
+
+                vector<unique_ptr<Luggage>> luggage(decoder.getUnsigned());
+                for (unique_ptr<Luggage> &bag : luggage) {
+                    uint32_t ticket = decoder.getUnsigned();
+                    if (ticket >= tickets.size())
+                        throw runtime_error("Archived luggage refers to an unknown ticket");
+
+                    bag = make_unique<Luggage>(*tickets[ticket], decoder.getFloat());
+                    flight.addLuggage(*bag);
+                }
+
+                visitor(flight);
+            }
+        });
+    }
+
+    void forEachService(const function<void(const Service&)> &visitor) {
+        forEachBlock(BlockKind::SERVICES, [&visitor](uint32_t record_count, string_view records) {
+            RecordDecoder decoder(records);
+            StandIns stand_ins;
+
+            for (uint32_t i = 0; i < record_count; i++) {
+                Plane &plane = stand_ins.getPlane(decoder);
+                ServiceType type = toServiceType(decoder.getUnsigned());
+                Datetime datetime = decoder.getDatetime();
+
+                Service service(type, datetime, decoder.getString(), plane);
+                visitor(service);
+            }
+        });
+    }
+}
@@ -0,0 +1,92 @@
+#include "crc32c.h"
+#include <array>
+#include <cstring>
+
+using namespace std;
+
+namespace crc32c {
+
+    /** The Castagnoli polynomial, bit-reversed */
+    constexpr uint32_t POLYNOMIAL = 0x82F63B78;
+
+    /**
+     * @brief Builds the tables for slicing-by-8: table[k][b] is the checksum of byte b followed by k zero bytes
+     */
+    constexpr array<array<uint32_t, 256>, 8> makeTables() {
+        array<array<uint32_t, 256>, 8> tables = {};
+
+        for (uint32_t byte = 0; byte < 256; byte++) {
+            uint32_t crc = byte;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+
+            tables[0][byte] = crc;
+        }
+
+        for (size_t k = 1; k < 8; k++) {
+            for (uint32_t byte = 0; byte < 256; byte++)
+                tables[k][byte] = (tables[k - 1][byte] >> 8) ^ tables[0][tables[k - 1][byte] & 0xFF];
+        }
+
+        return tables;
+    }
+
+    constexpr array<array<uint32_t, 256>, 8> TABLES = makeTables();
+
+    uint32_t extendPortable(uint32_t crc, const unsigned char *data, size_t size) {
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            memcpy(&word, data, sizeof(word));
+            word ^= crc;
+
+            crc = TABLES[7][word & 0xFF] ^ TABLES[6][(word >> 8) & 0xFF]
+                  ^ TABLES[5][(word >> 16) & 0xFF] ^ TABLES[4][(word >> 24) & 0xFF]
+                  ^ TABLES[3][(word >> 32) & 0xFF] ^ TABLES[2][(word >> 40) & 0xFF]
+                  ^ TABLES[1][(word >> 48) & 0xFF] ^ TABLES[0][word >> 56];
+        }
+
+        for (; size > 0; data++, size--)
+            crc = (crc >> 8) ^ TABLES[0][(crc ^ *data) & 0xFF];
+
+        return crc;
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("sse4.2")))
+    uint32_t extendHardware(uint32_t crc, const unsigned char *data, size_t size) {
+        uint64_t crc64 = crc;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint64_t word;
+            memcpy(&word, data, sizeof(word));
+            crc64 = __builtin_ia32_crc32di(crc64, word);
+        }
+
+        crc = static_cast<uint32_t>(crc64);
+        for (; size > 0; data++, size--)
+            crc = __builtin_ia32_crc32qi(crc, *data);
+
+        return crc;
+    }
+
+    bool isHardwareAccelerated() {
+        static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+        return has_sse42;
+    }
+#else
+    uint32_t extendHardware(uint32_t crc, const unsigned char *data, size_t size) {
+        return extendPortable(crc, data, size);
+    }
+
+    bool isHardwareAccelerated() {
+        return false;
+    }
+#endif
+
+    uint32_t extend(uint32_t crc, const void *data, size_t size) {
+        const auto *bytes = static_cast<const unsigned char*>(data);
+
+        crc = ~crc;
+        crc = isHardwareAccelerated() ? extendHardware(crc, bytes, size) : extendPortable(crc, bytes, size);
+        return ~crc;
+    }
+}
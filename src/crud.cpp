@@ -2,516 +2,45 @@
 #include "utils.h"
 #include "interact.h"
 #include "state.h"
+#include "journal.h"
+#include "archive.h"
+#include "importer.h"
+#include "exporter.h"
+#include "replication.h"
+#include "flight_calendar.h"
 #include <set>
 #include <algorithm>
 #include <fstream>
+#include <iomanip>
 #include <limits>
+#include <mutex>
 
 using namespace std;
 
-namespace files {
-
-    static const string PATH = "data.txt";
-        
-    void read() {
-
-        for (const auto &el : data::airports) {
-            delete el;
-        }
-        data::airports.clear();
+namespace crud {
 
-        for (const auto &el : data::planes) {
-            delete el;
-        }
-        data::planes.clear();
-        
-        for (const auto &el : data::flights) {
-            delete el;
-        }
-        data::flights.clear();
- 
-        for (const auto &el : data::handlingCars) {
-            delete el;
-        }
-        data::handlingCars.clear();
+    Airport* findAirportByName(const string name);
+    string askUnusedName();
+    string askUsedName();
 
-        for (const auto &el : data::airports) {
-            delete el;
-        }
-        data::airports.clear();
- 
-                
-        ifstream file(PATH, ios::in);
-        if (!file.is_open())
-            return;
+    /**
+     * @brief Writes the records of a selection into a JSON lines file specified by the user
+     */
+    template <typename T>
+    void exportSelectionWithUserInput(const vector<T*> &pool) {
+        string path = readValue<GetLine>("Path of the JSON lines file: ", "Please insert a valid path");
+        cout << endl;
 
         try {
-            unsigned int N1;
-            file >> N1;
-            file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-            for (unsigned int i = 0; i < N1; i++) {
-                string name;
-                unsigned int N2;
-                
-                getline(file, name);
-                file >> N2;
-
-                Airport *airport = new Airport(name);
-
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                for (unsigned int j = 0; j < N2; j++) {
-                    string info_name, info_type;
-                    float info_lat, info_lon, info_dist;
-
-                    getline(file, info_name);
-                    file >> info_lat >> info_lon >> info_dist >> info_type;
-
-                    TransportType tt;
-                    if (info_type == "bus")
-                        tt = TransportType::BUS;
-                    else if (info_type == "subway")
-                        tt = TransportType::SUBWAY;
-                    else if (info_type == "train")
-                        tt = TransportType::TRAIN;
-                    else
-                        throw runtime_error("Unknown transport type");
-
-                    unsigned int N3;
-                    file >> N3;
-                    file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                    TransportPlace place = {
-                        .name = info_name,
-                        .latitude = info_lat,
-                        .longitude = info_lon,
-                        .transport_type = tt,
-                        .airport_distance = info_dist
-                    };
-
-                    for (int k = 0; k < N3; k++) {
-                        string time;
-                        getline(file, time);
-                        place.schedule.insert(Time::readFromString(time));
-                    }
-                    
-                    airport->addTransportPlaceInfo(place);
-                }
-                
-                data::airports.push_back(airport);
-            }
-
-
-            unsigned int N4;
-            file >> N4;
-
-            for (unsigned int j = 0; j < N4; j++) {
-                string licensePlate, type;
-                unsigned int capacity;
-                file >> licensePlate;
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                getline(file, type);
-                file >> capacity;
-
-                Plane *plane = new Plane(licensePlate, type, capacity);
-
-                unsigned int N5;
-                file >> N5;
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                for (unsigned int k = 0; k < N5; k++) {
-                    string worker, datetime, type;
-                    getline(file, worker);
-                    getline(file, datetime);
-                    getline(file, type);
-
-                    ServiceType st;
-                    if (type == "cleaning")
-                        st = ServiceType::CLEANING;
-                    else if (type == "maintenance")
-                        st = ServiceType::MAINTENANCE;
-                    else
-                        throw runtime_error("Unknown service type");
-
-                    Service *service = new Service(st, Datetime::readFromString(datetime), worker, *plane);
-                    plane->scheduleService(*service);
-                    plane->completeService();
-                }
-
-                unsigned int N6;
-                file >> N6;
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                for (unsigned int k = 0; k < N6; k++) {
-                    string worker, datetime, type;
-                    getline(file, worker);
-                    getline(file, datetime);
-                    getline(file, type);
-
-                    ServiceType st;
-                    if (type == "cleaning")
-                        st = ServiceType::CLEANING;
-                    else if (type == "maintenance")
-                        st = ServiceType::MAINTENANCE;
-                    else
-                        throw runtime_error("Unknown service type");
-
-                    Service *service = new Service(st, Datetime::readFromString(datetime), worker, *plane);
-                    plane->scheduleService(*service);
-                }
-
-                unsigned int N7;
-                file >> N7;
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                for (unsigned int k = 0; k < N7; k++) {
-                    string flightId, departureTime, duration, origin, destination;
-                    getline(file, flightId);
-                    getline(file, departureTime);
-                    getline(file, duration);
-                    getline(file, origin);
-                    getline(file, destination);
-
-                    Airport *originAirport = nullptr;
-                    for (const auto &airport : data::airports) {
-                        if (airport->getName() == origin) {
-                            originAirport = airport;
-                            break;
-                        }
-                    }
-
-                    Airport *destinationAirport = nullptr;
-                    for (const auto &airport : data::airports) {
-                        if (airport->getName() == destination) {
-                            destinationAirport = airport;
-                            break;
-                        }
-                    }
-
-                    if (originAirport == nullptr || destinationAirport == nullptr)
-                        throw runtime_error("Unknown origin or destination airports");
-
-                    Flight *flight = new Flight(flightId, Datetime::readFromString(departureTime), Time::readFromString(duration), *originAirport, *destinationAirport, *plane);
-
-                    unsigned int N8;
-                    file >> N8;
-                    file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                    for (unsigned int m = 0; m < N8; m++) {
-                        string customerName;
-                        unsigned int customerAge, seatNumber;
-                        getline(file, customerName);
-                        file >> customerAge >> seatNumber;
-                        file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                        Ticket *ticket = new Ticket(*flight, customerName, customerAge, seatNumber);
-                        flight->addTicket(*ticket);
-                    }
-
-                    unsigned int N9;
-                    file >> N9;
-                    file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                    for (unsigned int m = 0; m < N9; m++) {
-                        int index;
-                        float weight;
-                        file >> index >> weight;
-                        file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                        Luggage *luggage = new Luggage(*flight->getTickets().at(index), weight);
-                        flight->addLuggage(*luggage);
-                    }
-
-                    plane->addFlight(*flight);
-                    data::flights.push_back(flight);
-                }
-
-                data::planes.push_back(plane);
-            }
-
-            unsigned int N10;
-            file >> N10;
-
-            for (unsigned int j = 0; j < N10; j++) {
-                unsigned int number_of_carriages, stacks_per_carriage, luggage_per_stack;
-                file >> number_of_carriages >> stacks_per_carriage >> luggage_per_stack;
-
-                HandlingCar *car = new HandlingCar(number_of_carriages, stacks_per_carriage, luggage_per_stack);
-
-                string flightId;
-                file >> flightId;
-                file.ignore(numeric_limits<streamsize>::max(), '\n');
-
-                if (flightId == "none")
-                    continue;
-
-                string datetime;
-                getline(file, datetime);
-
-                Datetime dt = Datetime::readFromString(datetime);
-
-                for (const auto &flight : data::flights) {
-                    if (flight->getFlightId() == flightId && flight->getDepartureTime() == dt) {
-                        car->setFlight(*flight);
-                        break;
-                    }
-                }
-
-                if (car->getFlight() == nullptr)
-                    throw runtime_error("No flight found");
-
-                
-                unsigned int N12;
-                file >> N12;
-
-                for (unsigned int k = 0; k < N12; k++) {
-                    unsigned int index;
-                    float weight;
-
-                    file >> index >> weight;
-                    Luggage *luggage = new Luggage(*car->getFlight()->getTickets().at(index), weight);
-                    car->addLuggage(*luggage);
-                }
-
-                data::handlingCars.push_back(car);
-            }
-        } catch (exception ex) {
-            remove(PATH.c_str());
-
-            for (const auto &el : data::airports) {
-                delete el;
-            }
-            data::airports.clear();
-
-            for (const auto &el : data::planes) {
-                delete el;
-            }
-            data::planes.clear();
-            
-            for (const auto &el : data::flights) {
-                delete el;
-            }
-            data::flights.clear();
-    
-            for (const auto &el : data::handlingCars) {
-                delete el;
-            }
-            data::handlingCars.clear();
-
-            for (const auto &el : data::airports) {
-                delete el;
-            }
-            data::airports.clear();
-
+            size_t count = exporter::exportRecords(path, pool);
+            cout << "The selection was successfully exported: " << count << " records\n" << endl;
+        } catch (exception &exception) {
+            cout << "The selection could not be exported: " << exception.what() << '\n' << endl;
         }
-    }
-
-    void write() {
-        
-        ofstream file(PATH);
-        if (!file.is_open())
-            throw runtime_error("Could not open file");
-
-        try {
-
-            // Writes airport data
-            file << data::airports.size() << '\n';
-            for (Airport *airport : data::airports) {
-                file << airport->getName() << '\n'
-                    << airport->getTransportPlaceInfo().size() << '\n';
-
-                for (const auto &info : airport->getTransportPlaceInfo()) {
-                    file << info.name << '\n'
-                        << info.latitude << ' ' << info.longitude << ' ' << info.airport_distance << '\n';
-
-                    switch (info.transport_type) {
-                        case TransportType::BUS:
-                            file << "bus";
-                            break;
-                        
-                        case TransportType::SUBWAY:
-                            file << "subway";
-                            break;
-
-                        case TransportType::TRAIN:
-                            file << "train";
-                            break;
-
-                        default:
-                            throw runtime_error("Transport type not present in enum");
-                    }
-
-                    file << '\n'
-                        << info.schedule.size() << '\n';
 
-                    for (const auto &time : info.schedule) {
-                        file << time.str() << '\n';
-                    }
-                }
-            }
-            
-
-            // Writes plane data 
-            file << data::planes.size() << '\n';
-            for (Plane *plane : data::planes) {
-                file << plane->getLicensePlate() << '\n'
-                    << plane->getType() << '\n'
-                    << plane->getCapacity() << '\n';
-
-                file << plane->getFinishedServices().size() << '\n';
-                for (const auto &service : plane->getFinishedServices()) {
-                    file << service->getWorker() << '\n'
-                        << service->getDatetime().str() << '\n';
-
-                    switch (service->getType()) {
-                        case ServiceType::CLEANING:
-                            file << "cleaning";
-                            break;
-                        case ServiceType::MAINTENANCE:
-                            file << "maintenance";
-                            break;
-                        default:
-                            throw runtime_error("Service type not in enum");
-
-                    }
-                    
-                    file << '\n';
-                }
-
-                queue<Service*> scheduled_services = plane->getScheduledServices();
-
-                file << scheduled_services.size() << '\n';
-                while (!scheduled_services.empty()) {
-                    Service *service = scheduled_services.front();
-
-                    file << service->getWorker() << '\n'
-                        << service->getDatetime().str() << '\n';
-
-                    switch (service->getType()) {
-                        case ServiceType::CLEANING:
-                            file << "cleaning";
-                            break;
-                        case ServiceType::MAINTENANCE:
-                            file << "maintenance";
-                            break;
-                        default:
-                            throw runtime_error("Service type not in enum");
-                    }
-
-                    file << '\n';
-                    scheduled_services.pop();
-                }
-
-                file << plane->getFlights().size() << '\n';
-                for (const auto &flight : plane->getFlights()) {
-                    file << flight->getFlightId() << '\n'
-                        << flight->getDepartureTime().str() << '\n'
-                        << flight->getDuration().str() << '\n'
-                        << flight->getOrigin().getName() << '\n'
-                        << flight->getDestination().getName() << '\n';
-
-                    file << flight->getTickets().size() << '\n';
-                    for (const auto &ticket : flight->getTickets()) {
-                        file << ticket->getCustomerName() << '\n'
-                            << ticket->getCustomerAge() << '\n'
-                            << ticket->getSeatNumber() << '\n';
-                    }
-
-                    vector<Ticket*> tickets = flight->getTickets();
-                    
-                    file << flight->getLuggage().size() << '\n';
-                    for (const auto &luggage: flight->getLuggage()) {
-                        int index = -1;
-                        for (index = 0; index < tickets.size(); index++) {
-                            if (tickets.at(index) == &luggage->getTicket()) 
-                                break;
-                        }
-                        
-                        if (index == -1)
-                            throw runtime_error("Owner of luggage doesn't have a ticket");
-
-                        file << index << '\n'
-                            << luggage->getWeight() << '\n';
-                    }
-                }
-
-            }
-
-            // Writes HandlingCar data
-            file << data::handlingCars.size() << '\n';
-            for (HandlingCar *handlingCar : data::handlingCars) {
-                file << handlingCar->getNumberOfCarriages() << '\n'
-                    << handlingCar->getStacksPerCarriage() << '\n'
-                    << handlingCar->getLuggagePerStack() << '\n';
-
-                if (handlingCar->getFlight() == nullptr) {
-                    file << "none" << '\n';
-                    continue;
-                }
-
-                file << handlingCar->getFlight()->getFlightId() << '\n' << handlingCar->getFlight()->getDepartureTime().str() << '\n';
-
-                size_t numLuggage = 0;
-                for (const auto &carriage : handlingCar->getCarriages()) {
-                    for (const auto &stack : carriage) {
-                        numLuggage += stack.size();
-                    }
-                }
-
-                file << numLuggage << '\n';
-
-                vector<Ticket*> tickets = handlingCar->getFlight()->getTickets();
-
-                deque<Carriage> carriages = handlingCar->getCarriages();
-                while (!carriages.empty()) {
-                    Carriage carriage = carriages.front();
-                    while (!carriage.empty()) {
-                        LuggageStack luggageStack = carriage.front();
-
-                        stack<Luggage*> reversed;
-
-                        while (!luggageStack.empty()) {
-                            reversed.push(luggageStack.top());
-                            luggageStack.pop();
-                        }
-
-                        while (!reversed.empty()) {
-                            Luggage *luggage = reversed.top();
-
-                            int index = -1;
-                            for (index = 0; index < tickets.size(); index++) {
-                                if (tickets.at(index) == &luggage->getTicket()) 
-                                    break;
-                            }
-                            
-                            if (index == -1)
-                                throw runtime_error("Owner of luggage doesn't have a ticket");
-
-                            file << index << '\n'
-                                << luggage->getWeight() << '\n';
-
-                            reversed.pop();
-                        }
-
-                        carriage.pop_front();
-                    }
-                    
-                    carriages.pop_front();
-                }
-            }
-        } catch (exception ex) {
-            remove("data.txt");
-        }
+        waitForInput();
     }
-}
 
-namespace crud {
-
-    Airport* findAirportByName(const string name);
-    string askUnusedName();
-    string askUsedName();
     /*----------PLANES----------*/
 
     Plane* findPlaneByLicensePlate(const string &license_plate) {
@@ -520,6 +49,23 @@ namespace crud {
         });
     }
 
+    void insertPlane(Plane &plane) {
+        auto pos = utils::lowerBound<Plane*, string>(data::planes, plane.getLicensePlate(), [](Plane* plane) {
+            return plane->getLicensePlate();
+        });
+
+        data::planes.insert(pos, &plane);
+    }
+
+    void deletePlane(Plane &plane) {
+        list<Flight*> flights = plane.getFlights();
+        for (Flight *flight : flights)
+            deleteFlight(*flight);
+
+        data::planes.erase(find(data::planes.begin(), data::planes.end(), &plane));
+        delete &plane;
+    }
+
     string askUnusedLicensePlate() {
         return readValue<string>("License plate: ", "Please insert a valid license plate", [](const string &value) {
             Plane *plane = findPlaneByLicensePlate(value);
@@ -567,11 +113,9 @@ namespace crud {
         cout << endl;
 
         Plane *plane = new Plane(license_plate, type, capacity);
-        auto pos = utils::lowerBound<Plane*, string>(data::planes, license_plate, [](Plane* plane) {
-            return plane->getLicensePlate();
-        });
+        insertPlane(*plane);
+        journal::logPlane(*plane);
 
-        data::planes.insert(pos, plane);
         waitForInput();
     }
 
@@ -918,6 +462,35 @@ namespace crud {
         menu.show();
     }
 
+    /**
+     * @brief Displays the archived services that match a filter specified by the user, as they are read from the archive
+     */
+    void readArchivedServicesWithUserInput() {
+        ostringstream filter_repr;
+        function<bool(const Service* const&)> filter = createServiceFilter(filter_repr);
+
+        cout << "\x1B[2J\x1B[;H\x1B[32m✓\x1B[0m " << "Your filter: " << filter_repr.str() << '\n' << endl;
+
+        size_t count = 0;
+        try {
+            archive::forEachService([&filter, &count](const Service &service) {
+                if (!filter(&service))
+                    return;
+
+                cout << "Plane: " << service.getPlane().getLicensePlate() << '\n' << service << '\n' << endl;
+                count++;
+            });
+        } catch (exception &exception) {
+            cout << "\x1B[31m>>\x1B[0m The archive could not be read: " << exception.what() << '\n';
+        }
+
+        if (count == 0)
+            cout << "\x1B[31m>>\x1B[0m There are no archived services that match that filter!\n";
+
+        cout << endl;
+        waitForInput();
+    }
+
     void readAllPlanesWithUserInput() {
         vector<Plane*> pool = data::planes;
 
@@ -933,6 +506,8 @@ namespace crud {
             utils::reverse(pool);
         });
 
+        other_ops.addOption("Export the selection as JSON lines", [&pool]() { exportSelectionWithUserInput(pool); });
+
         bool is_running = true;
         MenuBlock special_block;
         special_block.addOption("Go Back", [&is_running]() { is_running = false; });
@@ -965,11 +540,13 @@ namespace crud {
         choice.addOption("Type", [&plane]() {
             string type = readValue<GetLine>("Type: ", "Please insert a valid plane type");
             plane.setType(type);
+            journal::logPlane(plane);
         });
 
         choice.addOption("Capacity", [&plane]() {
             unsigned int capacity = readValue<unsigned int>("Capacity: ", "Please insert a valid plane capacity");
             plane.setCapacity(capacity);
+            journal::logPlane(plane);
         });
 
         choice.addOption("Schedule a new service", [&plane]() {
@@ -988,11 +565,13 @@ namespace crud {
             services.addOption("Maintenance", [&plane, &datetime, &worker]() {
                 Service *service = new Service(ServiceType::MAINTENANCE, datetime, worker, plane);
                 plane.scheduleService(*service);
+                journal::logServiceScheduled(*service);
             });
 
             services.addOption("Cleaning", [&plane, &datetime, &worker]() {
                 Service *service = new Service(ServiceType::CLEANING, datetime, worker, plane);
                 plane.scheduleService(*service);
+                journal::logServiceScheduled(*service);
             });
 
             serviceType.addBlock(services);
@@ -1001,6 +580,7 @@ namespace crud {
 
         choice.addOption("Complete the next service", [&plane] {
             if (plane.completeService()) {
+                journal::logServiceCompleted(plane);
                 cout << "The next service was marked as completed!\n" << endl;
             } else {    
                 cout << "There are no scheduled services!\n" << endl;
@@ -1026,29 +606,21 @@ namespace crud {
      * @brief Deletes one Plane instance specified by the user
      */
     void deleteOnePlane() {
-        Plane const &plane = findPlane();
-        for (auto it = data::planes.begin(), end = data::planes.end(); it != end; it++) {
-            if (*it == &plane) {
-                data::planes.erase(it);
-                delete &plane;
-
-                waitForInput();
-                return;
-            }
-        }
+        Plane &plane = findPlane();
+        journal::logPlaneDeleted(plane);
+        deletePlane(plane);
 
-        delete &plane;
-        throw logic_error("No planes were deleted");
+        waitForInput();
     }
 
     /**
      * @brief Deletes every Plane instance
      */
     void deleteAllPlanes() {
-        for (const Plane *plane : data::planes)
-            delete plane;
-
-        data::planes.clear();
+        while (!data::planes.empty()) {
+            journal::logPlaneDeleted(*data::planes.back());
+            deletePlane(*data::planes.back());
+        }
     }
 
     void deleteAllPlanesWithUserInput() {
@@ -1068,24 +640,12 @@ namespace crud {
 
         MenuBlock erase;
         erase.addOption("Delete all planes in this selection", [&pool]() {
-            vector<Plane*> new_planes;
-            
-            for (Plane *plane1 : data::planes) {
-                bool was_selected = false;
-
-                for (Plane *plane2 : pool) {
-                    if (plane1 == plane2)
-                        was_selected = true;
-                        break;
-                }
-
-                if (was_selected)
-                    delete plane1;
-                else
-                    new_planes.push_back(plane1);
+            for (Plane *plane : pool) {
+                journal::logPlaneDeleted(*plane);
+                deletePlane(*plane);
             }
 
-            data::planes = pool = new_planes;
+            pool.clear();
         });
 
         bool is_running = true;
@@ -1137,6 +697,7 @@ namespace crud {
         ohno.addOption("Read one plane", allowWhenPlanesExist(readOnePlane));
         ohno.addOption("Read all planes", allowWhenPlanesExist(readAllPlanes));
         ohno.addOption("Read all planes with filters and sort", allowWhenPlanesExist(readAllPlanesWithUserInput));
+        ohno.addOption("Read archived services with filters", readArchivedServicesWithUserInput);
 
         MenuBlock remove;
         remove.addOption("Delete one plane", allowWhenPlanesExist(deleteOnePlane));
@@ -1167,7 +728,7 @@ namespace crud {
         if (it == data::flights.end())
             return result;
 
-        while ((*it)->getFlightId() == flight_id && it != data::flights.end())
+        while (it != data::flights.end() && (*it)->getFlightId() == flight_id)
             result.push_back(*(it++));
 
         return result;
@@ -1183,6 +744,34 @@ namespace crud {
         return nullptr;
     }
 
+    void insertFlight(Flight &flight) {
+        auto pos = utils::lowerBound<Flight*, string>(data::flights, flight.getFlightId(), [](const Flight* flight) {
+            return flight->getFlightId();
+        });
+
+        data::flights.insert(pos, &flight);
+        flight.getPlane().addFlight(flight);
+        flight_calendar::add(flight);
+    }
+
+    void rescheduleFlight(Flight &flight, Datetime &departure_time) {
+        Datetime old_departure_time = flight.getDepartureTime();
+        flight.setDepartureTime(departure_time);
+        flight_calendar::move(flight, old_departure_time);
+    }
+
+    void deleteFlight(Flight &flight) {
+        for (HandlingCar *car : data::handlingCars) {
+            if (car->getFlight() == &flight)
+                car->clearFlight();
+        }
+
+        flight_calendar::remove(flight);
+        flight.getPlane().removeFlight(flight);
+        data::flights.erase(find(data::flights.begin(), data::flights.end(), &flight));
+        delete &flight;
+    }
+
     pair<string, Datetime> askUnusedFlightKey() {
         string id = readValue<string>("Flight ID: ", "Please insert a valid flight ID");
         Datetime datetime = Datetime::readFromString(
@@ -1272,13 +861,8 @@ namespace crud {
         );
 
         Flight *flight = new Flight(flight_key.first, flight_key.second, duration, origin, destination, plane);
-        plane.addFlight(*flight);
-
-        auto pos = utils::lowerBound<Flight*, string>(data::flights, flight->getFlightId(), [](const Flight* flight) {
-            return flight->getFlightId();
-        });
-
-        data::flights.insert(pos, flight);
+        insertFlight(*flight);
+        journal::logFlightCreated(*flight);
 
         cout << endl;
         waitForInput();
@@ -1316,6 +900,32 @@ namespace crud {
         waitForInput();
     }
 
+    /**
+     * @brief Displays the flights that depart in a time window, in departure order
+     */
+    void readFlightsDepartingBetween() {
+        auto readDatetime = [](const string &prompt) {
+            return Datetime::readFromString(
+                readValue<GetLine>(prompt, "Please insert a valid date and time", [](const string &value) {
+                    Datetime::readFromString(value);
+                    return true;
+                })
+            );
+        };
+
+        Datetime begin = readDatetime("Departing from (date and time): ");
+        Datetime end = readDatetime("Departing before (date and time): ");
+        cout << endl;
+
+        vector<Flight*> flights = flight_calendar::findDepartures(begin, end);
+        if (flights.empty())
+            cout << "No flights depart in that time window" << endl;
+        else
+            cout << getFlightRepresentation(flights) << endl;
+
+        waitForInput();
+    }
+
     function<bool(const Flight* const&)> createFlightFilter(ostringstream &repr) {
         Menu menu("Please specify a value to use as a filter:");
         function<bool(const Flight* const&)> filter;
@@ -1518,6 +1128,8 @@ namespace crud {
             utils::reverse(pool);
         });
 
+        other_ops.addOption("Export the selection as JSON lines", [&pool]() { exportSelectionWithUserInput(pool); });
+
         bool is_running = true;
         MenuBlock special_block;
         special_block.addOption("Go Back", [&is_running]() { is_running = false; });
@@ -1539,6 +1151,35 @@ namespace crud {
         }
     }
 
+    /**
+     * @brief Displays the archived flights that match a filter specified by the user, as they are read from the archive
+     */
+    void readArchivedFlightsWithUserInput() {
+        ostringstream filter_repr;
+        function<bool(const Flight* const&)> filter = createFlightFilter(filter_repr);
+
+        cout << "\x1B[2J\x1B[;H\x1B[32m✓\x1B[0m " << "Your filter: " << filter_repr.str() << '\n' << endl;
+
+        size_t count = 0;
+        try {
+            archive::forEachFlight([&filter, &count](const Flight &flight) {
+                if (!filter(&flight))
+                    return;
+
+                cout << flight << endl;
+                count++;
+            });
+        } catch (exception &exception) {
+            cout << "\x1B[31m>>\x1B[0m The archive could not be read: " << exception.what() << '\n';
+        }
+
+        if (count == 0)
+            cout << "\x1B[31m>>\x1B[0m There are no archived flights that match that filter!\n";
+
+        cout << endl;
+        waitForInput();
+    }
+
     /**
      * @brief Updates one Plane instance
      */
@@ -1561,7 +1202,9 @@ namespace crud {
                 })
             );
             
-            flight.setDepartureTime(datetime);
+            Datetime departure_time = flight.getDepartureTime();
+            rescheduleFlight(flight, datetime);
+            journal::logFlightUpdated(flight, departure_time);
         });
 
         choice.addOption("Duration", [&flight]() {
@@ -1573,6 +1216,7 @@ namespace crud {
             );
 
             flight.setDuration(duration);
+            journal::logFlightUpdated(flight, flight.getDepartureTime());
         });
 
         choice.addOption("Origin airport", [&flight]() {
@@ -1596,6 +1240,7 @@ namespace crud {
             );
 
             flight.setOrigin(airport);
+            journal::logFlightUpdated(flight, flight.getDepartureTime());
         });
         
         choice.addOption("Destination airport", [&flight]() {
@@ -1619,6 +1264,7 @@ namespace crud {
             );
 
             flight.setDestination(airport);
+            journal::logFlightUpdated(flight, flight.getDepartureTime());
         });
 
         MenuBlock tickets;
@@ -1645,29 +1291,21 @@ namespace crud {
      * @brief Deletes one Plane instance specified by the user
      */
     void deleteOneFlight() {
-        Flight const &flight = findFlight();
-        for (auto it = data::flights.begin(), end = data::flights.end(); it != end; it++) {
-            if (*it == &flight) {
-                data::flights.erase(it);
-                delete &flight;
-
-                waitForInput();
-                return;
-            }
-        }
+        Flight &flight = findFlight();
+        journal::logFlightDeleted(flight);
+        deleteFlight(flight);
 
-        delete &flight;
-        throw logic_error("No flights were deleted");
+        waitForInput();
     }
 
     /**
      * @brief Deletes every Plane instance
      */
     void deleteAllFlights() {
-        for (const Flight *flight : data::flights)
-            delete flight;
-
-        data::flights.clear();
+        while (!data::flights.empty()) {
+            journal::logFlightDeleted(*data::flights.back());
+            deleteFlight(*data::flights.back());
+        }
     }
 
     void deleteAllFlightsWithUserInput() {
@@ -1687,24 +1325,12 @@ namespace crud {
 
         MenuBlock erase;
         erase.addOption("Delete all flights in this selection", [&pool]() {
-            vector<Flight*> new_flights;
-            
-            for (Flight *flight1 : data::flights) {
-                bool was_selected = false;
-
-                for (Flight *flight2 : pool) {
-                    if (flight1 == flight2)
-                        was_selected = true;
-                        break;
-                }
-
-                if (was_selected)
-                    delete flight1;
-                else
-                    new_flights.push_back(flight1);
+            for (Flight *flight : pool) {
+                journal::logFlightDeleted(*flight);
+                deleteFlight(*flight);
             }
 
-            data::flights = pool = new_flights;
+            pool.clear();
         });
 
         bool is_running = true;
@@ -1752,6 +1378,8 @@ namespace crud {
         ohno.addOption("Read one flight", allowWhenFlightsExist(readOneFlight));
         ohno.addOption("Read all flights", allowWhenFlightsExist(readAllFlights));
         ohno.addOption("Read all flights with filters and sort", allowWhenFlightsExist(readAllFlightsWithUserInput));
+        ohno.addOption("Read flights departing in a time window", allowWhenFlightsExist(readFlightsDepartingBetween));
+        ohno.addOption("Read archived flights with filters", readArchivedFlightsWithUserInput);
 
         MenuBlock remove;
         remove.addOption("Delete one flight", allowWhenFlightsExist(deleteOneFlight));
@@ -1777,10 +1405,13 @@ namespace crud {
         if (seat_number >= flight.getPlane().getCapacity())
             throw validation_error("Seat number must be smaller than the plane's capacity");
 
-        vector<Ticket*> tickets = flight.getTickets();
-        return utils::binarySearch<Ticket*, unsigned int>(tickets, seat_number, [](Ticket* ticket) {
-            return ticket->getSeatNumber();
+        // Searches the flight's own tickets rather than a copy, so a lookup doesn't cost as much as the flight is large
+        const vector<Ticket*> &tickets = flight.getTickets();
+        auto it = lower_bound(tickets.begin(), tickets.end(), seat_number, [](const Ticket *ticket, unsigned int seat_number) {
+            return ticket->getSeatNumber() < seat_number;
         });
+
+        return it != tickets.end() && (*it)->getSeatNumber() == seat_number ? *it : nullptr;
     }
 
     Ticket* findTicketByFlightAndCustomer(Flight &flight, const string &name) {
@@ -1793,6 +1424,30 @@ namespace crud {
         return nullptr;
     }
 
+    /** Serializes the bookings made through bookTicket, which may come from several threads */
+    static mutex booking_mutex;
+
+    Ticket* bookTicket(Flight &flight, const string &customer_name, unsigned int customer_age, unsigned int seat_number) {
+        Ticket *ticket;
+        {
+            lock_guard<mutex> lock(booking_mutex);
+            if (findTicketsBySeatNumber(flight, seat_number) != nullptr)
+                return nullptr;
+
+            ticket = new Ticket(flight, customer_name, customer_age, seat_number);
+            if (!flight.addTicket(*ticket)) {
+                delete ticket;
+                return nullptr;
+            }
+
+            journal::logTicket(*ticket);
+        }
+
+        // Waits outside the lock, so other bookings can be written while this one is flushed
+        journal::sync();
+        return ticket;
+    }
+
     unsigned int askUnusedSeatNumber(Flight &flight) {
         return readValue<unsigned int>("Seat number: ", "Please insert a valid seat number", [&flight](const unsigned int seat_number) {
             return findTicketsBySeatNumber(flight, seat_number) == nullptr;
@@ -1830,7 +1485,10 @@ namespace crud {
         unsigned int seat_number = askUnusedSeatNumber(flight);
         cout << endl;
         
+        // The ticket is added before any of its luggage is loaded, since the data may be saved while the menus below are shown
         Ticket *ticket = new Ticket(flight, name, age, seat_number);
+        flight.addTicket(*ticket);
+        journal::logTicket(*ticket);
 
         unsigned int number_luggage = readValue<unsigned int>("Number of luggage pieces: ", "Please provide a valid number of luggage pieces");
         cout << endl;
@@ -1848,6 +1506,7 @@ namespace crud {
                 for (const auto &car : data::handlingCars) {
                     if (car->getFlight() == &flight) {
                         if (car->addLuggage(*luggage)) {
+                            journal::logLuggageLoaded(*car, *ticket, weight);
                             cout << "The luggage was sucessfuly loaded into Car #" << car->getId() << '\n' << endl;
                             waitForInput();
                             return;
@@ -1867,7 +1526,7 @@ namespace crud {
             aproval.show();
         }
 
-        flight.addTicket(*ticket);
+        journal::sync();
         waitForInput();
     }
     
@@ -2031,6 +1690,8 @@ namespace crud {
             utils::reverse(pool);
         });
 
+        other_ops.addOption("Export the selection as JSON lines", [&pool]() { exportSelectionWithUserInput(pool); });
+
         bool is_running = true;
         MenuBlock special_block;
         special_block.addOption("Go Back", [&is_running]() { is_running = false; });
@@ -2070,22 +1731,27 @@ namespace crud {
                 throw logic_error("No ticket was removed");
             }
 
+            journal::logTicketDeleted(ticket);
             delete &ticket;
 
             if (!flight.addTicket(*new_ticket)) {
                 delete new_ticket;
                 throw logic_error("No ticket was added");
             }
+
+            journal::logTicket(*new_ticket);
         });
 
         choice.addOption("Customer name", [&ticket, &flight](){
             string name = readValue<GetLine>("Customer name: ", "Please insert a valid customer name");
             ticket.setCustomerName(name);
+            journal::logTicket(ticket);
         });
 
         choice.addOption("Customer age", [&ticket, &flight]() {
             unsigned int age = readValue<unsigned int>("Customer age: ", "Please insert a valid customer age");
             ticket.setCustomerAge(age);
+            journal::logTicket(ticket);
         });
 
         bool is_running = true;
@@ -2105,6 +1771,7 @@ namespace crud {
         Ticket const &ticket = findTicket(flight);
 
         if (flight.removeTicket(ticket)) {
+            journal::logTicketDeleted(ticket);
             delete &ticket;
 
             waitForInput();
@@ -2117,6 +1784,7 @@ namespace crud {
 
     void deleteAllTickets(Flight &flight) {
         for (const Ticket *ticket : flight.getTickets()) {
+            journal::logTicketDeleted(*ticket);
             delete ticket;
         }
 
@@ -2152,10 +1820,12 @@ namespace crud {
                     }
                 }
 
-                if (was_selected)
+                if (was_selected) {
+                    journal::logTicketDeleted(*ticket1);
                     delete ticket1;
-                else
+                } else {
                     new_tickets.push_back(ticket1);
+                }
             }
 
             pool = new_tickets;
@@ -2245,6 +1915,19 @@ namespace crud {
         });
     }
 
+    void insertAirport(Airport &airport) {
+        auto pos = utils::lowerBound<Airport*, string>(data::airports, airport.getName(), [](Airport* airport) {
+            return airport->getName();
+        });
+
+        data::airports.insert(pos, &airport);
+    }
+
+    void deleteAirport(Airport &airport) {
+        data::airports.erase(find(data::airports.begin(), data::airports.end(), &airport));
+        delete &airport;
+    }
+
     string askUnusedName() {
         return readValue<GetLine>("Airport name: ", "Please insert a valid airport name",[](const string &value) {
             Airport *airport = findAirportByName(value);
@@ -2288,11 +1971,9 @@ namespace crud {
         cout << endl;
         
         Airport *airport = new Airport(name);
-        auto pos = utils::lowerBound<Airport*, string>(data::airports, name, [](Airport* airport) {
-            return airport->getName();
-        });
+        insertAirport(*airport);
+        journal::logAirport(*airport);
 
-        data::airports.insert(pos, airport);
         waitForInput();
     }
 
@@ -2470,6 +2151,8 @@ namespace crud {
             utils::reverse(pool);
         });
 
+        other_ops.addOption("Export the selection as JSON lines", [&pool]() { exportSelectionWithUserInput(pool); });
+
         bool is_running = true;
         MenuBlock special_block;
         special_block.addOption("Go Back", [&is_running]() { is_running = false; });
@@ -2544,6 +2227,7 @@ namespace crud {
 
             TransportPlace place = { name, latitude, longitude, type, airport_distance, schedule };
             airport.addTransportPlaceInfo(place);
+            journal::logAirport(airport);
         });
 
         choice.addOption("Remove stop", [&airport]() {
@@ -2555,6 +2239,7 @@ namespace crud {
 
             if (airport.getTransportPlaceInfo().size() == 1) {
                 airport.removeAllTransportPlaceInfo();
+                journal::logAirport(airport);
                 return;
             }
 
@@ -2568,9 +2253,13 @@ namespace crud {
             });
 
             airport.removeTransportPlaceInfo(name);
+            journal::logAirport(airport);
         });
         
-        choice.addOption("Remove all stops", [&airport]() { airport.removeAllTransportPlaceInfo(); });
+        choice.addOption("Remove all stops", [&airport]() {
+            airport.removeAllTransportPlaceInfo();
+            journal::logAirport(airport);
+        });
 
         bool is_running = true;
         MenuBlock special_block;
@@ -2585,26 +2274,18 @@ namespace crud {
     }
 
     void deleteOneAirport() {
-        Airport const &airport = findAirport();
-        for (auto it = data::airports.begin(), end = data::airports.end(); it != end; it++) {
-            if (*it == &airport) {
-                data::airports.erase(it);
-                delete &airport;
-
-                waitForInput();
-                return;
-            }
-        }
+        Airport &airport = findAirport();
+        journal::logAirportDeleted(airport);
+        deleteAirport(airport);
 
-        delete &airport;
-        throw logic_error("No airports were deleted");
+        waitForInput();
     }
 
     void deleteAllAirports() {
-        for (const Airport *airport : data::airports)
-            delete airport;
-
-        data::airports.clear();
+        while (!data::airports.empty()) {
+            journal::logAirportDeleted(*data::airports.back());
+            deleteAirport(*data::airports.back());
+        }
     }
 
     void deleteAllAirportsWithUserInput(){
@@ -2624,24 +2305,12 @@ namespace crud {
 
         MenuBlock erase;
         erase.addOption("Delete all planes in this selection", [&pool]() {
-            vector<Airport*> new_airports;
-            
-            for (Airport *airport1 : data::airports) {
-                bool was_selected = false;
-
-                for (Airport *airport2 : pool) {
-                    if (airport1 == airport2)
-                        was_selected = true;
-                        break;
-                }
-
-                if (was_selected)
-                    delete airport1;
-                else
-                    new_airports.push_back(airport1);
+            for (Airport *airport : pool) {
+                journal::logAirportDeleted(*airport);
+                deleteAirport(*airport);
             }
 
-            data::airports = pool = new_airports;
+            pool.clear();
         });
 
         bool is_running = true;
@@ -2717,6 +2386,25 @@ namespace crud {
         });
     }
 
+    void insertCar(HandlingCar &car) {
+        auto pos = utils::lowerBound<HandlingCar*, unsigned int>(data::handlingCars, car.getId(), [](HandlingCar *car) {
+            return car->getId();
+        });
+
+        data::handlingCars.insert(pos, &car);
+    }
+
+    void deleteCar(HandlingCar &car) {
+        data::handlingCars.erase(find(data::handlingCars.begin(), data::handlingCars.end(), &car));
+        delete &car;
+    }
+
+    void unloadCar(HandlingCar &car) {
+        Luggage *luggage;
+        while ((luggage = car.unloadNextLuggage()) != nullptr)
+            car.getFlight()->addLuggage(*luggage);
+    }
+
     unsigned int askUsedId() {
         return readValue<unsigned int>("ID: ", "Please input a valid ID", [](const unsigned int &value) {
             HandlingCar *car = findCarById(value);
@@ -2752,11 +2440,9 @@ namespace crud {
         cout << endl;
 
         HandlingCar *car = new HandlingCar(number_of_carriages, stacks_per_carriage, luggage_per_stack);
-        auto pos = utils::lowerBound<HandlingCar*, unsigned int>(data::handlingCars, car->getId(), [](HandlingCar *car) {
-            return car->getId();
-        });
+        insertCar(*car);
+        journal::logHandlingCarCreated(*car);
 
-        data::handlingCars.insert(pos, car);
         waitForInput();
     }
 
@@ -2768,6 +2454,7 @@ namespace crud {
         choice.addOption("Change flight to load luggage into", [&car]() {
             Flight &flight = findFlight();
             car.setFlight(flight);
+            journal::logHandlingCarFlight(car);
 
             cout << "Successfully set the flight to load luggage into\n" << endl;
             waitForInput();
@@ -2780,9 +2467,8 @@ namespace crud {
                 return;
             }
 
-            Luggage *luggage;
-            while((luggage = car.unloadNextLuggage()) != nullptr)
-                car.getFlight()->addLuggage(*luggage);
+            unloadCar(car);
+            journal::logHandlingCarUnloaded(car);
 
             cout << "Every piece of luggage was unloaded into the plane\n" << endl;
             waitForInput();
@@ -2964,6 +2650,8 @@ namespace crud {
             utils::reverse(pool);
         });
 
+        other_ops.addOption("Export the selection as JSON lines", [&pool]() { exportSelectionWithUserInput(pool); });
+
         bool is_running = true;
         MenuBlock special_block;
         special_block.addOption("Go Back", [&is_running]() { is_running = false; });
@@ -2986,25 +2674,18 @@ namespace crud {
     }
 
     void deleteOneCar() {
-        HandlingCar const &car = findCar();
-        for (auto it = data::handlingCars.begin(), end = data::handlingCars.end(); it != end; it++) {
-            if (*it == &car) {
-                data::handlingCars.erase(it);
-                delete &car;
-                waitForInput();
-                return;
-            }
-        }
+        HandlingCar &car = findCar();
+        journal::logHandlingCarDeleted(car);
+        deleteCar(car);
 
-        delete &car;
-        throw logic_error("No cars were deleted");
+        waitForInput();
     }
 
     void deleteAllCars() {
-        for (const HandlingCar *car : data::handlingCars)
-            delete car;
-
-        data::handlingCars.clear();
+        while (!data::handlingCars.empty()) {
+            journal::logHandlingCarDeleted(*data::handlingCars.back());
+            deleteCar(*data::handlingCars.back());
+        }
     }
 
     void deleteAllCarsWithUserInput() {
@@ -3024,24 +2705,12 @@ namespace crud {
 
         MenuBlock erase;
         erase.addOption("Delete all planes in this selection", [&pool]() {
-            vector<HandlingCar*> new_cars;
-            
-            for (HandlingCar *car1 : data::handlingCars) {
-                bool was_selected = false;
-
-                for (HandlingCar *car2 : pool) {
-                    if (car1 == car2)
-                        was_selected = true;
-                        break;
-                }
-
-                if (was_selected)
-                    delete car1;
-                else
-                    new_cars.push_back(car1);
+            for (HandlingCar *car : pool) {
+                journal::logHandlingCarDeleted(*car);
+                deleteCar(*car);
             }
 
-            data::handlingCars = pool = new_cars;
+            pool.clear();
         });
 
         bool is_running = true;
@@ -3193,4 +2862,253 @@ namespace crud {
 
         return filter;
     }
-}
\ No newline at end of file
+
+    /*----------FILES----------*/
+
+    /**
+     * @brief Replaces the current data with the contents of a text file specified by the user
+     */
+    void importTextFile() {
+        string path = readValue<GetLine>("Path of the text file: ", "Please insert a valid path", [](const string &value) {
+            if (!ifstream(value).is_open())
+                throw validation_error("That file could not be opened");
+
+            return true;
+        });
+        cout << endl;
+
+        // The current data is saved first, so that it can be restored if the import fails
+        files::write();
+
+        try {
+            files::readText(path);
+            files::write();
+            cout << "The data was successfully imported\n" << endl;
+        } catch (exception &exception) {
+            files::read();
+            cout << "The file could not be imported: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Adds the contents of a directory of CSV files, specified by the user, to the current data
+     */
+    void importCsvFeed() {
+        string directory = readValue<GetLine>("Directory of the CSV files: ", "Please insert a valid directory");
+        cout << endl;
+
+        try {
+            importer::ImportResult result = importer::importCsv(importer::findCsvSources(directory));
+            files::write();
+
+            cout << "The feed was successfully imported:\n"
+                 << "  " << result.airports << " airports\n"
+                 << "  " << result.planes << " planes\n"
+                 << "  " << result.flights << " flights\n"
+                 << "  " << result.tickets << " tickets\n"
+                 << "  " << result.luggage << " pieces of luggage\n" << endl;
+        } catch (exception &exception) {
+            cout << "The feed could not be imported: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Adds the airports and routes of the OpenFlights dataset, from a directory specified by the user, to the current data
+     */
+    void importOpenFlightsDataset() {
+        string directory = readValue<GetLine>("Directory of the OpenFlights files: ", "Please insert a valid directory");
+
+        importer::OpenFlightsOptions options;
+        options.first_day = Date::readFromString(
+            readValue<GetLine>("Day of the first flights: ", "Please insert a valid date", [](const string &value) {
+                Date::readFromString(value);
+                return true;
+            })
+        );
+
+        options.days = readValue<unsigned int>("Days of flights: ", "Please insert a valid number of days");
+        options.capacity = readValue<unsigned int>("Capacity of the planes: ", "Please insert a valid capacity");
+        cout << endl;
+
+        try {
+            importer::ImportResult result = importer::importOpenFlights(importer::findOpenFlightsSources(directory), options);
+            files::write();
+
+            cout << "The dataset was successfully imported:\n"
+                 << "  " << result.airports << " airports\n"
+                 << "  " << result.planes << " planes\n"
+                 << "  " << result.flights << " flights\n"
+                 << "  " << result.skipped << " routes skipped\n" << endl;
+        } catch (exception &exception) {
+            cout << "The dataset could not be imported: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Writes the current data into a text file specified by the user
+     */
+    void exportTextFile() {
+        string path = readValue<GetLine>("Path of the text file: ", "Please insert a valid path");
+        cout << endl;
+
+        try {
+            files::writeText(path);
+            cout << "The data was successfully exported\n" << endl;
+        } catch (exception &exception) {
+            cout << "The data could not be exported: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Writes every record, one JSON lines file per kind, into a directory specified by the user
+     */
+    void exportJsonLines() {
+        string directory = readValue<GetLine>("Directory of the JSON lines files: ", "Please insert a valid directory");
+        cout << endl;
+
+        try {
+            size_t count = exporter::exportAll(directory);
+            cout << "The data was successfully exported: " << count << " records\n" << endl;
+        } catch (exception &exception) {
+            cout << "The data could not be exported: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Moves the flights and finished services older than a date specified by the user into the archive
+     */
+    void archiveOldRecords() {
+        Datetime cutoff = Datetime::readFromString(
+            readValue<GetLine>("Archive everything before (date and time): ", "Please insert a valid date and time", [](const string &value) {
+                Datetime::readFromString(value);
+                return true;
+            })
+        );
+        cout << endl;
+
+        try {
+            archive::ArchiveResult result = archive::archiveBefore(cutoff);
+            journal::logArchived(cutoff);
+
+            cout << "Archived " << result.flights << " flights and " << result.services << " finished services\n" << endl;
+        } catch (exception &exception) {
+            cout << "The records could not be archived: " << exception.what() << '\n' << endl;
+        }
+
+        waitForInput();
+    }
+
+    /**
+     * @brief Displays how long each phase of the last load took
+     */
+    void showLoadStats() {
+        const files::LoadStats &stats = files::load_stats;
+
+        ostringstream repr;
+        repr << fixed << setprecision(2)
+             << "Mapping:        " << stats.mapping << " ms\n"
+             << "Verification:   " << stats.verification << " ms\n"
+             << "Airports:       " << stats.airports << " ms\n"
+             << "Planes:         " << stats.planes << " ms\n"
+             << "Flights:        " << stats.flights << " ms\n"
+             << "Handling cars:  " << stats.handling_cars << " ms\n"
+             << "Indexing:       " << stats.indexing << " ms\n"
+             << "Journal replay: " << stats.journal << " ms\n"
+             << "Total:          " << stats.total << " ms\n";
+
+        if (!stats.quarantined.empty()) {
+            repr << "\nLeft out as corrupt:\n";
+            for (const string &what : stats.quarantined)
+                repr << "  " << what << "\n";
+        }
+
+        if (!stats.kept_copies.empty()) {
+            repr << "\nCorrupt files kept aside:\n";
+            for (const string &path : stats.kept_copies)
+                repr << "  " << path << "\n";
+        }
+
+        cout << repr.str() << endl;
+        waitForInput();
+    }
+
+    /**
+     * @brief Displays how the background saves have gone so far
+     */
+    void showAutosaveStats() {
+        files::AutosaveStats stats = files::getAutosaveStats();
+
+        ostringstream repr;
+        repr << fixed << setprecision(2)
+             << "Saves:          " << stats.count << '\n'
+             << "Failed saves:   " << stats.failures << '\n'
+             << "Last pause:     " << stats.last_pause << " ms\n"
+             << "Longest pause:  " << stats.max_pause << " ms\n"
+             << "Last duration:  " << stats.last_duration << " ms\n";
+
+        cout << repr.str() << endl;
+        waitForInput();
+    }
+
+    /**
+     * @brief Displays how the standbys of this process are keeping up, and how this process kept up with its primary
+     */
+    void showReplicationStats() {
+        replication::PrimaryStats primary = replication::getPrimaryStats();
+        replication::StandbyStats standby = replication::getStandbyStats();
+
+        ostringstream repr;
+        repr << fixed << setprecision(2)
+             << "As a primary\n"
+             << "Standbys:           " << primary.standbys << '\n'
+             << "Snapshots sent:     " << primary.snapshots << '\n'
+             << "Bytes shipped:      " << primary.shipped_bytes << '\n'
+             << "Bytes acknowledged: " << primary.acknowledged_bytes << '\n'
+             << "Lag:                " << primary.lag << " ms\n\n"
+             << "As a standby\n"
+             << "Snapshots received: " << standby.snapshots << '\n'
+             << "Records applied:    " << standby.records << '\n'
+             << "Bytes applied:      " << standby.bytes << '\n'
+             << "Time applying:      " << standby.apply_time << " ms\n"
+             << "Throughput:         " << (standby.apply_time > 0 ? standby.records / standby.apply_time * 1000 : 0) << " records/s\n"
+             << "Lag:                " << standby.lag << " ms\n";
+
+        cout << repr.str() << endl;
+        waitForInput();
+    }
+
+    void manageFiles() {
+        Menu menu("Select one of the following operations:");
+
+        MenuBlock text;
+        text.addOption("Import data from a text file", importTextFile);
+        text.addOption("Export data to a text file", exportTextFile);
+        text.addOption("Export everything as JSON lines", exportJsonLines);
+        text.addOption("Import a feed of CSV files", importCsvFeed);
+        text.addOption("Import the OpenFlights dataset", importOpenFlightsDataset);
+        text.addOption("Archive old flights and services", archiveOldRecords);
+        text.addOption("Show load statistics", showLoadStats);
+        text.addOption("Show autosave statistics", showAutosaveStats);
+        text.addOption("Show replication statistics", showReplicationStats);
+
+        bool is_running = true;
+        MenuBlock special_block;
+        special_block.addOption("Go back", [&is_running]() { is_running = false; });
+
+        menu.addBlock(text);
+        menu.setSpecialBlock(special_block);
+
+        while (is_running)
+            menu.show();
+    }
+}
@@ -1,8 +1,8 @@
 #include "datetime.h"
 #include "interact.h"
+#include <bit>
+#include <cstring>
 #include <stdexcept>
-#include <iomanip>
-#include <sstream>
 
 using namespace std;
 
@@ -52,75 +52,120 @@ unsigned int Date::getYear() const {
     return this->year;
 }
 
-Time::Time(unsigned int hour, unsigned int minute) {
+void Time::setHour(unsigned int hour) {
     if (0 <= hour && hour < 24)
         this->hour = hour;
     else
         throw invalid_argument("Hour value must be between 0 and 23");
+}
+
+void Time::setMinute(unsigned int minute) {
     if (0 <= minute && minute < 60)
         this->minute = minute;
     else
         throw invalid_argument("Minute value must be between 0 and 59");
 }
 
-Time::Time(const Time &time) {
-    this->hour = time.hour;
-    this->minute = time.minute;
+ostream &operator<<(ostream &os, const Datetime &datetime) {
+    return os << datetime.str() << '\n';
 }
 
-void Time::setHour(unsigned int hour) {
-    if (0 <= hour && hour < 24)
-        this->hour = hour;
-    else
-        throw invalid_argument("Hour value must be between 0 and 23");
+Date Date::plusDays(unsigned int days) const {
+    calendar::CivilDate date = calendar::civilFromDays(calendar::daysFromCivil(this->year, this->month, this->day) + days);
+    return Date(date.day, date.month, date.year);
 }
 
-void Time::setMinute(unsigned int minute) {
-    if (0 <= minute && minute < 60)
-        this->minute = minute;
-    else
-        throw invalid_argument("Minute value must be between 0 and 59");
+Datetime::operator Date() const {
+    calendar::CivilDate date = this->getCivilDate();
+    return Date(date.day, date.month, date.year);
 }
 
-unsigned int Time::getHour() const {
-    return this->hour;
+void Datetime::setDay(unsigned int day) {
+    calendar::CivilDate date = this->getCivilDate();
+    *this = Datetime(date.year, date.month, day, this->getHour(), this->getMinute());
 }
 
-unsigned int Time::getMinute() const {
-    return this->minute;
+void Datetime::setMonth(unsigned int month) {
+    calendar::CivilDate date = this->getCivilDate();
+    *this = Datetime(date.year, month, date.day, this->getHour(), this->getMinute());
 }
 
-Datetime::Datetime(unsigned int year, unsigned int month, unsigned int day, unsigned int hour, unsigned int minute) : Date(day, month, year), Time(hour, minute) {}
-Datetime::Datetime(const Datetime &datetime) : Datetime(datetime.getYear(), datetime.getMonth(), datetime.getDay(), datetime.getHour(), datetime.getMinute()) {};
+void Datetime::setYear(unsigned int year) {
+    calendar::CivilDate date = this->getCivilDate();
+    *this = Datetime(year, date.month, date.day, this->getHour(), this->getMinute());
+}
 
-string Datetime::str() const {
-    ostringstream out;
-    out << Date::str() << ' ' << Time::str();
+void Datetime::setHour(unsigned int hour) {
+    Time time(hour, this->getMinute());
+    this->minutes = this->minutes / calendar::MINUTES_PER_DAY * calendar::MINUTES_PER_DAY + time.getHour() * 60 + time.getMinute();
+}
 
-    return out.str();
+void Datetime::setMinute(unsigned int minute) {
+    Time time(this->getHour(), minute);
+    this->minutes = this->minutes / calendar::MINUTES_PER_DAY * calendar::MINUTES_PER_DAY + time.getHour() * 60 + time.getMinute();
 }
 
-ostream &operator<<(ostream &os, const Datetime &datetime) {
-    return os << datetime.str() << '\n';
+// Flights that land on the next day, month or year
+static_assert(Datetime(2023, 12, 31, 22, 30).plus(Time(2, 15)) == Datetime(2024, 1, 1, 0, 45));
+static_assert(Datetime(2024, 2, 28, 23, 0).plusMinutes(24 * 60) == Datetime(2024, 2, 29, 23, 0));
+static_assert(Datetime(2023, 2, 28, 23, 0).minutesUntil(Datetime(2023, 3, 1, 1, 0)) == 2 * 60);
+
+/**
+ * @brief Writes a number between 0 and 99 as two digits
+ */
+static char *putTwoDigits(char *out, unsigned int value) {
+    out[0] = static_cast<char>('0' + value / 10);
+    out[1] = static_cast<char>('0' + value % 10);
+    return out + 2;
 }
 
-string Date::str() const {
-    ostringstream out;
+to_chars_result Date::toChars(char *first, char *last) const {
+    to_chars_result result = to_chars(first, last, this->year);
+    if (result.ec != errc() || last - result.ptr < 6)
+        return to_chars_result { last, errc::value_too_large };
 
-    out << this->getYear() << '/'
-        << setw(2) << setfill('0') << this->getMonth() << '/'
-        << setw(2) << setfill('0') << this->getDay();
+    char *out = result.ptr;
+    *out++ = '/';
+    out = putTwoDigits(out, this->month);
+    *out++ = '/';
+    out = putTwoDigits(out, this->day);
 
-    return out.str();
+    return to_chars_result { out, errc() };
 }
 
-string Time::str() const {
-    ostringstream out;
+to_chars_result Time::toChars(char *first, char *last) const {
+    if (last - first < 5)
+        return to_chars_result { last, errc::value_too_large };
+
+    char *out = putTwoDigits(first, this->hour);
+    *out++ = ':';
+    out = putTwoDigits(out, this->minute);
 
-    out << setw(2) << setfill('0') << this->getHour() << ':'
-        << setw(2) << setfill('0') << this->getMinute();
+    return to_chars_result { out, errc() };
+}
+
+to_chars_result Datetime::toChars(char *first, char *last) const {
+    to_chars_result result = Date(*this).toChars(first, last);
+    if (result.ec != errc() || result.ptr == last)
+        return to_chars_result { last, errc::value_too_large };
 
-    return out.str();
+    *result.ptr = ' ';
+    return Time(*this).toChars(result.ptr + 1, last);
+}
+
+string Date::str() const {
+    char text[MAX_TEXT_SIZE];
+    return string(text, this->toChars(text, text + sizeof(text)).ptr);
+}
+
+string Time::str() const {
+    char text[MAX_TEXT_SIZE];
+    return string(text, this->toChars(text, text + sizeof(text)).ptr);
+}
+
+string Datetime::str() const {
+    char text[MAX_TEXT_SIZE];
+    return string(text, this->toChars(text, text + sizeof(text)).ptr);
 }
 
 bool Time::operator<(const Time &time) const {
@@ -130,98 +175,160 @@ bool Time::operator<(const Time &time) const {
     return this->getMinute() < time.getMinute();
 }
 
-bool Datetime::operator<(const Datetime &datetime) const {
-    if (this->getYear() != datetime.getYear())
-        return this->getYear() < datetime.getYear();
-    if (this->getMonth() != datetime.getMonth())
-        return this->getMonth() < datetime.getMonth();
-    if (this->getDay() != datetime.getDay())
-        return this->getDay() < datetime.getDay();
-    if (this->getHour() != datetime.getHour())
-        return this->getHour() < datetime.getHour();
+/**
+ * @brief Parses numbers separated by the given characters, which must make up the whole text
+ * @param separators The character after each field, with '\0' after the last one
+ */
+static errc parseFields(string_view text, const char *separators, unsigned int *fields) {
+    for (size_t i = 0; ; i++) {
+        auto [next, error] = from_chars(text.data(), text.data() + text.size(), fields[i]);
+        if (error != errc())
+            return error == errc::result_out_of_range ? error : errc::invalid_argument;
+
+        text.remove_prefix(next - text.data());
+        if (separators[i] == '\0')
+            return text.empty() ? errc() : errc::invalid_argument;
+
+        if (text.empty() || text.front() != separators[i])
+            return errc::invalid_argument;
+
+        text.remove_prefix(1);
+    }
+}
+
+/**
+ * @brief Checks that the bytes of a word are digits where the mask is set, and equal to the separators elsewhere
+ */
+static bool isShapedAs(uint64_t word, uint64_t digits, uint64_t separators) {
+    uint64_t high_nibbles = digits & 0xF0F0F0F0F0F0F0F0;
+    uint64_t zeros = digits & 0x3030303030303030;
+
+    // Digits are 0x30-0x39, so their high nibble is 3 and stays 3 when 6 is added to them
+    return (word & ~digits) == separators
+        && (word & high_nibbles) == zeros
+        && ((word + (digits & 0x0606060606060606)) & high_nibbles) == zeros;
+}
 
-    return this->getMinute() < datetime.getMinute();
+static unsigned int digitAt(uint64_t word, int byte) {
+    return (word >> (8 * byte)) & 0x0F;
 }
 
-bool Datetime::operator==(const Datetime &datetime) const {
-    return !(*this < datetime) && !(datetime < (*this));
+/**
+ * @brief Reads the fields of a `YYYY/MM/dd HH:mm` text whose fields are all zero padded, checking its 16 bytes as two words
+ * @return Whether the text has that shape; the fields are not range checked
+ */
+static bool parseFixedDatetime(string_view text, unsigned int (&fields)[5]) {
+    if constexpr (endian::native != endian::little)
+        return false;
+
+    if (text.size() != 16)
+        return false;
+
+    // "YYYY/MM/" and "dd HH:mm", as read from memory
+    constexpr uint64_t FIRST_DIGITS = 0x00FFFF00FFFFFFFF, FIRST_SEPARATORS = 0x2F00002F00000000;
+    constexpr uint64_t SECOND_DIGITS = 0xFFFF00FFFF00FFFF, SECOND_SEPARATORS = 0x00003A0000200000;
+
+    uint64_t first, second;
+    memcpy(&first, text.data(), sizeof(first));
+    memcpy(&second, text.data() + sizeof(first), sizeof(second));
+    if (!isShapedAs(first, FIRST_DIGITS, FIRST_SEPARATORS) || !isShapedAs(second, SECOND_DIGITS, SECOND_SEPARATORS))
+        return false;
+
+    fields[0] = digitAt(first, 0) * 1000 + digitAt(first, 1) * 100 + digitAt(first, 2) * 10 + digitAt(first, 3);
+    fields[1] = digitAt(first, 5) * 10 + digitAt(first, 6);
+    fields[2] = digitAt(second, 0) * 10 + digitAt(second, 1);
+    fields[3] = digitAt(second, 3) * 10 + digitAt(second, 4);
+    fields[4] = digitAt(second, 6) * 10 + digitAt(second, 7);
+    return true;
 }
 
-Datetime Datetime::readFromString(const string &str) {
-    static validation_error invalid_date = validation_error("The provided date is not in the correct format (YYYY/MM/dd HH:mm)");
-    
-    istringstream in(str);
-    unsigned int year, month, day, hour, minute;
+errc Date::parse(string_view text, Date &date) {
+    unsigned int fields[3];
+    errc error = parseFields(text, "//", fields);
+    if (error != errc())
+        return error;
 
-    in >> year;
-    if (!in || in.get() != '/')
-        throw invalid_date;
+    if (fields[1] < 1 || fields[1] > 12 || fields[2] < 1 || fields[2] > 31)
+        return errc::result_out_of_range;
 
-    in >> month;
-    if (!in || in.get() != '/')
-        throw invalid_date;
+    date = Date(fields[2], fields[1], fields[0]);
+    return errc();
+}
 
-    in >> day;
-    if (!in || in.get() != ' ')
-        throw invalid_date;
+errc Time::parse(string_view text, Time &time) {
+    unsigned int fields[2];
+    errc error = parseFields(text, ":", fields);
+    if (error != errc())
+        return error;
 
-    in >> hour;
-    if (!in || in.get() != ':')
-        throw invalid_date;
+    if (fields[0] > 23 || fields[1] > 59)
+        return errc::result_out_of_range;
 
-    in >> minute;
-    if (!in || !in.eof())
-        throw invalid_date;
+    time = Time(fields[0], fields[1]);
+    return errc();
+}
 
-    try {
-        return Datetime(year, month, day, hour, minute);
-    } catch (invalid_argument exception) {
-        throw invalid_date;
+errc Datetime::parse(string_view text, Datetime &datetime) {
+    unsigned int fields[5];
+    if (!parseFixedDatetime(text, fields)) {
+        errc error = parseFields(text, "// :", fields);
+        if (error != errc())
+            return error;
     }
+
+    auto [year, month, day, hour, minute] = fields;
+    if (year > MAX_YEAR || month < 1 || month > 12 || day < 1 || day > calendar::daysInMonth(year, month) || hour > 23 || minute > 59)
+        return errc::result_out_of_range;
+
+    uint64_t days = calendar::daysFromCivil(year, month, day);
+    datetime = Datetime(static_cast<uint32_t>(days * calendar::MINUTES_PER_DAY + hour * 60 + minute));
+    return errc();
 }
 
-Date Date::readFromString(const string &str) {
-    static validation_error invalid_date = validation_error("The provided date is not in the correct format (YYYY/MM/dd)");
-    
-    istringstream in(str);
-    unsigned int year, month, day, hour, minute;
+pair<size_t, errc> Datetime::parseColumn(span<const string_view> texts, vector<Datetime> &values) {
+    values.reserve(values.size() + texts.size());
 
-    in >> year;
-    if (!in || in.get() != '/')
-        throw invalid_date;
+    Datetime datetime(0u);
+    for (size_t i = 0; i < texts.size(); i++) {
+        // Columns often repeat a datetime on consecutive rows, such as the departure of the tickets of a flight
+        if (i == 0 || texts[i] != texts[i - 1]) {
+            errc error = parse(texts[i], datetime);
+            if (error != errc())
+                return { i, error };
+        }
 
-    in >> month;
-    if (!in || in.get() != '/')
-        throw invalid_date;
+        values.push_back(datetime);
+    }
+
+    return { texts.size(), errc() };
+}
+
+Datetime Datetime::readFromString(const string &str) {
+    static validation_error invalid_date = validation_error("The provided date is not in the correct format (YYYY/MM/dd HH:mm)");
 
-    in >> day;
-    if (!in || !in.eof())
+    Datetime datetime(0u);
+    if (parse(str, datetime) != errc())
         throw invalid_date;
 
-    try {
-        return Date(year, month, day);
-    } catch (invalid_argument exception) {
+    return datetime;
+}
+
+Date Date::readFromString(const string &str) {
+    static validation_error invalid_date = validation_error("The provided date is not in the correct format (YYYY/MM/dd)");
+
+    Date date(1, 1, 0);
+    if (parse(str, date) != errc())
         throw invalid_date;
-    }
+
+    return date;
 }
 
 Time Time::readFromString(const string &str) {
     static validation_error invalid_date = validation_error("The provided time is not in the correct format (HH:mm)");
-    
-    istringstream in(str);
-    unsigned int hour, minute;
 
-    in >> hour;
-    if (!in || in.get() != ':')
+    Time time(0, 0);
+    if (parse(str, time) != errc())
         throw invalid_date;
 
-    in >> minute;
-    if (!in || !in.eof())
-        throw invalid_date;
-
-    try {
-        return Time(hour, minute);
-    } catch (invalid_argument exception) {
-        throw invalid_date;
-    }
-}
\ No newline at end of file
+    return time;
+}
@@ -0,0 +1,425 @@
+#include "exporter.h"
+#include "state.h"
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace exporter {
+
+    JsonLinesWriter::JsonLinesWriter(const string &path) : buffer(new char[BUFFER_SIZE]) {
+        this->fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (this->fd < 0)
+            throw runtime_error("Could not open " + path + ": " + strerror(errno));
+    }
+
+    JsonLinesWriter::~JsonLinesWriter() {
+        if (this->fd < 0)
+            return;
+
+        try {
+            this->flush();
+        } catch (exception &exception) {}
+
+        ::close(this->fd);
+    }
+
+    void JsonLinesWriter::flush() {
+        size_t written = 0;
+        while (written < this->used) {
+            ssize_t result = ::write(this->fd, this->buffer.get() + written, this->used - written);
+            if (result < 0) {
+                if (errno == EINTR)
+                    continue;
+
+                throw runtime_error(string("Could not write the export: ") + strerror(errno));
+            }
+
+            written += result;
+        }
+
+        this->used = 0;
+    }
+
+    void JsonLinesWriter::append(const char *data, size_t size) {
+        while (size > 0) {
+            if (this->used == BUFFER_SIZE)
+                this->flush();
+
+            size_t length = min(size, BUFFER_SIZE - this->used);
+            memcpy(this->buffer.get() + this->used, data, length);
+            this->used += length;
+            data += length;
+            size -= length;
+        }
+    }
+
+    void JsonLinesWriter::put(char c) {
+        if (this->used == BUFFER_SIZE)
+            this->flush();
+
+        this->buffer[this->used++] = c;
+    }
+
+    void JsonLinesWriter::beforeValue() {
+        if (this->after_key) {
+            this->after_key = false;
+            return;
+        }
+
+        if (this->depth > 0) {
+            if (this->has_elements[this->depth - 1])
+                this->put(',');
+
+            this->has_elements[this->depth - 1] = true;
+        }
+    }
+
+    void JsonLinesWriter::open(char bracket) {
+        if (this->depth == MAX_DEPTH)
+            throw logic_error("JSON values are nested too deeply");
+
+        this->beforeValue();
+        this->put(bracket);
+        this->has_elements[this->depth++] = false;
+    }
+
+    void JsonLinesWriter::close(char bracket) {
+        if (this->depth == 0)
+            throw logic_error("There is no JSON object or array to close");
+
+        this->put(bracket);
+        this->depth--;
+
+        if (this->depth == 0) {
+            this->put('\n');
+            this->line_count++;
+        }
+    }
+
+    JsonLinesWriter &JsonLinesWriter::beginObject() {
+        this->open('{');
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::endObject() {
+        this->close('}');
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::beginArray() {
+        this->open('[');
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::endArray() {
+        this->close(']');
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::key(string_view name) {
+        this->text(name);
+        this->put(':');
+        this->after_key = true;
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::text(string_view value) {
+        static const char HEX[] = "0123456789abcdef";
+
+        this->beforeValue();
+        this->put('"');
+
+        // Runs of characters that need no escaping are copied at once
+        size_t start = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            unsigned char c = value[i];
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+
+            this->append(value.data() + start, i - start);
+            start = i + 1;
+
+            switch (c) {
+                case '"': this->append("\\\"", 2); break;
+                case '\\': this->append("\\\\", 2); break;
+                case '\n': this->append("\\n", 2); break;
+                case '\r': this->append("\\r", 2); break;
+                case '\t': this->append("\\t", 2); break;
+                default: {
+                    char escaped[] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF] };
+                    this->append(escaped, sizeof(escaped));
+                }
+            }
+        }
+
+        this->append(value.data() + start, value.size() - start);
+        this->put('"');
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::integer(int64_t value) {
+        char digits[24];
+        auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+
+        this->beforeValue();
+        this->append(digits, end - digits);
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::number(double value) {
+        if (!isfinite(value))
+            return this->null();
+
+        char digits[32];
+        auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+
+        this->beforeValue();
+        this->append(digits, end - digits);
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::number(float value) {
+        if (!isfinite(value))
+            return this->null();
+
+        char digits[32];
+        auto [end, error] = to_chars(digits, digits + sizeof(digits), value);
+
+        this->beforeValue();
+        this->append(digits, end - digits);
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::boolean(bool value) {
+        this->beforeValue();
+        this->append(value ? "true" : "false", value ? 4 : 5);
+        return *this;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::null() {
+        this->beforeValue();
+        this->append("null", 4);
+        return *this;
+    }
+
+    /**
+     * @brief Writes a number with leading zeros, such as the month of a date
+     */
+    char *putPadded(char *out, unsigned int value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            out[i] = '0' + value % 10;
+            value /= 10;
+        }
+
+        return out + width;
+    }
+
+    JsonLinesWriter &JsonLinesWriter::datetime(const Datetime &value) {
+        Date date = value;
+        char text[24];
+        char *out = putPadded(text, date.getYear(), 4);
+        *out++ = '-';
+        out = putPadded(out, date.getMonth(), 2);
+        *out++ = '-';
+        out = putPadded(out, date.getDay(), 2);
+        *out++ = 'T';
+        out = putPadded(out, value.getHour(), 2);
+        *out++ = ':';
+        out = putPadded(out, value.getMinute(), 2);
+
+        return this->text(string_view(text, out - text));
+    }
+
+    JsonLinesWriter &JsonLinesWriter::time(const Time &value) {
+        char text[8];
+        char *out = putPadded(text, value.getHour(), 2);
+        *out++ = ':';
+        out = putPadded(out, value.getMinute(), 2);
+
+        return this->text(string_view(text, out - text));
+    }
+
+    void JsonLinesWriter::finish() {
+        this->flush();
+
+        int fd = this->fd;
+        this->fd = -1;
+        if (::close(fd) < 0)
+            throw runtime_error(string("Could not write the export: ") + strerror(errno));
+    }
+
+    size_t JsonLinesWriter::getLineCount() const {
+        return this->line_count;
+    }
+
+    const char *getTransportTypeName(TransportType type) {
+        switch (type) {
+            case TransportType::BUS:
+                return "bus";
+            case TransportType::SUBWAY:
+                return "subway";
+            case TransportType::TRAIN:
+                return "train";
+            default:
+                throw runtime_error("Transport type not present in enum");
+        }
+    }
+
+    void write(JsonLinesWriter &writer, const Airport &airport) {
+        writer.beginObject()
+            .key("name").text(airport.getName())
+            .key("transport_places").beginArray();
+
+        for (const TransportPlace &place : airport.getTransportPlaceInfo()) {
+            writer.beginObject()
+                .key("name").text(place.name)
+                .key("type").text(getTransportTypeName(place.transport_type))
+                .key("latitude").number(place.latitude)
+                .key("longitude").number(place.longitude)
+                .key("airport_distance").number(place.airport_distance)
+                .key("schedule").beginArray();
+
+            for (const Time &time : place.schedule)
+                writer.time(time);
+
+            writer.endArray().endObject();
+        }
+
+        writer.endArray().endObject();
+    }
+
+    void write(JsonLinesWriter &writer, const Plane &plane) {
+        writer.beginObject()
+            .key("license_plate").text(plane.getLicensePlate())
+            .key("type").text(plane.getType())
+            .key("capacity").integer(plane.getCapacity())
+            .key("flights").integer(plane.getFlights().size())
+            .key("scheduled_services").integer(plane.getScheduledServices().size())
+            .key("finished_services").integer(plane.getFinishedServices().size())
+            .endObject();
+    }
+
+    void write(JsonLinesWriter &writer, const Flight &flight) {
+        Time duration = flight.getDuration();
+
+        writer.beginObject()
+            .key("flight_id").text(flight.getFlightId())
+            .key("departure_time").datetime(flight.getDepartureTime())
+            .key("duration_minutes").integer(duration.getHour() * 60 + duration.getMinute())
+            .key("origin").text(flight.getOrigin().getName())
+            .key("destination").text(flight.getDestination().getName())
+            .key("plane").text(flight.getPlane().getLicensePlate())
+            .key("tickets").integer(flight.getTicketCount())
+            .key("luggage").integer(flight.getLuggageCount())
+            .endObject();
+    }
+
+    void write(JsonLinesWriter &writer, const Ticket &ticket) {
+        const Flight &flight = ticket.getFlight();
+
+        writer.beginObject()
+            .key("flight_id").text(flight.getFlightId())
+            .key("departure_time").datetime(flight.getDepartureTime())
+            .key("seat_number").integer(ticket.getSeatNumber())
+            .key("customer_name").text(ticket.getCustomerName())
+            .key("customer_age").integer(ticket.getCustomerAge())
+            .endObject();
+    }
+
+    void write(JsonLinesWriter &writer, const Service &service, bool is_finished) {
+        writer.beginObject()
+            .key("plane").text(service.getPlane().getLicensePlate())
+            .key("type").text(service.getType() == ServiceType::CLEANING ? "cleaning" : "maintenance")
+            .key("datetime").datetime(service.getDatetime())
+            .key("worker").text(service.getWorker())
+            .key("status").text(is_finished ? "finished" : "scheduled")
+            .endObject();
+    }
+
+    void write(JsonLinesWriter &writer, const HandlingCar &car) {
+        writer.beginObject()
+            .key("id").integer(car.getId())
+            .key("carriages").integer(car.getNumberOfCarriages())
+            .key("stacks_per_carriage").integer(car.getStacksPerCarriage())
+            .key("luggage_per_stack").integer(car.getLuggagePerStack());
+
+        const Flight *flight = car.getFlight();
+        if (flight == nullptr) {
+            writer.key("flight_id").null()
+                .key("departure_time").null();
+        } else {
+            writer.key("flight_id").text(flight->getFlightId())
+                .key("departure_time").datetime(flight->getDepartureTime());
+        }
+
+        // Luggage is nested as it is loaded, by carriage and then by stack
+        writer.key("luggage").beginArray();
+        for (const Carriage &carriage : car.getCarriages()) {
+            writer.beginArray();
+            for (const LuggageStack &stack : carriage) {
+                writer.beginArray();
+                for (Luggage *luggage : stack) {
+                    writer.beginObject()
+                        .key("seat_number").integer(luggage->getTicket().getSeatNumber())
+                        .key("weight").number(luggage->getWeight())
+                        .endObject();
+                }
+
+                writer.endArray();
+            }
+
+            writer.endArray();
+        }
+
+        writer.endArray().endObject();
+    }
+
+    size_t exportTickets(const string &path, const vector<Flight*> &flights, const function<bool(const Ticket* const&)> &filter) {
+        JsonLinesWriter writer(path);
+        for (const Flight *flight : flights) {
+            flight->forEachTicket([&writer, &filter](const Ticket &ticket) {
+                if (!filter || filter(&ticket))
+                    write(writer, ticket);
+            });
+        }
+
+        writer.finish();
+        return writer.getLineCount();
+    }
+
+    size_t exportServices(const string &path, const vector<Plane*> &planes, const function<bool(const Service* const&)> &filter) {
+        JsonLinesWriter writer(path);
+        for (const Plane *plane : planes) {
+            for (const Service *service : plane->getFinishedServices()) {
+                if (!filter || filter(service))
+                    write(writer, *service, true);
+            }
+
+            // Only the front of a queue can be read, so a copy of it is walked
+            queue<Service*> scheduled_services = plane->getScheduledServices();
+            for (; !scheduled_services.empty(); scheduled_services.pop()) {
+                if (!filter || filter(scheduled_services.front()))
+                    write(writer, *scheduled_services.front(), false);
+            }
+        }
+
+        writer.finish();
+        return writer.getLineCount();
+    }
+
+    size_t exportAll(const string &directory) {
+        return exportRecords(directory + "/airports.jsonl", data::airports)
+               + exportRecords(directory + "/planes.jsonl", data::planes)
+               + exportRecords(directory + "/flights.jsonl", data::flights)
+               + exportTickets(directory + "/tickets.jsonl", data::flights)
+               + exportServices(directory + "/services.jsonl", data::planes)
+               + exportRecords(directory + "/handling_cars.jsonl", data::handlingCars);
+    }
+}
@@ -0,0 +1,748 @@
+#include "files.h"
+#include "flight_calendar.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "ordinal_table.h"
+#include "snapshot.h"
+#include "state.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace files {
+
+    static const string PATH = "data.txt";
+    static const string SNAPSHOT_PATH = "data.bin";
+
+    /** Size the journal may reach before it is folded into a new snapshot */
+    static const uint64_t COMPACTION_THRESHOLD = 4 << 20;
+
+    /** Time the journal may hold changes before they are saved into a new snapshot */
+    static const chrono::minutes AUTOSAVE_INTERVAL(5);
+
+    /** How often the autosave thread checks whether a save is due */
+    static const chrono::seconds AUTOSAVE_POLL_INTERVAL(1);
+
+    /** How long the autosave thread waits before forking again after a fork failed */
+    static const chrono::seconds AUTOSAVE_RETRY_INTERVAL(30);
+
+    using Clock = chrono::steady_clock;
+
+    /**
+     * State shared by the interactive thread and the autosave thread.
+     * The data may only be forked while the interactive thread is idle, and it can't stop being idle during a fork.
+     */
+    static mutex autosave_mutex;
+    static condition_variable autosave_changed;
+    static thread autosave_thread;
+    static bool is_idle = false;
+    static bool is_saving = false;
+    static bool is_stopping = false;
+    static Clock::time_point last_save = Clock::now();
+    static Clock::time_point next_attempt = Clock::now();
+    static AutosaveStats autosave_stats;
+
+    bool exists(const string &path) {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0;
+    }
+
+    void clear() {
+        for (const auto &el : data::airports) {
+            delete el;
+        }
+        data::airports.clear();
+
+        for (const auto &el : data::planes) {
+            delete el;
+        }
+        data::planes.clear();
+        
+        for (const auto &el : data::flights) {
+            delete el;
+        }
+        data::flights.clear();
+        flight_calendar::invalidate();
+ 
+        for (const auto &el : data::handlingCars) {
+            delete el;
+        }
+        data::handlingCars.clear();
+    }
+
+    /**
+     * @brief Waits for the snapshot being written in the background, if any.
+     * Must be called from the interactive thread while it isn't idle, so no other save can start.
+     */
+    void waitForAutosave() {
+        unique_lock<mutex> lock(autosave_mutex);
+        autosave_changed.wait(lock, []() { return !is_saving; });
+    }
+
+    /**
+     * @brief Whether the journal has grown too large or held changes for too long. Needs autosave_mutex.
+     */
+    bool isAutosaveDue() {
+        if (Clock::now() < next_attempt)
+            return false;
+
+        if (journal::getSize() >= COMPACTION_THRESHOLD)
+            return true;
+
+        return !journal::isEmpty() && Clock::now() - last_save >= AUTOSAVE_INTERVAL;
+    }
+
+    void runAutosave() {
+        unique_lock<mutex> lock(autosave_mutex);
+
+        while (true) {
+            autosave_changed.wait_for(lock, AUTOSAVE_POLL_INTERVAL, []() { return is_stopping || (is_idle && isAutosaveDue()); });
+            if (is_stopping)
+                return;
+
+            if (!is_idle || !isAutosaveDue())
+                continue;
+
+            // The interactive thread can't resume while the lock is held, so the data doesn't change until the fork is done
+            Clock::time_point start = Clock::now();
+            uint64_t generation = journal::rotate();
+
+            pid_t child = fork();
+            if (child == 0) {
+                // The child owns a copy of the data as it was when the journal was rotated
+                try {
+                    snapshot::write(SNAPSHOT_PATH, generation);
+                    journal::removeBefore(generation);
+                } catch (exception &exception) {
+                    _exit(1);
+                }
+
+                _exit(0);
+            }
+
+            autosave_stats.last_pause = chrono::duration<double, milli>(Clock::now() - start).count();
+            autosave_stats.max_pause = max(autosave_stats.max_pause, autosave_stats.last_pause);
+
+            bool succeeded;
+            if (child < 0) {
+                // Saving here instead would keep the interactive thread waiting for the whole save, so it is tried again later.
+                // The journal stays on disk until a snapshot covers it.
+                next_attempt = Clock::now() + AUTOSAVE_RETRY_INTERVAL;
+                succeeded = false;
+            } else {
+                last_save = Clock::now();
+                is_saving = true;
+                lock.unlock();
+
+                int status;
+                succeeded = waitpid(child, &status, 0) == child && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+                lock.lock();
+                is_saving = false;
+            }
+
+            autosave_stats.count++;
+            autosave_stats.last_duration = chrono::duration<double, milli>(Clock::now() - start).count();
+            if (!succeeded)
+                autosave_stats.failures++;
+
+            autosave_changed.notify_all();
+        }
+    }
+
+    void startAutosave() {
+        if (!autosave_thread.joinable())
+            autosave_thread = thread(runAutosave);
+    }
+
+    void setIdle(bool idle) {
+        {
+            lock_guard<mutex> lock(autosave_mutex);
+            is_idle = idle;
+        }
+
+        autosave_changed.notify_all();
+    }
+
+    AutosaveStats getAutosaveStats() {
+        lock_guard<mutex> lock(autosave_mutex);
+        return autosave_stats;
+    }
+
+    string getQuarantinePath(const string &path) {
+        string kept = path + ".corrupt";
+        for (unsigned int i = 1; exists(kept); i++)
+            kept = path + ".corrupt." + to_string(i);
+
+        return kept;
+    }
+
+    void syncDirectory(const string &path) {
+        string directory = filesystem::path(path).parent_path().string();
+        if (directory.empty())
+            directory = ".";
+
+        int descriptor = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (descriptor < 0)
+            throw runtime_error("Could not open the directory of " + path);
+
+        bool flushed = fsync(descriptor) == 0;
+        if (::close(descriptor) != 0 || !flushed)
+            throw runtime_error("Could not flush the directory of " + path);
+    }
+
+    /**
+     * @brief Moves a corrupt file out of the way, under a name that no earlier corrupt file has
+     */
+    void keepAside(const string &path) {
+        string kept = getQuarantinePath(path);
+        if (rename(path.c_str(), kept.c_str()) == 0)
+            load_stats.kept_copies.push_back(kept);
+    }
+
+    void read() {
+        waitForAutosave();
+        journal::close();
+        clear();
+
+        load_stats = LoadStats();
+        LoadTimer total_timer(load_stats.total);
+
+        string path = exists(SNAPSHOT_PATH) ? SNAPSHOT_PATH : PATH;
+        uint64_t generation = 0;
+        bool from_text = false;
+
+        if (exists(path)) {
+            try {
+                if (path == SNAPSHOT_PATH) {
+                    generation = snapshot::read(path);
+                } else {
+                    readText(path);
+                    from_text = true;
+                }
+            } catch (const exception &) {
+                // The file is kept aside rather than deleted, so whatever it still holds can be looked into
+                keepAside(path);
+                clear();
+            }
+        }
+
+        bool replayed_all;
+        {
+            LoadTimer timer(load_stats.journal);
+            replayed_all = journal::open(generation);
+        }
+
+        // A snapshot that had parts left out is set aside, and what could be recovered is saved in its place
+        bool recovered = !load_stats.quarantined.empty();
+        if (recovered)
+            keepAside(path);
+
+        // Data that only exists in the text file or in a journal that had to be set aside is saved right away
+        if (!replayed_all || from_text || recovered)
+            write();
+    }
+
+    void write() {
+        waitForAutosave();
+
+        uint64_t generation = journal::rotate();
+        snapshot::write(SNAPSHOT_PATH, generation);
+        journal::removeBefore(generation);
+
+        lock_guard<mutex> lock(autosave_mutex);
+        last_save = Clock::now();
+    }
+
+    const string &getSnapshotPath() {
+        return SNAPSHOT_PATH;
+    }
+
+    void close() {
+        {
+            lock_guard<mutex> lock(autosave_mutex);
+            is_stopping = true;
+        }
+
+        autosave_changed.notify_all();
+        if (autosave_thread.joinable())
+            autosave_thread.join();
+
+        journal::close();
+    }
+
+    /**
+     * @brief Walks a text file held in memory, mirroring the extraction rules of the old stream-based reader:
+     * numbers and words skip leading whitespace, while lines are taken verbatim
+     */
+    class TextCursor {
+        const char *position;
+        const char *end;
+
+        void skipWhitespace() {
+            while (position != end && isspace(static_cast<unsigned char>(*position)))
+                position++;
+        }
+
+    public:
+        explicit TextCursor(string_view text) : position(text.data()), end(text.data() + text.size()) {}
+
+        /**
+         * @brief Reads the rest of the current line and moves to the next one
+         */
+        string_view line() {
+            const char *start = position;
+            const char *newline = static_cast<const char*>(memchr(position, '\n', end - position));
+            position = newline == nullptr ? end : newline + 1;
+
+            return string_view(start, (newline == nullptr ? end : newline) - start);
+        }
+
+        /**
+         * @brief Discards the rest of the current line
+         */
+        void skipLine() {
+            line();
+        }
+
+        /**
+         * @brief Reads the next whitespace-delimited word
+         */
+        string_view word() {
+            skipWhitespace();
+
+            const char *start = position;
+            while (position != end && !isspace(static_cast<unsigned char>(*position)))
+                position++;
+
+            if (start == position)
+                throw runtime_error("Unexpected end of file");
+
+            return string_view(start, position - start);
+        }
+
+        template <typename T>
+        T number() {
+            skipWhitespace();
+
+            T value;
+            auto [next, error] = from_chars(position, end, value);
+            if (error != errc())
+                throw runtime_error("Expected a number");
+
+            position = next;
+            return value;
+        }
+    };
+
+    Time parseTime(string_view text) {
+        Time time(0, 0);
+        errc error = Time::parse(text, time);
+        if (error != errc())
+            throw runtime_error(error == errc::result_out_of_range ? "Time out of range" : "Malformed time");
+
+        return time;
+    }
+
+    Datetime parseDatetime(string_view text) {
+        Datetime datetime(0, 1, 1, 0, 0);
+        errc error = Datetime::parse(text, datetime);
+        if (error != errc())
+            throw runtime_error(error == errc::result_out_of_range ? "Datetime out of range" : "Malformed datetime");
+
+        return datetime;
+    }
+
+    ServiceType parseServiceType(string_view text) {
+        if (text == "cleaning")
+            return ServiceType::CLEANING;
+        else if (text == "maintenance")
+            return ServiceType::MAINTENANCE;
+
+        throw runtime_error("Unknown service type");
+    }
+
+    TransportType parseTransportType(string_view text) {
+        if (text == "bus")
+            return TransportType::BUS;
+        else if (text == "subway")
+            return TransportType::SUBWAY;
+        else if (text == "train")
+            return TransportType::TRAIN;
+
+        throw runtime_error("Unknown transport type");
+    }
+
+    /**
+     * @brief Reads the services of a plane, which are either all finished or all scheduled
+     */
+    void readServices(TextCursor &file, Plane &plane, bool finished) {
+        unsigned int count = file.number<unsigned int>();
+        file.skipLine();
+
+        for (unsigned int i = 0; i < count; i++) {
+            string_view worker = file.line();
+            Datetime datetime = parseDatetime(file.line());
+            ServiceType type = parseServiceType(file.line());
+
+            Service *service = new Service(type, datetime, string(worker), plane);
+            plane.scheduleService(*service);
+            if (finished)
+                plane.completeService();
+        }
+    }
+
+    void readText(const string &path) {
+        clear();
+
+        optional<LoadTimer> timer(in_place, load_stats.mapping);
+        MappedFile mapping(path);
+        TextCursor file(mapping.view());
+
+        // Temporary indexes, so that every reference is resolved in constant time
+        unordered_map<string_view, Airport*> airports_by_name;
+        unordered_map<FlightKey, Flight*, FlightKeyHash> flights_by_key;
+
+        timer.emplace(load_stats.airports);
+        unsigned int airport_count = file.number<unsigned int>();
+        file.skipLine();
+
+        data::airports.reserve(airport_count);
+        airports_by_name.reserve(airport_count);
+
+        for (unsigned int i = 0; i < airport_count; i++) {
+            Airport *airport = new Airport(string(file.line()));
+            data::airports.push_back(airport);
+            airports_by_name.emplace(airport->getName(), airport);
+
+            unsigned int place_count = file.number<unsigned int>();
+            file.skipLine();
+
+            for (unsigned int j = 0; j < place_count; j++) {
+                string_view name = file.line();
+                float latitude = file.number<float>();
+                float longitude = file.number<float>();
+                float airport_distance = file.number<float>();
+                TransportType type = parseTransportType(file.word());
+
+                unsigned int schedule_count = file.number<unsigned int>();
+                file.skipLine();
+
+                TransportPlace place = {
+                    .name = string(name),
+                    .latitude = latitude,
+                    .longitude = longitude,
+                    .transport_type = type,
+                    .airport_distance = airport_distance,
+                    .schedule = {}
+                };
+
+                for (unsigned int k = 0; k < schedule_count; k++)
+                    place.schedule.insert(parseTime(file.line()));
+
+                airport->addTransportPlaceInfo(place);
+            }
+        }
+
+        timer.emplace(load_stats.planes);
+        unsigned int plane_count = file.number<unsigned int>();
+        data::planes.reserve(plane_count);
+
+        for (unsigned int i = 0; i < plane_count; i++) {
+            timer.emplace(load_stats.planes);
+            string_view license_plate = file.word();
+            file.skipLine();
+
+            string_view type = file.line();
+            unsigned int capacity = file.number<unsigned int>();
+
+            Plane *plane = new Plane(string(license_plate), string(type), capacity);
+            data::planes.push_back(plane);
+
+            readServices(file, *plane, true);
+            readServices(file, *plane, false);
+
+            timer.emplace(load_stats.flights);
+            unsigned int flight_count = file.number<unsigned int>();
+            file.skipLine();
+
+            for (unsigned int j = 0; j < flight_count; j++) {
+                string_view flight_id = file.line();
+                Datetime departure_time = parseDatetime(file.line());
+                Time duration = parseTime(file.line());
+
+                auto origin = airports_by_name.find(file.line());
+                auto destination = airports_by_name.find(file.line());
+                if (origin == airports_by_name.end() || destination == airports_by_name.end())
+                    throw runtime_error("Unknown origin or destination airports");
+
+                Flight *flight = new Flight(string(flight_id), departure_time, duration, *origin->second, *destination->second, *plane);
+                plane->addFlight(*flight);
+                data::flights.push_back(flight);
+                flights_by_key.emplace(FlightKey { flight_id, departure_time }, flight);
+
+                unsigned int ticket_count = file.number<unsigned int>();
+                file.skipLine();
+
+                // Tickets are written sorted by seat, so their position here matches their position in the flight
+                vector<Ticket*> tickets;
+                tickets.reserve(ticket_count);
+
+                for (unsigned int k = 0; k < ticket_count; k++) {
+                    string_view customer_name = file.line();
+                    unsigned int customer_age = file.number<unsigned int>();
+                    unsigned int seat_number = file.number<unsigned int>();
+                    file.skipLine();
+
+                    Ticket *ticket = new Ticket(*flight, string(customer_name), customer_age, seat_number);
+                    flight->addTicket(*ticket);
+                    tickets.push_back(ticket);
+                }
+
+                unsigned int luggage_count = file.number<unsigned int>();
+                file.skipLine();
+
+                for (unsigned int k = 0; k < luggage_count; k++) {
+                    unsigned int index = file.number<unsigned int>();
+                    float weight = file.number<float>();
+                    file.skipLine();
+
+                    Luggage *luggage = new Luggage(*tickets.at(index), weight);
+                    flight->addLuggage(*luggage);
+                }
+            }
+        }
+
+        timer.emplace(load_stats.handling_cars);
+        unsigned int car_count = file.number<unsigned int>();
+        data::handlingCars.reserve(car_count);
+
+        for (unsigned int i = 0; i < car_count; i++) {
+            unsigned int number_of_carriages = file.number<unsigned int>();
+            unsigned int stacks_per_carriage = file.number<unsigned int>();
+            unsigned int luggage_per_stack = file.number<unsigned int>();
+
+            HandlingCar *car = new HandlingCar(number_of_carriages, stacks_per_carriage, luggage_per_stack);
+            data::handlingCars.push_back(car);
+
+            string_view flight_id = file.word();
+            file.skipLine();
+
+            if (flight_id == "none")
+                continue;
+
+            auto flight = flights_by_key.find(FlightKey { flight_id, parseDatetime(file.line()) });
+            if (flight == flights_by_key.end())
+                throw runtime_error("No flight found");
+
+            car->setFlight(*flight->second);
+
+            const vector<Ticket*> &tickets = car->getFlight()->getTickets();
+
+            unsigned int luggage_count = file.number<unsigned int>();
+            for (unsigned int j = 0; j < luggage_count; j++) {
+                unsigned int index = file.number<unsigned int>();
+                float weight = file.number<float>();
+
+                Luggage *luggage = new Luggage(*tickets.at(index), weight);
+                car->addLuggage(*luggage);
+            }
+        }
+
+        timer.emplace(load_stats.indexing);
+
+        // Flights are stored in plane order, but the lookups expect them sorted by id
+        stable_sort(data::flights.begin(), data::flights.end(), [](const Flight *a, const Flight *b) {
+            return a->getFlightId() < b->getFlightId();
+        });
+    }
+
+    /**
+     * @brief Writes a Date, Time or Datetime as its str() would, without building a string
+     */
+    template <typename T>
+    void writeFormatted(ostream &file, const T &value) {
+        char text[T::MAX_TEXT_SIZE];
+        file.write(text, value.toChars(text, text + sizeof(text)).ptr - text);
+    }
+
+    void writeText(const string &path) {
+        ofstream file(path);
+        if (!file.is_open())
+            throw runtime_error("Could not open file");
+
+
+        OrdinalTable ordinals;
+
+        // Writes airport data
+        file << data::airports.size() << '\n';
+        for (Airport *airport : data::airports) {
+            file << airport->getName() << '\n'
+                << airport->getTransportPlaceInfo().size() << '\n';
+
+            for (const auto &info : airport->getTransportPlaceInfo()) {
+                file << info.name << '\n'
+                    << info.latitude << ' ' << info.longitude << ' ' << info.airport_distance << '\n';
+
+                switch (info.transport_type) {
+                    case TransportType::BUS:
+                        file << "bus";
+                        break;
+                    
+                    case TransportType::SUBWAY:
+                        file << "subway";
+                        break;
+
+                    case TransportType::TRAIN:
+                        file << "train";
+                        break;
+
+                    default:
+                        throw runtime_error("Transport type not present in enum");
+                }
+
+                file << '\n'
+                    << info.schedule.size() << '\n';
+
+                for (const auto &time : info.schedule) {
+                    writeFormatted(file, time);
+                    file << '\n';
+                }
+            }
+        }
+        
+
+        // Writes plane data 
+        file << data::planes.size() << '\n';
+        for (Plane *plane : data::planes) {
+            file << plane->getLicensePlate() << '\n'
+                << plane->getType() << '\n'
+                << plane->getCapacity() << '\n';
+
+            file << plane->getFinishedServices().size() << '\n';
+            for (const auto &service : plane->getFinishedServices()) {
+                file << service->getWorker() << '\n';
+                writeFormatted(file, service->getDatetime());
+                file << '\n';
+
+                switch (service->getType()) {
+                    case ServiceType::CLEANING:
+                        file << "cleaning";
+                        break;
+                    case ServiceType::MAINTENANCE:
+                        file << "maintenance";
+                        break;
+                    default:
+                        throw runtime_error("Service type not in enum");
+
+                }
+                
+                file << '\n';
+            }
+
+            queue<Service*> scheduled_services = plane->getScheduledServices();
+
+            file << scheduled_services.size() << '\n';
+            while (!scheduled_services.empty()) {
+                Service *service = scheduled_services.front();
+
+                file << service->getWorker() << '\n';
+                writeFormatted(file, service->getDatetime());
+                file << '\n';
+
+                switch (service->getType()) {
+                    case ServiceType::CLEANING:
+                        file << "cleaning";
+                        break;
+                    case ServiceType::MAINTENANCE:
+                        file << "maintenance";
+                        break;
+                    default:
+                        throw runtime_error("Service type not in enum");
+                }
+
+                file << '\n';
+                scheduled_services.pop();
+            }
+
+            file << plane->getFlights().size() << '\n';
+            for (const auto &flight : plane->getFlights()) {
+                file << flight->getFlightId() << '\n';
+                writeFormatted(file, flight->getDepartureTime());
+                file << '\n';
+                writeFormatted(file, flight->getDuration());
+                file << '\n'
+                    << flight->getOrigin().getName() << '\n'
+                    << flight->getDestination().getName() << '\n';
+
+                file << flight->getTickets().size() << '\n';
+                for (const auto &ticket : flight->getTickets()) {
+                    file << ticket->getCustomerName() << '\n'
+                        << ticket->getCustomerAge() << '\n'
+                        << ticket->getSeatNumber() << '\n';
+                }
+
+                file << flight->getLuggage().size() << '\n';
+                for (const auto &luggage: flight->getLuggage()) {
+                    file << ordinals.getTicket(*flight, luggage->getTicket()) << '\n'
+                        << luggage->getWeight() << '\n';
+                }
+            }
+
+        }
+
+        // Writes HandlingCar data
+        file << data::handlingCars.size() << '\n';
+        for (HandlingCar *handlingCar : data::handlingCars) {
+            file << handlingCar->getNumberOfCarriages() << '\n'
+                << handlingCar->getStacksPerCarriage() << '\n'
+                << handlingCar->getLuggagePerStack() << '\n';
+
+            if (handlingCar->getFlight() == nullptr) {
+                file << "none" << '\n';
+                continue;
+            }
+
+            file << handlingCar->getFlight()->getFlightId() << '\n';
+            writeFormatted(file, handlingCar->getFlight()->getDepartureTime());
+            file << '\n';
+
+            size_t numLuggage = 0;
+            for (const auto &carriage : handlingCar->getCarriages()) {
+                for (const auto &stack : carriage) {
+                    numLuggage += stack.size();
+                }
+            }
+
+            file << numLuggage << '\n';
+
+            const Flight &flight = *handlingCar->getFlight();
+            for (const auto &carriage : handlingCar->getCarriages()) {
+                for (const auto &luggageStack : carriage) {
+                    // Stacks are written from the bottom, in the order they must be loaded back
+                    for (Luggage *luggage : luggageStack) {
+                        file << ordinals.getTicket(flight, luggage->getTicket()) << '\n'
+                            << luggage->getWeight() << '\n';
+                    }
+                }
+            }
+        }
+    }
+}
@@ -6,9 +6,10 @@ using namespace std;
 
 Flight::Flight(const string &id, const Datetime &departure_time, const Time &duration, Airport &origin, Airport &destination,
                Plane &plane) : plane(plane), flight_id(id), departure_time(departure_time),
-                               duration(duration), origin(origin), destination(destination) {}
+                               duration(duration), arrival_time(departure_time.plus(duration)),
+                               origin(&origin), destination(&destination) {}
 
-std::string Flight::getFlightId() const {
+const std::string &Flight::getFlightId() const {
     return this->flight_id;
 }
 
@@ -20,35 +21,107 @@ Time Flight::getDuration() const {
     return this->duration;
 }
 
+Datetime Flight::getArrivalTime() const {
+    return this->arrival_time;
+}
+
 Airport &Flight::getOrigin() const {
-    return this->origin;
+    return *this->origin;
 }
 
 Airport &Flight::getDestination() const {
-    return this->destination;
+    return *this->destination;
+}
+
+void Flight::loadPassengers() const {
+    if (this->passenger_loader == nullptr)
+        return;
+
+    // Flights are never created const, and the loader is cleared first so that adding the passengers doesn't recurse
+    Flight &flight = const_cast<Flight&>(*this);
+    shared_ptr<const PassengerLoader> loader = move(flight.passenger_loader);
+    flight.passenger_loader = nullptr;
+
+    try {
+        loader->load(flight, this->passenger_range);
+    } catch (...) {
+        // The flight is left loaded without passengers, as loading them again would only fail again
+        for (Luggage *luggage : flight.luggage)
+            delete luggage;
+
+        for (Ticket *ticket : flight.tickets)
+            delete ticket;
+
+        flight.tickets.clear();
+        flight.luggage.clear();
+        throw;
+    }
 }
 
-vector<Ticket *> Flight::getTickets() const {
+void Flight::setPassengerLoader(shared_ptr<const PassengerLoader> loader, const PassengerRange &range) {
+    this->passenger_loader = move(loader);
+    this->passenger_range = range;
+}
+
+bool Flight::hasPassengersLoaded() const {
+    return this->passenger_loader == nullptr;
+}
+
+const PassengerLoader *Flight::getPassengerLoader() const {
+    return this->passenger_loader.get();
+}
+
+const PassengerRange &Flight::getPassengerRange() const {
+    return this->passenger_range;
+}
+
+const vector<Ticket *> &Flight::getTickets() const {
+    this->loadPassengers();
     return this->tickets;
 }
 
+void Flight::forEachTicket(const function<void(const Ticket&)> &visitor) const {
+    // The loader is held, since it would be released if visiting had to fall back on loading the passengers
+    shared_ptr<const PassengerLoader> loader = this->passenger_loader;
+    if (loader != nullptr && loader->visitTickets(*this, this->passenger_range, visitor))
+        return;
+
+    for (const Ticket *ticket : this->getTickets())
+        visitor(*ticket);
+}
+
 Plane &Flight::getPlane() const {
     return this->plane;
 }
 
 void Flight::addLuggage(Luggage &luggage) {
+    this->loadPassengers();
     this->luggage.push_back(&luggage);
 }
 
-vector<Luggage*> Flight::getLuggage() const {
+const vector<Luggage*> &Flight::getLuggage() const {
+    this->loadPassengers();
     return this->luggage;
 }
 
+size_t Flight::getTicketCount() const {
+    return this->passenger_loader != nullptr ? this->passenger_range.ticket_count : this->tickets.size();
+}
+
+size_t Flight::getLuggageCount() const {
+    return this->passenger_loader != nullptr ? this->passenger_range.luggage_count : this->luggage.size();
+}
+
+bool Flight::overlaps(const Datetime &begin, const Datetime &end) const {
+    return this->departure_time < end && begin < this->arrival_time;
+}
+
 string Flight::str() const {
     ostringstream out;
     out << "Flight ID: " << this->getFlightId() << '\n'  
         << "At: " << this->getDepartureTime().str() << '\n'
         << "Duration: " << this->getDuration().str() << '\n'
+        << "Arrives: " << this->getArrivalTime().str() << '\n'
         << "From " << this->getOrigin().getName() << " to " << this->getDestination().getName();
 
     return out.str();
@@ -60,6 +133,8 @@ ostream& operator<<(ostream &out, const Flight &flight) {
 
 
 bool Flight::addTicket(Ticket &ticket) {
+    this->loadPassengers();
+
     if (this->tickets.size() < this->plane.getCapacity()) {
         auto it = utils::lowerBound<Ticket*, unsigned int>(this->tickets, ticket.getSeatNumber(), [](Ticket* ticket) {
             return ticket->getSeatNumber();
@@ -72,7 +147,24 @@ bool Flight::addTicket(Ticket &ticket) {
     return false;
 }
 
+bool Flight::addTickets(const vector<Ticket*> &tickets) {
+    this->loadPassengers();
+
+    if (this->tickets.size() + tickets.size() > this->plane.getCapacity())
+        return false;
+
+    size_t middle = this->tickets.size();
+    this->tickets.insert(this->tickets.end(), tickets.begin(), tickets.end());
+    inplace_merge(this->tickets.begin(), this->tickets.begin() + middle, this->tickets.end(), [](const Ticket *a, const Ticket *b) {
+        return a->getSeatNumber() < b->getSeatNumber();
+    });
+
+    return true;
+}
+
 bool Flight::removeTicket(const Ticket &ticket) {
+    this->loadPassengers();
+
     auto it = find(this->tickets.begin(), this->tickets.end(), &ticket);
     if (it != this->tickets.end()) {
         this->tickets.erase(it);
@@ -82,6 +174,8 @@ bool Flight::removeTicket(const Ticket &ticket) {
 }
 
 bool Flight::removeFirstTicket(const std::function<bool(const Ticket &)> &selector) {
+    this->loadPassengers();
+
     // FIXME
     for (auto it = tickets.begin(), end = tickets.end(); it != end; it++) {
         if (selector(**it)) {
@@ -94,21 +188,29 @@ bool Flight::removeFirstTicket(const std::function<bool(const Ticket &)> &select
 
 
 void Flight::setDepartureTime(Datetime &datetime) {
+    this->arrival_time = datetime.plus(this->duration);
     this->departure_time = datetime;
 }
 
 void Flight::setDuration(Time &duration) {
+    this->arrival_time = this->departure_time.plus(duration);
     this->duration = duration;
 }
 
 void Flight::setOrigin(Airport &origin) {
-    this->origin = origin;
+    this->origin = &origin;
 }
 
 void Flight::setDestination(Airport &destination) {
-    this->destination = destination;
+    this->destination = &destination;
 }
 
 void Flight::clearTickets() {
+    this->loadPassengers();
     this->tickets.clear();
 }
+
+void Flight::clearLuggage() {
+    this->loadPassengers();
+    this->luggage.clear();
+}
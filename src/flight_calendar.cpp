@@ -0,0 +1,130 @@
+#include "flight_calendar.h"
+#include "state.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+
+using namespace std;
+
+namespace flight_calendar {
+
+    struct Departure {
+        /** The departure time, as the minutes a Datetime holds */
+        uint32_t minutes;
+        Flight *flight;
+    };
+
+    /** The departures of every day that has any, keyed by the days since 0000/01/01 and sorted by departure time */
+    static map<uint32_t, vector<Departure>> days;
+    static bool is_built = false;
+
+    static uint32_t getDay(uint32_t minutes) {
+        return minutes / calendar::MINUTES_PER_DAY;
+    }
+
+    static vector<Departure>::const_iterator findFirstAt(const vector<Departure> &departures, uint32_t minutes) {
+        return lower_bound(departures.begin(), departures.end(), minutes, [](const Departure &departure, uint32_t minutes) {
+            return departure.minutes < minutes;
+        });
+    }
+
+    static void build() {
+        vector<Departure> departures;
+        departures.reserve(data::flights.size());
+        for (Flight *flight : data::flights)
+            departures.push_back(Departure { flight->getDepartureTime().getEpochMinutes(), flight });
+
+        sort(departures.begin(), departures.end(), [](const Departure &a, const Departure &b) {
+            return a.minutes < b.minutes;
+        });
+
+        days.clear();
+        for (auto first = departures.begin(); first != departures.end(); ) {
+            uint32_t day = getDay(first->minutes);
+            auto last = find_if(first, departures.end(), [day](const Departure &departure) {
+                return getDay(departure.minutes) != day;
+            });
+
+            days.emplace_hint(days.end(), day, vector<Departure>(first, last));
+            first = last;
+        }
+
+        is_built = true;
+    }
+
+    static void insert(Flight &flight) {
+        uint32_t minutes = flight.getDepartureTime().getEpochMinutes();
+        vector<Departure> &departures = days[getDay(minutes)];
+
+        auto position = upper_bound(departures.begin(), departures.end(), minutes, [](uint32_t minutes, const Departure &departure) {
+            return minutes < departure.minutes;
+        });
+
+        departures.insert(position, Departure { minutes, &flight });
+    }
+
+    static void erase(const Flight &flight, uint32_t minutes) {
+        auto day = days.find(getDay(minutes));
+        if (day != days.end()) {
+            vector<Departure> &departures = day->second;
+            for (auto departure = findFirstAt(departures, minutes); departure != departures.end() && departure->minutes == minutes; departure++) {
+                if (departure->flight != &flight)
+                    continue;
+
+                departures.erase(departure);
+                if (departures.empty())
+                    days.erase(day);
+
+                return;
+            }
+        }
+
+        // The flight was changed without going through `crud`, so the index can't be trusted anymore
+        invalidate();
+    }
+
+    void add(Flight &flight) {
+        if (is_built)
+            insert(flight);
+    }
+
+    void remove(const Flight &flight) {
+        if (is_built)
+            erase(flight, flight.getDepartureTime().getEpochMinutes());
+    }
+
+    void move(Flight &flight, const Datetime &departure_time) {
+        if (!is_built)
+            return;
+
+        erase(flight, departure_time.getEpochMinutes());
+        if (is_built)
+            insert(flight);
+    }
+
+    void invalidate() {
+        days.clear();
+        is_built = false;
+    }
+
+    vector<Flight*> findDepartures(const Datetime &begin, const Datetime &end) {
+        if (!is_built)
+            build();
+
+        vector<Flight*> flights;
+        uint32_t first = begin.getEpochMinutes(), last = end.getEpochMinutes();
+        if (last <= first)
+            return flights;
+
+        // Only the first day needs a search, as every departure of the days after it is at or after the beginning of the window
+        for (auto day = days.lower_bound(getDay(first)); day != days.end() && day->first <= getDay(last - 1); day++) {
+            const vector<Departure> &departures = day->second;
+            auto departure = day->first == getDay(first) ? findFirstAt(departures, first) : departures.begin();
+
+            for (; departure != departures.end() && departure->minutes < last; departure++)
+                flights.push_back(departure->flight);
+        }
+
+        return flights;
+    }
+}
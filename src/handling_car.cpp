@@ -21,7 +21,7 @@ HandlingCar::HandlingCar(const unsigned int number_of_carriages, const unsigned
         throw invalid_argument("Number of luggage per stack must be greater than 0");
 }
 
-unsigned int HandlingCar::getId() {
+unsigned int HandlingCar::getId() const {
     return this->id;
 }
 
@@ -86,7 +86,7 @@ Luggage *HandlingCar::getNextLuggage() const {
     if (backLuggageStack == nullptr || backLuggageStack->empty())
         return nullptr;
 
-    return backLuggageStack->top();
+    return backLuggageStack->back();
 }
 
 Luggage *HandlingCar::unloadNextLuggage() {
@@ -95,8 +95,8 @@ Luggage *HandlingCar::unloadNextLuggage() {
     if (backLuggageStack == nullptr || backLuggageStack->empty())
         return nullptr;
 
-    Luggage &luggage = *backLuggageStack->top();
-    backLuggageStack->pop();
+    Luggage &luggage = *backLuggageStack->back();
+    backLuggageStack->pop_back();
 
     Carriage *backCarriage = this->getBackCarriage();
     if (backLuggageStack->empty())
@@ -148,13 +148,13 @@ bool HandlingCar::addLuggage(Luggage &luggage) {
 
     LuggageStack *backLuggageStack = this->ensureBackLuggageStackExists();
     if (backLuggageStack->size() < this->luggage_per_stack) {
-        backLuggageStack->push(&luggage);
+        backLuggageStack->push_back(&luggage);
         return true;
     }
 
     // We need to create a new stack and add it to a carriage
     LuggageStack new_stack;
-    new_stack.push(&luggage);
+    new_stack.push_back(&luggage);
 
     Carriage *backCarriage = this->ensureBackCarriageExists();
     if (backCarriage->size() < this->stacks_per_carriage) {
@@ -181,7 +181,12 @@ void HandlingCar::setFlight(Flight &flight) {
     this->flight = &flight;
 }
 
-deque<Carriage> HandlingCar::getCarriages() const {
+void HandlingCar::clearFlight() {
+    this->flight = nullptr;
+    this->carriages.clear();
+}
+
+const deque<Carriage> &HandlingCar::getCarriages() const {
     return this->carriages;
 }
 
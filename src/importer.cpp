@@ -0,0 +1,1097 @@
+#include "importer.h"
+#include "files.h"
+#include "flight_calendar.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "state.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace importer {
+
+    /** Size of the pieces a file is split into, so that they can be parsed on several threads */
+    static const size_t CHUNK_SIZE = 1 << 20;
+
+    /**
+     * @brief Walks the fields of a CSV line
+     */
+    class CsvLine {
+        string_view rest;
+        bool is_done = false;
+        /** Storage for the fields that had to be unescaped, which the returned views point into */
+        deque<string> &unescaped;
+
+    public:
+        CsvLine(string_view line, deque<string> &unescaped) : rest(line), unescaped(unescaped) {}
+
+        /**
+         * @brief Reads the next field
+         * @param name The name of the field, for error messages
+         */
+        string_view field(const char *name) {
+            if (is_done)
+                throw runtime_error(string("Missing the ") + name + " field");
+
+            if (rest.empty() || rest.front() != '"') {
+                size_t comma = rest.find(',');
+                string_view value = rest.substr(0, comma);
+
+                is_done = comma == string_view::npos;
+                rest.remove_prefix(is_done ? rest.size() : comma + 1);
+                return value;
+            }
+
+            // Quoted fields end at the first quote that isn't doubled
+            size_t end = 1;
+            bool has_quotes = false;
+            while (true) {
+                end = rest.find('"', end);
+                if (end == string_view::npos)
+                    throw runtime_error(string("Unterminated quotes in the ") + name + " field");
+
+                if (end + 1 < rest.size() && rest[end + 1] == '"') {
+                    has_quotes = true;
+                    end += 2;
+                } else {
+                    break;
+                }
+            }
+
+            string_view value = rest.substr(1, end - 1);
+            rest.remove_prefix(end + 1);
+
+            if (rest.empty())
+                is_done = true;
+            else if (rest.front() == ',')
+                rest.remove_prefix(1);
+            else
+                throw runtime_error(string("Unexpected text after the ") + name + " field");
+
+            if (!has_quotes)
+                return value;
+
+            string &copy = unescaped.emplace_back();
+            copy.reserve(value.size());
+            for (size_t i = 0; i < value.size(); i++) {
+                copy.push_back(value[i]);
+                if (value[i] == '"')
+                    i++;
+            }
+
+            return copy;
+        }
+
+        /**
+         * @brief Reads the next field, which must not be empty nor contain whitespace
+         */
+        string_view word(const char *name) {
+            string_view value = field(name);
+            if (value.empty() || any_of(value.begin(), value.end(), [](char c) { return isspace(static_cast<unsigned char>(c)); }))
+                throw runtime_error(string("The ") + name + " must be a single word");
+
+            return value;
+        }
+
+        /**
+         * @brief Reads the next field, which must not be empty
+         */
+        string_view text(const char *name) {
+            string_view value = field(name);
+            if (value.empty())
+                throw runtime_error(string("The ") + name + " must not be empty");
+
+            return value;
+        }
+
+        template <typename T>
+        T number(const char *name) {
+            string_view value = field(name);
+
+            T number;
+            auto [next, error] = from_chars(value.data(), value.data() + value.size(), number);
+            if (error != errc() || next != value.data() + value.size())
+                throw runtime_error(string("Invalid ") + name);
+
+            return number;
+        }
+
+        /**
+         * @brief Reads the next field, where "\\N" stands for a missing value
+         * @return The field, or an empty view if the value is missing
+         */
+        string_view nullableField(const char *name) {
+            string_view value = field(name);
+            return value == "\\N" ? string_view() : value;
+        }
+
+        /**
+         * @throws std::runtime_error if there are fields left
+         */
+        void end() const {
+            if (!is_done)
+                throw runtime_error("Too many fields");
+        }
+
+        /**
+         * @brief Ignores the fields that are left
+         */
+        void skipRest() {
+            is_done = true;
+            rest = string_view();
+        }
+    };
+
+    struct AirportRow {
+        const char *position;
+        string_view name;
+    };
+
+    struct PlaneRow {
+        const char *position;
+        string_view license_plate;
+        string_view type;
+        unsigned int capacity;
+    };
+
+    struct FlightRow {
+        const char *position;
+        FlightKey key;
+        Time duration;
+        string_view origin_name;
+        string_view destination_name;
+        string_view license_plate;
+        string_view departure_text;
+
+        Airport *origin = nullptr;
+        Airport *destination = nullptr;
+        Plane *plane = nullptr;
+    };
+
+    struct TicketRow {
+        const char *position;
+        FlightKey key;
+        string_view customer_name;
+        unsigned int customer_age;
+        unsigned int seat_number;
+        string_view departure_text;
+
+        Flight *flight = nullptr;
+    };
+
+    struct LuggageRow {
+        const char *position;
+        FlightKey key;
+        unsigned int seat_number;
+        float weight;
+        string_view departure_text;
+
+        Flight *flight = nullptr;
+    };
+
+    template <typename Row>
+    Row parseRow(CsvLine &line, const char *position);
+
+    template <>
+    AirportRow parseRow(CsvLine &line, const char *position) {
+        AirportRow row = { position, line.text("name") };
+        line.end();
+        return row;
+    }
+
+    template <>
+    PlaneRow parseRow(CsvLine &line, const char *position) {
+        PlaneRow row = { position, line.word("license plate"), line.text("type"), line.number<unsigned int>("capacity") };
+        line.end();
+        return row;
+    }
+
+    /** The departure of rows whose departure time wasn't parsed yet */
+    const Datetime UNPARSED_DEPARTURE(0, 1, 1, 0, 0);
+
+    /**
+     * @brief Reads the flight id and departure time of a row. The departure time is only kept as text,
+     * since the departure times of a whole chunk are parsed together once its rows are read.
+     */
+    FlightKey parseFlightKey(CsvLine &line, string_view &departure_text) {
+        string_view flight_id = line.word("flight id");
+        departure_text = line.field("departure time");
+        return FlightKey { flight_id, UNPARSED_DEPARTURE };
+    }
+
+    template <>
+    FlightRow parseRow(CsvLine &line, const char *position) {
+        string_view departure_text;
+        FlightRow row = {
+            position, parseFlightKey(line, departure_text), files::parseTime(line.field("duration")),
+            line.text("origin"), line.text("destination"), line.word("license plate"), departure_text
+        };
+
+        line.end();
+        return row;
+    }
+
+    template <>
+    TicketRow parseRow(CsvLine &line, const char *position) {
+        string_view departure_text;
+        TicketRow row = {
+            position, parseFlightKey(line, departure_text), line.text("customer name"),
+            line.number<unsigned int>("customer age"), line.number<unsigned int>("seat number"), departure_text
+        };
+
+        line.end();
+        return row;
+    }
+
+    template <>
+    LuggageRow parseRow(CsvLine &line, const char *position) {
+        string_view departure_text;
+        LuggageRow row = {
+            position, parseFlightKey(line, departure_text), line.number<unsigned int>("seat number"), line.number<float>("weight"), departure_text
+        };
+        if (!(row.weight > 0))
+            throw runtime_error("The weight must be positive");
+
+        line.end();
+        return row;
+    }
+
+    struct OpenFlightsAirportRow {
+        const char *position;
+        string_view id;
+        string_view name;
+        string_view iata;
+        string_view icao;
+        double latitude;
+        double longitude;
+    };
+
+    struct OpenFlightsRouteRow {
+        const char *position;
+        string_view airline;
+        string_view source_code;
+        string_view source_id;
+        string_view destination_code;
+        string_view destination_id;
+        bool is_codeshare;
+        string_view equipment;
+    };
+
+    struct OpenFlightsPlaneRow {
+        const char *position;
+        string_view name;
+        string_view iata;
+        string_view icao;
+    };
+
+    template <>
+    OpenFlightsAirportRow parseRow(CsvLine &line, const char *position) {
+        OpenFlightsAirportRow row = {};
+        row.position = position;
+        row.id = line.text("airport id");
+        row.name = line.text("name");
+        line.field("city");
+        line.field("country");
+        row.iata = line.nullableField("IATA code");
+        row.icao = line.nullableField("ICAO code");
+        row.latitude = line.number<double>("latitude");
+        row.longitude = line.number<double>("longitude");
+
+        // Altitude, time zone and source are of no use here
+        line.skipRest();
+        return row;
+    }
+
+    template <>
+    OpenFlightsRouteRow parseRow(CsvLine &line, const char *position) {
+        OpenFlightsRouteRow row = {};
+        row.position = position;
+        row.airline = line.nullableField("airline");
+        line.field("airline id");
+        row.source_code = line.nullableField("source airport");
+        row.source_id = line.nullableField("source airport id");
+        row.destination_code = line.nullableField("destination airport");
+        row.destination_id = line.nullableField("destination airport id");
+        row.is_codeshare = line.field("codeshare") == "Y";
+        line.field("stops");
+        row.equipment = line.nullableField("equipment");
+        line.end();
+        return row;
+    }
+
+    template <>
+    OpenFlightsPlaneRow parseRow(CsvLine &line, const char *position) {
+        OpenFlightsPlaneRow row = {};
+        row.position = position;
+        row.name = line.text("name");
+        row.iata = line.nullableField("IATA code");
+        row.icao = line.nullableField("ICAO code");
+        line.end();
+        return row;
+    }
+
+    /**
+     * @brief A CSV file of the feed and the first error found in it.
+     * Rows are checked on several threads, so the error that is kept is the one closest to the start of the file.
+     */
+    class CsvSource {
+        string path;
+        unique_ptr<MappedFile> mapping;
+
+        mutex error_mutex;
+        const char *error_position = nullptr;
+        string error_message;
+
+    public:
+        explicit CsvSource(const string &path) : path(path) {
+            if (path.empty())
+                return;
+
+            try {
+                mapping = make_unique<MappedFile>(path);
+            } catch (exception &exception) {
+                throw runtime_error(path + ": " + exception.what());
+            }
+        }
+
+        string_view getText() const {
+            return mapping == nullptr ? string_view() : mapping->view();
+        }
+
+        void report(const char *position, const string &message) {
+            lock_guard<mutex> lock(error_mutex);
+            if (error_position == nullptr || position < error_position) {
+                error_position = position;
+                error_message = message;
+            }
+        }
+
+        /**
+         * @throws std::runtime_error if an error was reported, naming the line it was found in
+         */
+        void check() const {
+            if (error_position == nullptr)
+                return;
+
+            string_view text = getText();
+            size_t line = count(text.data(), error_position, '\n') + 1;
+            throw runtime_error(path + ", line " + to_string(line) + ": " + error_message);
+        }
+    };
+
+    /**
+     * @brief The rows of a CSV file, split into chunks that can be parsed independently
+     */
+    template <typename Row>
+    class CsvFile : public CsvSource {
+        struct Chunk {
+            string_view text;
+            vector<Row> rows;
+            deque<string> unescaped;
+        };
+
+        deque<Chunk> chunks;
+
+    public:
+        /**
+         * @brief Maps the file and splits it at line boundaries, leaving out the header if it has one
+         */
+        explicit CsvFile(const string &path, bool has_header = true) : CsvSource(path) {
+            string_view text = getText();
+
+            size_t start = 0;
+            if (has_header) {
+                size_t header_end = text.find('\n');
+                start = header_end == string_view::npos ? text.size() : header_end + 1;
+            }
+
+            while (start < text.size()) {
+                size_t end = text.size();
+                if (text.size() - start > CHUNK_SIZE) {
+                    size_t newline = text.find('\n', start + CHUNK_SIZE);
+                    end = newline == string_view::npos ? text.size() : newline + 1;
+                }
+
+                chunks.emplace_back().text = text.substr(start, end - start);
+                start = end;
+            }
+        }
+
+        size_t getChunkCount() const {
+            return chunks.size();
+        }
+
+        /**
+         * @brief Parses the rows of a chunk, stopping at the first invalid one
+         */
+        void parseChunk(size_t index) {
+            Chunk &chunk = chunks[index];
+            string_view text = chunk.text;
+            chunk.rows.reserve(count(text.begin(), text.end(), '\n') + 1);
+
+            while (!text.empty()) {
+                size_t newline = text.find('\n');
+                string_view content = text.substr(0, newline);
+                text.remove_prefix(newline == string_view::npos ? text.size() : newline + 1);
+
+                if (!content.empty() && content.back() == '\r')
+                    content.remove_suffix(1);
+
+                if (content.empty())
+                    continue;
+
+                try {
+                    CsvLine line(content, chunk.unescaped);
+                    chunk.rows.push_back(parseRow<Row>(line, content.data()));
+                } catch (exception &exception) {
+                    report(content.data(), exception.what());
+                    break;
+                }
+            }
+
+            if constexpr (requires (Row &row) { row.departure_text; })
+                parseDepartures(chunk);
+        }
+
+        /**
+         * @brief Parses the departure times of a chunk's rows as a column, which is faster than one at a time,
+         * since consecutive rows mostly belong to the same flight. Drops the rows from the first invalid one.
+         */
+        void parseDepartures(Chunk &chunk) {
+            vector<string_view> texts;
+            texts.reserve(chunk.rows.size());
+            for (const Row &row : chunk.rows)
+                texts.push_back(row.departure_text);
+
+            vector<Datetime> departures;
+            auto [parsed, error] = Datetime::parseColumn(texts, departures);
+            for (size_t i = 0; i < parsed; i++)
+                chunk.rows[i].key.departure_time = departures[i];
+
+            if (error != errc()) {
+                report(chunk.rows[parsed].position, error == errc::result_out_of_range ? "Datetime out of range" : "Malformed datetime");
+                chunk.rows.erase(chunk.rows.begin() + parsed, chunk.rows.end());
+            }
+        }
+
+        /**
+         * @brief Calls the task with every row, in file order
+         */
+        template <typename Task>
+        void forEachRow(Task task) {
+            for (Chunk &chunk : chunks)
+                for (Row &row : chunk.rows)
+                    task(row);
+        }
+
+        /**
+         * @brief Calls the task with every row, with the chunks spread over several threads.
+         * A task that throws reports the error for its row and moves on to the next one.
+         */
+        template <typename Task>
+        void forEachRowInParallel(Task task) {
+            parallel::forEach(chunks.size(), [&](size_t i) {
+                for (Row &row : chunks[i].rows) {
+                    try {
+                        task(row);
+                    } catch (exception &exception) {
+                        report(row.position, exception.what());
+                    }
+                }
+            });
+        }
+
+        size_t getRowCount() const {
+            size_t count = 0;
+            for (const Chunk &chunk : chunks)
+                count += chunk.rows.size();
+
+            return count;
+        }
+    };
+
+    /**
+     * @brief Rows of a file put together by the flight they belong to, keeping their order within each flight
+     */
+    template <typename Row>
+    struct FlightGroups {
+        vector<Flight*> flights;
+        unordered_map<const Flight*, size_t> index;
+        /** The rows of group i are rows[offsets[i]] to rows[offsets[i + 1]] */
+        vector<size_t> offsets;
+        vector<Row*> rows;
+
+        explicit FlightGroups(CsvFile<Row> &file) {
+            vector<size_t> counts;
+            file.forEachRow([&](Row &row) {
+                auto [it, inserted] = index.emplace(row.flight, flights.size());
+                if (inserted) {
+                    flights.push_back(row.flight);
+                    counts.push_back(0);
+                }
+
+                counts[it->second]++;
+            });
+
+            offsets.resize(flights.size() + 1, 0);
+            for (size_t i = 0; i < flights.size(); i++)
+                offsets[i + 1] = offsets[i] + counts[i];
+
+            rows.resize(offsets.back());
+            vector<size_t> next(offsets.begin(), offsets.end() - 1);
+            file.forEachRow([&](Row &row) {
+                rows[next[index.at(row.flight)]++] = &row;
+            });
+        }
+
+        size_t size() const {
+            return flights.size();
+        }
+
+        typename vector<Row*>::iterator begin(size_t group) {
+            return rows.begin() + offsets[group];
+        }
+
+        typename vector<Row*>::iterator end(size_t group) {
+            return rows.begin() + offsets[group + 1];
+        }
+    };
+
+    /**
+     * @brief Finds a flight's ticket by seat, since tickets are kept sorted by seat
+     */
+    Ticket *findTicketBySeat(const vector<Ticket*> &tickets, unsigned int seat_number) {
+        auto it = lower_bound(tickets.begin(), tickets.end(), seat_number, [](const Ticket *ticket, unsigned int seat_number) {
+            return ticket->getSeatNumber() < seat_number;
+        });
+
+        return it != tickets.end() && (*it)->getSeatNumber() == seat_number ? *it : nullptr;
+    }
+
+    /**
+     * @brief Records created while checking an import, which are deleted if the import fails before they are added to the data
+     */
+    struct PendingRecords {
+        vector<Airport*> airports;
+        vector<Plane*> planes;
+        vector<Flight*> flights;
+        bool is_committed = false;
+
+        ~PendingRecords() {
+            if (is_committed)
+                return;
+
+            for (Flight *flight : flights)
+                delete flight;
+
+            for (Plane *plane : planes)
+                delete plane;
+
+            for (Airport *airport : airports)
+                delete airport;
+        }
+    };
+
+    /**
+     * @brief Sorts new elements and merges them into a sorted container
+     */
+    template <typename T, typename Compare>
+    void mergeInto(vector<T*> &container, vector<T*> &elements, Compare compare) {
+        if (!is_sorted(elements.begin(), elements.end(), compare))
+            stable_sort(elements.begin(), elements.end(), compare);
+
+        size_t middle = container.size();
+        container.insert(container.end(), elements.begin(), elements.end());
+        inplace_merge(container.begin(), container.begin() + middle, container.end(), compare);
+    }
+
+    /**
+     * @brief Parses the files, with the chunks of all of them spread over the threads together so that small files don't
+     * leave threads idle
+     *
+     * @throws std::runtime_error naming the first malformed row, checking the files in the given order
+     */
+    template <typename... Files>
+    void parseFiles(Files &...files) {
+        vector<function<void()>> tasks;
+        auto addTasks = [&tasks](auto &file) {
+            for (size_t i = 0; i < file.getChunkCount(); i++)
+                tasks.push_back([&file, i]() { file.parseChunk(i); });
+        };
+
+        (addTasks(files), ...);
+        parallel::forEach(tasks.size(), [&tasks](size_t i) { tasks[i](); });
+        (files.check(), ...);
+    }
+
+    bool exists(const string &path) {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0;
+    }
+
+    CsvSources findCsvSources(const string &directory) {
+        auto find = [&directory](const char *name) {
+            string path = directory + "/" + name + ".csv";
+            return exists(path) ? path : string();
+        };
+
+        CsvSources sources = {
+            .airports = find("airports"),
+            .planes = find("planes"),
+            .flights = find("flights"),
+            .tickets = find("tickets"),
+            .luggage = find("luggage")
+        };
+
+        if (sources.airports.empty() && sources.planes.empty() && sources.flights.empty() && sources.tickets.empty() && sources.luggage.empty())
+            throw runtime_error("No CSV files were found in " + directory);
+
+        return sources;
+    }
+
+    ImportResult importCsv(const CsvSources &sources) {
+        CsvFile<AirportRow> airport_file(sources.airports);
+        CsvFile<PlaneRow> plane_file(sources.planes);
+        CsvFile<FlightRow> flight_file(sources.flights);
+        CsvFile<TicketRow> ticket_file(sources.tickets);
+        CsvFile<LuggageRow> luggage_file(sources.luggage);
+
+        parseFiles(airport_file, plane_file, flight_file, ticket_file, luggage_file);
+
+        PendingRecords pending;
+
+        unordered_map<string_view, Airport*> airports_by_name;
+        airports_by_name.reserve(data::airports.size() + airport_file.getRowCount());
+        for (Airport *airport : data::airports)
+            airports_by_name.emplace(airport->getName(), airport);
+
+        airport_file.forEachRow([&](AirportRow &row) {
+            if (airports_by_name.count(row.name) != 0)
+                return airport_file.report(row.position, "An airport named " + string(row.name) + " already exists");
+
+            Airport *airport = pending.airports.emplace_back(new Airport(string(row.name)));
+            airports_by_name.emplace(airport->getName(), airport);
+        });
+
+        airport_file.check();
+
+        unordered_map<string_view, Plane*> planes_by_license_plate;
+        planes_by_license_plate.reserve(data::planes.size() + plane_file.getRowCount());
+        for (Plane *plane : data::planes)
+            planes_by_license_plate.emplace(plane->getLicensePlate(), plane);
+
+        plane_file.forEachRow([&](PlaneRow &row) {
+            if (planes_by_license_plate.count(row.license_plate) != 0)
+                return plane_file.report(row.position, "The license plate " + string(row.license_plate) + " already belongs to a plane");
+
+            Plane *plane = pending.planes.emplace_back(new Plane(string(row.license_plate), string(row.type), row.capacity));
+            planes_by_license_plate.emplace(plane->getLicensePlate(), plane);
+        });
+
+        plane_file.check();
+
+        // References are resolved in parallel, while the flights themselves are created in order to find duplicates
+        flight_file.forEachRowInParallel([&](FlightRow &row) {
+            auto origin = airports_by_name.find(row.origin_name);
+            auto destination = airports_by_name.find(row.destination_name);
+            auto plane = planes_by_license_plate.find(row.license_plate);
+
+            if (origin == airports_by_name.end())
+                throw runtime_error("Unknown origin airport " + string(row.origin_name));
+            if (destination == airports_by_name.end())
+                throw runtime_error("Unknown destination airport " + string(row.destination_name));
+            if (origin->second == destination->second)
+                throw runtime_error("The destination airport must not be the same as the origin airport");
+            if (plane == planes_by_license_plate.end())
+                throw runtime_error("Unknown license plate " + string(row.license_plate));
+
+            row.origin = origin->second;
+            row.destination = destination->second;
+            row.plane = plane->second;
+        });
+
+        flight_file.check();
+
+        unordered_map<FlightKey, Flight*, FlightKeyHash> flights_by_key;
+        flights_by_key.reserve(data::flights.size() + flight_file.getRowCount());
+        for (Flight *flight : data::flights)
+            flights_by_key.emplace(FlightKey { flight->getFlightId(), flight->getDepartureTime() }, flight);
+
+        flight_file.forEachRow([&](FlightRow &row) {
+            if (flights_by_key.count(row.key) != 0)
+                return flight_file.report(row.position, "Flight " + string(row.key.flight_id) + " already departs at " + row.key.departure_time.str());
+
+            Flight *flight = pending.flights.emplace_back(
+                new Flight(string(row.key.flight_id), row.key.departure_time, row.duration, *row.origin, *row.destination, *row.plane)
+            );
+
+            flights_by_key.emplace(FlightKey { flight->getFlightId(), flight->getDepartureTime() }, flight);
+        });
+
+        flight_file.check();
+
+        auto findFlight = [&flights_by_key](const FlightKey &key) {
+            auto flight = flights_by_key.find(key);
+            if (flight == flights_by_key.end())
+                throw runtime_error("No flight " + string(key.flight_id) + " departs at " + key.departure_time.str());
+
+            return flight->second;
+        };
+
+        ticket_file.forEachRowInParallel([&](TicketRow &row) {
+            row.flight = findFlight(row.key);
+
+            const Plane &plane = row.flight->getPlane();
+            if (row.seat_number >= plane.getCapacity())
+                throw runtime_error("Seat " + to_string(row.seat_number) + " is not on plane " + plane.getLicensePlate()
+                                    + ", which has " + to_string(plane.getCapacity()) + " seats");
+        });
+
+        luggage_file.forEachRowInParallel([&](LuggageRow &row) {
+            row.flight = findFlight(row.key);
+        });
+
+        ticket_file.check();
+        luggage_file.check();
+
+        FlightGroups<TicketRow> ticket_groups(ticket_file);
+        FlightGroups<LuggageRow> luggage_groups(luggage_file);
+
+        // Passengers that haven't been loaded yet are loaded here, since loading them isn't safe on several threads
+        for (Flight *flight : ticket_groups.flights)
+            flight->getTickets();
+        for (Flight *flight : luggage_groups.flights)
+            flight->getTickets();
+
+        parallel::forEach(ticket_groups.size(), [&](size_t group) {
+            Flight &flight = *ticket_groups.flights[group];
+            const vector<Ticket*> &tickets = flight.getTickets();
+
+            auto first = ticket_groups.begin(group), last = ticket_groups.end(group);
+            stable_sort(first, last, [](const TicketRow *a, const TicketRow *b) {
+                return a->seat_number < b->seat_number;
+            });
+
+            for (auto it = first; it != last; it++) {
+                const TicketRow &row = **it;
+                if ((it != first && (*(it - 1))->seat_number == row.seat_number) || findTicketBySeat(tickets, row.seat_number) != nullptr)
+                    ticket_file.report(row.position, "Seat " + to_string(row.seat_number) + " of this flight is already taken");
+            }
+
+            if (tickets.size() + (last - first) > flight.getPlane().getCapacity())
+                ticket_file.report((*(last - 1))->position, "There is no room left on this flight");
+        });
+
+        ticket_file.check();
+
+        luggage_file.forEachRowInParallel([&](LuggageRow &row) {
+            if (findTicketBySeat(row.flight->getTickets(), row.seat_number) != nullptr)
+                return;
+
+            auto group = ticket_groups.index.find(row.flight);
+            if (group != ticket_groups.index.end()) {
+                auto first = ticket_groups.begin(group->second), last = ticket_groups.end(group->second);
+                auto ticket = lower_bound(first, last, row.seat_number, [](const TicketRow *ticket, unsigned int seat_number) {
+                    return ticket->seat_number < seat_number;
+                });
+
+                if (ticket != last && (*ticket)->seat_number == row.seat_number)
+                    return;
+            }
+
+            throw runtime_error("No ticket of this flight has seat " + to_string(row.seat_number));
+        });
+
+        luggage_file.check();
+
+        // Everything was checked, so nothing can fail from here on
+        ImportResult result = {
+            .airports = pending.airports.size(),
+            .planes = pending.planes.size(),
+            .flights = pending.flights.size(),
+            .tickets = ticket_file.getRowCount(),
+            .luggage = luggage_file.getRowCount()
+        };
+
+        pending.is_committed = true;
+
+        mergeInto(data::airports, pending.airports, [](const Airport *a, const Airport *b) {
+            return a->getName() < b->getName();
+        });
+
+        mergeInto(data::planes, pending.planes, [](const Plane *a, const Plane *b) {
+            return a->getLicensePlate() < b->getLicensePlate();
+        });
+
+        for (Flight *flight : pending.flights)
+            flight->getPlane().addFlight(*flight);
+
+        mergeInto(data::flights, pending.flights, [](const Flight *a, const Flight *b) {
+            return a->getFlightId() < b->getFlightId();
+        });
+        flight_calendar::invalidate();
+
+        parallel::forEach(ticket_groups.size(), [&](size_t group) {
+            Flight &flight = *ticket_groups.flights[group];
+
+            vector<Ticket*> tickets;
+            tickets.reserve(ticket_groups.end(group) - ticket_groups.begin(group));
+            for (auto it = ticket_groups.begin(group); it != ticket_groups.end(group); it++)
+                tickets.push_back(new Ticket(flight, string((*it)->customer_name), (*it)->customer_age, (*it)->seat_number));
+
+            flight.addTickets(tickets);
+        });
+
+        parallel::forEach(luggage_groups.size(), [&](size_t group) {
+            Flight &flight = *luggage_groups.flights[group];
+            const vector<Ticket*> &tickets = flight.getTickets();
+
+            for (auto it = luggage_groups.begin(group); it != luggage_groups.end(group); it++)
+                flight.addLuggage(*new Luggage(*findTicketBySeat(tickets, (*it)->seat_number), (*it)->weight));
+        });
+
+        return result;
+    }
+
+    OpenFlightsSources findOpenFlightsSources(const string &directory) {
+        OpenFlightsSources sources = {
+            .airports = directory + "/airports.dat",
+            .routes = directory + "/routes.dat",
+            .planes = directory + "/planes.dat"
+        };
+
+        if (!exists(sources.airports) || !exists(sources.routes))
+            throw runtime_error("The airports.dat and routes.dat files of OpenFlights were not found in " + directory);
+
+        if (!exists(sources.planes))
+            sources.planes.clear();
+
+        return sources;
+    }
+
+    /** Speed used to estimate how long flights take, in km/h */
+    static const double CRUISE_SPEED = 800;
+
+    /** Minutes added to every flight for taxiing, takeoff and landing */
+    static const long TAXI_MINUTES = 30;
+
+    /**
+     * @brief Distance between two points of the Earth, in kilometers
+     */
+    double greatCircleDistance(double latitude_a, double longitude_a, double latitude_b, double longitude_b) {
+        const double EARTH_RADIUS = 6371;
+        const double RADIANS = M_PI / 180;
+
+        double latitude_delta = (latitude_b - latitude_a) * RADIANS;
+        double longitude_delta = (longitude_b - longitude_a) * RADIANS;
+        double haversine = pow(sin(latitude_delta / 2), 2)
+                           + cos(latitude_a * RADIANS) * cos(latitude_b * RADIANS) * pow(sin(longitude_delta / 2), 2);
+
+        return 2 * EARTH_RADIUS * asin(min(1.0, sqrt(haversine)));
+    }
+
+    ImportResult importOpenFlights(const OpenFlightsSources &sources, const OpenFlightsOptions &options) {
+        CsvFile<OpenFlightsAirportRow> airport_file(sources.airports, false);
+        CsvFile<OpenFlightsRouteRow> route_file(sources.routes, false);
+        CsvFile<OpenFlightsPlaneRow> plane_file(sources.planes, false);
+        parseFiles(airport_file, route_file, plane_file);
+
+        PendingRecords pending;
+        ImportResult result;
+
+        unordered_map<string_view, Airport*> airports_by_name;
+        airports_by_name.reserve(data::airports.size() + airport_file.getRowCount());
+        for (Airport *airport : data::airports)
+            airports_by_name.emplace(airport->getName(), airport);
+
+        // Routes refer to airports by their OpenFlights id, or by their code when the id is missing
+        struct Location {
+            Airport *airport;
+            double latitude;
+            double longitude;
+        };
+
+        vector<Location> locations;
+        unordered_map<string_view, size_t> locations_by_id;
+        unordered_map<string_view, size_t> locations_by_code;
+
+        airport_file.forEachRow([&](OpenFlightsAirportRow &row) {
+            string_view code = !row.iata.empty() ? row.iata : !row.icao.empty() ? row.icao : row.id;
+            string name = string(row.name) + " (" + string(code) + ")";
+
+            Airport *airport;
+            auto existing = airports_by_name.find(name);
+            if (existing != airports_by_name.end()) {
+                airport = existing->second;
+            } else {
+                airport = pending.airports.emplace_back(new Airport(name));
+                airports_by_name.emplace(airport->getName(), airport);
+            }
+
+            locations_by_id.emplace(row.id, locations.size());
+            if (!row.iata.empty())
+                locations_by_code.emplace(row.iata, locations.size());
+            if (!row.icao.empty())
+                locations_by_code.emplace(row.icao, locations.size());
+
+            locations.push_back(Location { airport, row.latitude, row.longitude });
+        });
+
+        auto findLocation = [&](string_view id, string_view code) -> const Location* {
+            auto location = locations_by_id.find(id);
+            if (location != locations_by_id.end())
+                return &locations[location->second];
+
+            location = locations_by_code.find(code);
+            return location == locations_by_code.end() ? nullptr : &locations[location->second];
+        };
+
+        unordered_map<string_view, string_view> type_names;
+        plane_file.forEachRow([&](OpenFlightsPlaneRow &row) {
+            if (!row.iata.empty())
+                type_names.emplace(row.iata, row.name);
+        });
+
+        struct Route {
+            string flight_id;
+            const Location *origin;
+            const Location *destination;
+            string type;
+            Time departure;
+            Time duration;
+        };
+
+        vector<Route> routes;
+        unordered_map<string, unsigned int> routes_per_airline;
+        size_t route_index = 0;
+
+        route_file.forEachRow([&](OpenFlightsRouteRow &row) {
+            route_index++;
+
+            const Location *origin = findLocation(row.source_id, row.source_code);
+            const Location *destination = findLocation(row.destination_id, row.destination_code);
+
+            // Codeshares are flown by another airline's route, so they would only duplicate it
+            if (row.is_codeshare || origin == nullptr || destination == nullptr || origin->airport == destination->airport) {
+                result.skipped++;
+                return;
+            }
+
+            bool is_word = !row.airline.empty() && all_of(row.airline.begin(), row.airline.end(), [](char c) { return isalnum(static_cast<unsigned char>(c)); });
+            string airline = is_word ? string(row.airline) : "OF";
+            unsigned int number = ++routes_per_airline[airline];
+
+            string_view equipment = row.equipment.substr(0, row.equipment.find(' '));
+            auto type_name = type_names.find(equipment);
+            string type = type_name != type_names.end() ? string(type_name->second) : equipment.empty() ? "Unknown" : string(equipment);
+
+            // The departure time only depends on the position of the route in the file, so that it is the same on every import
+            uint64_t mix = route_index * 0x9E3779B97F4A7C15ull;
+            mix ^= mix >> 29;
+            Time departure(5 + (mix >> 32) % 18, (mix >> 16) % 12 * 5);
+
+            double distance = greatCircleDistance(origin->latitude, origin->longitude, destination->latitude, destination->longitude);
+            long minutes = min(TAXI_MINUTES + lround(distance / CRUISE_SPEED * 60), 23 * 60 + 59L);
+
+            routes.push_back(Route { airline + to_string(number), origin, destination, type, departure, Time(minutes / 60, minutes % 60) });
+        });
+
+        // With the routes sorted by id, the flights are created sorted too, so they only have to be merged
+        stable_sort(routes.begin(), routes.end(), [](const Route &a, const Route &b) {
+            return a.flight_id < b.flight_id;
+        });
+
+        unordered_map<string_view, Plane*> planes_by_license_plate;
+        for (Plane *plane : data::planes)
+            planes_by_license_plate.emplace(plane->getLicensePlate(), plane);
+
+        pending.planes.reserve(routes.size());
+        for (size_t i = 0; i < routes.size(); i++) {
+            string number = to_string(i + 1);
+            string license_plate = "OF-" + string(number.size() < 6 ? 6 - number.size() : 0, '0') + number;
+
+            if (planes_by_license_plate.count(license_plate) != 0)
+                throw runtime_error("The license plate " + license_plate + " already belongs to a plane, so the dataset may have been imported already");
+
+            pending.planes.push_back(new Plane(license_plate, routes[i].type, options.capacity));
+        }
+
+        Datetime first_midnight(options.first_day.getYear(), options.first_day.getMonth(), options.first_day.getDay(), 0, 0);
+        auto getDeparture = [&first_midnight](const Route &route, unsigned int day) {
+            return first_midnight.plusMinutes(day * 24 * 60).plus(route.departure);
+        };
+
+        if (!data::flights.empty()) {
+            unordered_map<FlightKey, Flight*, FlightKeyHash> flights_by_key;
+            flights_by_key.reserve(data::flights.size());
+            for (Flight *flight : data::flights)
+                flights_by_key.emplace(FlightKey { flight->getFlightId(), flight->getDepartureTime() }, flight);
+
+            for (const Route &route : routes) {
+                for (unsigned int day = 0; day < options.days; day++) {
+                    Datetime departure = getDeparture(route, day);
+                    if (flights_by_key.count(FlightKey { route.flight_id, departure }) != 0)
+                        throw runtime_error("Flight " + route.flight_id + " already departs at " + departure.str());
+                }
+            }
+        }
+
+        // Every route has its own plane, so the routes can be expanded on several threads
+        pending.flights.resize(routes.size() * options.days);
+        parallel::forEach(routes.size(), [&](size_t i) {
+            const Route &route = routes[i];
+            Plane &plane = *pending.planes[i];
+
+            for (unsigned int day = 0; day < options.days; day++) {
+                Flight *flight = new Flight(route.flight_id, getDeparture(route, day), route.duration, *route.origin->airport,
+                                            *route.destination->airport, plane);
+
+                pending.flights[i * options.days + day] = flight;
+                plane.addFlight(*flight);
+            }
+        });
+
+        result.airports = pending.airports.size();
+        result.planes = pending.planes.size();
+        result.flights = pending.flights.size();
+        pending.is_committed = true;
+
+        mergeInto(data::airports, pending.airports, [](const Airport *a, const Airport *b) {
+            return a->getName() < b->getName();
+        });
+
+        mergeInto(data::planes, pending.planes, [](const Plane *a, const Plane *b) {
+            return a->getLicensePlate() < b->getLicensePlate();
+        });
+
+        mergeInto(data::flights, pending.flights, [](const Flight *a, const Flight *b) {
+            return a->getFlightId() < b->getFlightId();
+        });
+        flight_calendar::invalidate();
+
+        return result;
+    }
+
+    uint64_t applyPatch(const string &path) {
+        try {
+            return journal::applyPatch(path);
+        } catch (exception &exception) {
+            // Patches aren't journaled, so loading the data again drops whatever part of it was applied
+            files::read();
+            throw;
+        }
+    }
+}
@@ -25,6 +25,9 @@ const std::vector<MenuOption> &MenuBlock::getOptions() const {
     return this->options;
 }
 
+function<void()> Menu::wait_handler;
+function<void()> Menu::resume_handler;
+
 Menu::Menu(const std::string &title) : title(title) {}
 
 void Menu::addBlock(const MenuBlock &block) {
@@ -41,6 +44,29 @@ void Menu::setSpecialBlock(const MenuBlock &block) {
     this->special_block = block;
 }
 
+void Menu::setWaitHandlers(const function<void()> &on_wait, const function<void()> &on_resume) {
+    wait_handler = on_wait;
+    resume_handler = on_resume;
+}
+
+MenuOption const &Menu::getSelectedOptionWhileWaiting() const {
+    if (wait_handler)
+        wait_handler();
+
+    try {
+        MenuOption const &option = this->getSelectedOption();
+        if (resume_handler)
+            resume_handler();
+
+        return option;
+    } catch (...) {
+        if (resume_handler)
+            resume_handler();
+
+        throw;
+    }
+}
+
 void Menu::printOptions() const {
     size_t option_number = 1;
     for (const MenuBlock &block : this->blocks) {
@@ -117,7 +143,7 @@ void Menu::show() const {
     }
 
     this->printOptions();
-    MenuOption const &option = this->getSelectedOption();
+    MenuOption const &option = this->getSelectedOptionWhileWaiting();
     cout << endl;
 
     option.second();
@@ -135,7 +161,7 @@ void Menu::show(const string &subtitle) const {
     }
 
     this->printOptions();
-    MenuOption const &option = this->getSelectedOption();
+    MenuOption const &option = this->getSelectedOptionWhileWaiting();
     cout << endl;
 
     option.second();
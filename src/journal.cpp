@@ -0,0 +1,1203 @@
+#include "journal.h"
+#include "archive.h"
+#include "crud.h"
+#include "files.h"
+#include "mapped_file.h"
+#include "state.h"
+#include <algorithm>
+#include <charconv>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace journal {
+
+    static const string PREFIX = "data.journal.";
+    constexpr char MAGIC[8] = { 'A', 'I', 'R', 'J', 'R', 'N', 'L', '\0' };
+    constexpr char PATCH_MAGIC[8] = { 'A', 'I', 'R', 'P', 'T', 'C', 'H', '\0' };
+
+    struct FileHeader {
+        char magic[8];
+        uint64_t generation;
+    };
+
+    /** The record count is only filled in once the patch is finished, so that an unfinished patch is never applied */
+    struct PatchHeader {
+        char magic[8];
+        uint64_t record_count;
+    };
+
+    static int file = -1;
+    static uint64_t current_generation = 0;
+    static uint64_t current_size = 0;
+
+    /** Guards the file and the sizes, so records can be written from several threads */
+    static mutex write_mutex;
+    /** Bytes written to every generation since the program started, which tells a flush which records it covers */
+    static uint64_t written_bytes = 0;
+    /** Signaled, with write_mutex, whenever records are written or the journal is replaced, for the followers */
+    static condition_variable records_written;
+
+    static mutex sync_mutex;
+    static condition_variable sync_finished;
+    /** Bytes of written_bytes known to be on the disk */
+    static uint64_t synced_bytes = 0;
+    static bool is_syncing = false;
+
+    string getPath(uint64_t generation) {
+        return PREFIX + to_string(generation);
+    }
+
+    /**
+     * @brief Lists the generations of every journal in the working directory, in ascending order
+     */
+    vector<uint64_t> listGenerations() {
+        vector<uint64_t> generations;
+
+        for (const auto &entry : filesystem::directory_iterator(".")) {
+            string name = entry.path().filename().string();
+            if (name.compare(0, PREFIX.size(), PREFIX) != 0)
+                continue;
+
+            uint64_t generation;
+            const char *first = name.data() + PREFIX.size(), *last = name.data() + name.size();
+            auto [next, error] = from_chars(first, last, generation);
+            if (error == errc() && next == last && first != last)
+                generations.push_back(generation);
+        }
+
+        sort(generations.begin(), generations.end());
+        return generations;
+    }
+
+    /*----------ENCODING----------*/
+
+    /**
+     * @brief Builds one record, made of its length, its operation and its fields
+     */
+    class RecordWriter {
+        string bytes;
+
+        template <typename T>
+        RecordWriter &putRaw(const T &value) {
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+            return *this;
+        }
+
+    public:
+        explicit RecordWriter(Operation operation) {
+            bytes.resize(sizeof(uint32_t));
+            bytes.push_back(static_cast<char>(operation));
+        }
+
+        RecordWriter &putUnsigned(uint32_t value) {
+            return putRaw(value);
+        }
+
+        RecordWriter &putFloat(float value) {
+            return putRaw(value);
+        }
+
+        RecordWriter &putString(string_view value) {
+            putUnsigned(value.size());
+            bytes.append(value);
+            return *this;
+        }
+
+        RecordWriter &putTime(const Time &time) {
+            bytes.push_back(static_cast<char>(time.getHour()));
+            bytes.push_back(static_cast<char>(time.getMinute()));
+            return *this;
+        }
+
+        RecordWriter &putDatetime(const Datetime &datetime) {
+            Date date = datetime;
+            putRaw(static_cast<uint16_t>(date.getYear()));
+            bytes.push_back(static_cast<char>(date.getMonth()));
+            bytes.push_back(static_cast<char>(date.getDay()));
+            return putTime(datetime);
+        }
+
+        RecordWriter &putFlightKey(string_view flight_id, const Datetime &departure_time) {
+            return putString(flight_id).putDatetime(departure_time);
+        }
+
+        void appendTo(string &records) {
+            uint32_t length = bytes.size() - sizeof(uint32_t);
+            memcpy(bytes.data(), &length, sizeof(length));
+            records.append(bytes);
+        }
+    };
+
+    class RecordReader {
+        string_view bytes;
+
+        template <typename T>
+        T getRaw() {
+            if (bytes.size() < sizeof(T))
+                throw runtime_error("Journal record is truncated");
+
+            T value;
+            memcpy(&value, bytes.data(), sizeof(T));
+            bytes.remove_prefix(sizeof(T));
+            return value;
+        }
+
+    public:
+        explicit RecordReader(string_view bytes) : bytes(bytes) {}
+
+        uint32_t getUnsigned() {
+            return getRaw<uint32_t>();
+        }
+
+        float getFloat() {
+            return getRaw<float>();
+        }
+
+        string getString() {
+            uint32_t length = getUnsigned();
+            if (bytes.size() < length)
+                throw runtime_error("Journal record is truncated");
+
+            string value(bytes.substr(0, length));
+            bytes.remove_prefix(length);
+            return value;
+        }
+
+        Time getTime() {
+            unsigned int hour = getRaw<uint8_t>();
+            unsigned int minute = getRaw<uint8_t>();
+            return Time(hour, minute);
+        }
+
+        Datetime getDatetime() {
+            unsigned int year = getRaw<uint16_t>();
+            unsigned int month = getRaw<uint8_t>();
+            unsigned int day = getRaw<uint8_t>();
+            Time time = getTime();
+            return Datetime(year, month, day, time.getHour(), time.getMinute());
+        }
+    };
+
+    /*----------REPLAY----------*/
+
+    Plane &getPlane(RecordReader &record) {
+        Plane *plane = crud::findPlaneByLicensePlate(record.getString());
+        if (plane == nullptr)
+            throw runtime_error("Journal refers to an unknown plane");
+
+        return *plane;
+    }
+
+    Flight &getFlight(RecordReader &record) {
+        string flight_id = record.getString();
+        Flight *flight = crud::findFlightByKey(flight_id, record.getDatetime());
+        if (flight == nullptr)
+            throw runtime_error("Journal refers to an unknown flight");
+
+        return *flight;
+    }
+
+    Airport &getAirport(const string &name) {
+        Airport *airport = crud::findAirportByName(name);
+        if (airport == nullptr)
+            throw runtime_error("Journal refers to an unknown airport");
+
+        return *airport;
+    }
+
+    /**
+     * @brief Handling cars are identified by their position in `data::handlingCars`,
+     * since their ids are only assigned while the program runs
+     */
+    HandlingCar &getCar(RecordReader &record) {
+        uint32_t index = record.getUnsigned();
+        if (index >= data::handlingCars.size())
+            throw runtime_error("Journal refers to an unknown handling car");
+
+        return *data::handlingCars[index];
+    }
+
+    uint32_t getCarIndex(const HandlingCar &car) {
+        auto it = find(data::handlingCars.begin(), data::handlingCars.end(), &car);
+        return it - data::handlingCars.begin();
+    }
+
+    void apply(Operation operation, RecordReader &record) {
+        switch (operation) {
+            case Operation::PUT_PLANE: {
+                string license_plate = record.getString();
+                string type = record.getString();
+                unsigned int capacity = record.getUnsigned();
+
+                Plane *plane = crud::findPlaneByLicensePlate(license_plate);
+                if (plane == nullptr) {
+                    crud::insertPlane(*new Plane(license_plate, type, capacity));
+                } else {
+                    plane->setType(type);
+                    plane->setCapacity(capacity);
+                }
+                break;
+            }
+
+            case Operation::SCHEDULE_SERVICE: {
+                Plane &plane = getPlane(record);
+                auto type = static_cast<ServiceType>(record.getUnsigned());
+                Datetime datetime = record.getDatetime();
+                plane.scheduleService(*new Service(type, datetime, record.getString(), plane));
+                break;
+            }
+
+            case Operation::COMPLETE_SERVICE:
+                getPlane(record).completeService();
+                break;
+
+            case Operation::DELETE_PLANE:
+                crud::deletePlane(getPlane(record));
+                break;
+
+            case Operation::CREATE_FLIGHT: {
+                string flight_id = record.getString();
+                Datetime departure_time = record.getDatetime();
+                Time duration = record.getTime();
+                Airport &origin = getAirport(record.getString());
+                Airport &destination = getAirport(record.getString());
+                Plane &plane = getPlane(record);
+
+                crud::insertFlight(*new Flight(flight_id, departure_time, duration, origin, destination, plane));
+                break;
+            }
+
+            case Operation::UPDATE_FLIGHT: {
+                Flight &flight = getFlight(record);
+                Datetime departure_time = record.getDatetime();
+                Time duration = record.getTime();
+
+                crud::rescheduleFlight(flight, departure_time);
+                flight.setDuration(duration);
+                flight.setOrigin(getAirport(record.getString()));
+                flight.setDestination(getAirport(record.getString()));
+                break;
+            }
+
+            case Operation::DELETE_FLIGHT:
+                crud::deleteFlight(getFlight(record));
+                break;
+
+            case Operation::PUT_TICKET: {
+                Flight &flight = getFlight(record);
+                unsigned int seat_number = record.getUnsigned();
+                string customer_name = record.getString();
+                unsigned int customer_age = record.getUnsigned();
+
+                Ticket *ticket = crud::findTicketsBySeatNumber(flight, seat_number);
+                if (ticket == nullptr) {
+                    flight.addTicket(*new Ticket(flight, customer_name, customer_age, seat_number));
+                } else {
+                    ticket->setCustomerName(customer_name);
+                    ticket->setCustomerAge(customer_age);
+                }
+                break;
+            }
+
+            case Operation::DELETE_TICKET: {
+                Flight &flight = getFlight(record);
+                Ticket *ticket = crud::findTicketsBySeatNumber(flight, record.getUnsigned());
+                if (ticket == nullptr)
+                    throw runtime_error("Journal refers to an unknown ticket");
+
+                flight.removeTicket(*ticket);
+                delete ticket;
+                break;
+            }
+
+            case Operation::PUT_AIRPORT: {
+                string name = record.getString();
+                Airport *airport = crud::findAirportByName(name);
+                if (airport == nullptr) {
+                    airport = new Airport(name);
+                    crud::insertAirport(*airport);
+                }
+
+                airport->removeAllTransportPlaceInfo();
+
+                uint32_t place_count = record.getUnsigned();
+                for (uint32_t i = 0; i < place_count; i++) {
+                    TransportPlace place;
+                    place.name = record.getString();
+                    place.latitude = record.getFloat();
+                    place.longitude = record.getFloat();
+                    place.airport_distance = record.getFloat();
+                    place.transport_type = static_cast<TransportType>(record.getUnsigned());
+
+                    uint32_t schedule_count = record.getUnsigned();
+                    for (uint32_t j = 0; j < schedule_count; j++)
+                        place.schedule.insert(record.getTime());
+
+                    airport->addTransportPlaceInfo(place);
+                }
+                break;
+            }
+
+            case Operation::DELETE_AIRPORT:
+                crud::deleteAirport(getAirport(record.getString()));
+                break;
+
+            case Operation::CREATE_HANDLING_CAR: {
+                unsigned int number_of_carriages = record.getUnsigned();
+                unsigned int stacks_per_carriage = record.getUnsigned();
+                unsigned int luggage_per_stack = record.getUnsigned();
+
+                crud::insertCar(*new HandlingCar(number_of_carriages, stacks_per_carriage, luggage_per_stack));
+                break;
+            }
+
+            case Operation::SET_HANDLING_CAR_FLIGHT: {
+                HandlingCar &car = getCar(record);
+                car.setFlight(getFlight(record));
+                break;
+            }
+
+            case Operation::LOAD_LUGGAGE: {
+                HandlingCar &car = getCar(record);
+                if (car.getFlight() == nullptr)
+                    throw runtime_error("Journal loads luggage into a handling car without a flight");
+
+                Ticket *ticket = crud::findTicketsBySeatNumber(*car.getFlight(), record.getUnsigned());
+                if (ticket == nullptr)
+                    throw runtime_error("Journal refers to an unknown ticket");
+
+                car.addLuggage(*new Luggage(*ticket, record.getFloat()));
+                break;
+            }
+
+            case Operation::UNLOAD_HANDLING_CAR:
+                crud::unloadCar(getCar(record));
+                break;
+
+            case Operation::DELETE_HANDLING_CAR:
+                crud::deleteCar(getCar(record));
+                break;
+
+            case Operation::ARCHIVE_BEFORE:
+                archive::removeBefore(record.getDatetime());
+                break;
+
+            case Operation::PUT_SERVICES: {
+                Plane &plane = getPlane(record);
+
+                while (plane.completeService());
+                vector<Service*> services = plane.getFinishedServices();
+                plane.removeAllFinishedServices([](const Service &) { return true; });
+                for (Service *service : services)
+                    delete service;
+
+                // Finished services come first, as in a snapshot
+                uint32_t finished_count = record.getUnsigned();
+                uint32_t service_count = finished_count + record.getUnsigned();
+                for (uint32_t i = 0; i < service_count; i++) {
+                    auto type = static_cast<ServiceType>(record.getUnsigned());
+                    Datetime datetime = record.getDatetime();
+                    plane.scheduleService(*new Service(type, datetime, record.getString(), plane));
+
+                    if (i < finished_count)
+                        plane.completeService();
+                }
+                break;
+            }
+
+            case Operation::PUT_FLIGHT_LUGGAGE: {
+                Flight &flight = getFlight(record);
+
+                vector<Luggage*> luggage = flight.getLuggage();
+                flight.clearLuggage();
+                for (Luggage *bag : luggage)
+                    delete bag;
+
+                uint32_t luggage_count = record.getUnsigned();
+                for (uint32_t i = 0; i < luggage_count; i++) {
+                    Ticket *ticket = crud::findTicketsBySeatNumber(flight, record.getUnsigned());
+                    if (ticket == nullptr)
+                        throw runtime_error("Journal refers to an unknown ticket");
+
+                    flight.addLuggage(*new Luggage(*ticket, record.getFloat()));
+                }
+                break;
+            }
+
+            case Operation::CLEAR_HANDLING_CAR: {
+                HandlingCar &car = getCar(record);
+
+                Luggage *luggage;
+                while ((luggage = car.unloadNextLuggage()) != nullptr)
+                    delete luggage;
+
+                car.clearFlight();
+                break;
+            }
+
+            default:
+                throw runtime_error("Unknown journal operation");
+        }
+    }
+
+    /**
+     * @brief Finds where the record that starts at the given offset ends
+     * @return The end of the record, or the offset itself if the record wasn't completely written
+     */
+    size_t getRecordEnd(string_view bytes, size_t offset) {
+        if (bytes.size() - offset < sizeof(uint32_t) + 1)
+            return offset;
+
+        uint32_t length;
+        memcpy(&length, bytes.data() + offset, sizeof(length));
+
+        // A record that was only partially written marks the end of the journal
+        if (length == 0 || bytes.size() - offset - sizeof(length) < length)
+            return offset;
+
+        return offset + sizeof(length) + length;
+    }
+
+    /**
+     * @brief Applies one complete record, length included
+     */
+    void applyRecord(string_view bytes) {
+        RecordReader record(bytes.substr(sizeof(uint32_t) + 1));
+        apply(static_cast<Operation>(bytes[sizeof(uint32_t)]), record);
+    }
+
+    /**
+     * @brief Applies every complete record of a journal
+     * @return The size of the journal up to the end of its last complete record
+     */
+    uint64_t replay(const string &path, uint64_t generation) {
+        MappedFile mapping(path);
+        string_view bytes = mapping.view();
+
+        FileHeader header;
+        if (bytes.size() < sizeof(header))
+            return 0;
+
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.generation != generation)
+            throw runtime_error("Not a journal file");
+
+        size_t offset = sizeof(header);
+        while (true) {
+            size_t end = getRecordEnd(bytes, offset);
+            if (end == offset)
+                break;
+
+            applyRecord(bytes.substr(offset, end - offset));
+            offset = end;
+        }
+
+        return offset;
+    }
+
+    /*----------FILES----------*/
+
+    void openForAppending(uint64_t generation, uint64_t valid_size) {
+        string path = getPath(generation);
+
+        file = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (file < 0)
+            throw runtime_error("Could not open the journal");
+
+        current_generation = generation;
+
+        if (valid_size < sizeof(FileHeader)) {
+            // A new journal, or one whose header was never completely written
+            if (ftruncate(file, 0) != 0)
+                throw runtime_error("Could not reset the journal");
+
+            FileHeader header = {};
+            memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.generation = generation;
+
+            if (::write(file, &header, sizeof(header)) != sizeof(header))
+                throw runtime_error("Could not write to the journal");
+
+            // Flushing the journal only makes its records durable once its name is on the disk too
+            files::syncDirectory(path);
+            current_size = sizeof(header);
+        } else {
+            // Drops whatever was left of a record that was only partially written
+            if (ftruncate(file, valid_size) != 0)
+                throw runtime_error("Could not repair the journal");
+
+            current_size = valid_size;
+        }
+    }
+
+    bool open(uint64_t generation) {
+        close();
+
+        uint64_t active_generation = generation;
+        uint64_t valid_size = 0;
+        bool replayed_all = true;
+
+        for (uint64_t journal_generation : listGenerations()) {
+            string path = getPath(journal_generation);
+
+            if (journal_generation < generation) {
+                // Left behind by a compaction that was interrupted after writing the snapshot
+                filesystem::remove(path);
+                continue;
+            }
+
+            if (replayed_all) {
+                try {
+                    valid_size = replay(path, journal_generation);
+                    active_generation = journal_generation;
+                    continue;
+                } catch (exception &exception) {
+                    replayed_all = false;
+                }
+            }
+
+            // Every later journal builds on the faulty one, so they are all set aside
+            filesystem::rename(path, path + ".corrupt");
+            active_generation = journal_generation + 1;
+            valid_size = 0;
+        }
+
+        {
+            lock_guard<mutex> lock(write_mutex);
+            openForAppending(active_generation, valid_size);
+        }
+
+        records_written.notify_all();
+        return replayed_all;
+    }
+
+    /**
+     * @brief Flushes and closes the journal that is currently open. Needs write_mutex.
+     * @return false if the journal could not be flushed
+     */
+    bool closeFile() {
+        if (file < 0)
+            return true;
+
+        bool flushed = fdatasync(file) == 0;
+        ::close(file);
+        file = -1;
+
+        if (flushed) {
+            // Threads waiting in sync() for records of this generation have nothing left to wait for
+            lock_guard<mutex> lock(sync_mutex);
+            synced_bytes = written_bytes;
+            sync_finished.notify_all();
+        }
+
+        return flushed;
+    }
+
+    void close() {
+        lock_guard<mutex> lock(write_mutex);
+        closeFile();
+    }
+
+    uint64_t rotate() {
+        uint64_t generation;
+        {
+            lock_guard<mutex> lock(write_mutex);
+            if (!closeFile())
+                throw runtime_error("Could not flush the journal");
+
+            openForAppending(current_generation + 1, 0);
+            generation = current_generation;
+        }
+
+        records_written.notify_all();
+        return generation;
+    }
+
+    void sync() {
+        uint64_t target;
+        {
+            lock_guard<mutex> lock(write_mutex);
+            target = written_bytes;
+        }
+
+        unique_lock<mutex> lock(sync_mutex);
+        while (synced_bytes < target) {
+            if (is_syncing) {
+                // Another thread is flushing, and the next flush will cover this thread's records if that one doesn't
+                sync_finished.wait(lock);
+                continue;
+            }
+
+            is_syncing = true;
+            lock.unlock();
+
+            // Everything written by now is flushed, including the records of the threads that waited for this flush.
+            // The descriptor is duplicated so a rotation can close the file in the meantime.
+            uint64_t flushing;
+            int descriptor;
+            {
+                lock_guard<mutex> write_lock(write_mutex);
+                flushing = written_bytes;
+                descriptor = file >= 0 ? dup(file) : -1;
+            }
+
+            bool flushed = descriptor >= 0 && fdatasync(descriptor) == 0;
+            if (descriptor >= 0)
+                ::close(descriptor);
+
+            lock.lock();
+            is_syncing = false;
+            if (flushed)
+                synced_bytes = max(synced_bytes, flushing);
+
+            sync_finished.notify_all();
+
+            // A closed journal was flushed when it was closed, unless that failed
+            if (!flushed && synced_bytes < target)
+                throw runtime_error("Could not flush the journal");
+        }
+    }
+
+    void removeBefore(uint64_t generation) {
+        for (uint64_t journal_generation : listGenerations()) {
+            if (journal_generation < generation)
+                filesystem::remove(getPath(journal_generation));
+        }
+    }
+
+    uint64_t getSize() {
+        lock_guard<mutex> lock(write_mutex);
+        return current_size;
+    }
+
+    bool isEmpty() {
+        return getSize() <= sizeof(FileHeader);
+    }
+
+    Position getPosition() {
+        lock_guard<mutex> lock(write_mutex);
+        return { current_generation, current_size };
+    }
+
+    /**
+     * @brief Writes records that were already applied at the end of the journal, unless no journal is open
+     */
+    void writeRecords(string_view records) {
+        if (records.empty())
+            return;
+
+        {
+            lock_guard<mutex> lock(write_mutex);
+            if (file < 0)
+                return;
+
+            if (::write(file, records.data(), records.size()) != static_cast<ssize_t>(records.size()))
+                throw runtime_error("Could not write to the journal");
+
+            current_size += records.size();
+            written_bytes += records.size();
+        }
+
+        records_written.notify_all();
+    }
+
+    size_t applyRecords(string_view records) {
+        // Records are written once they are applied, so the journal never holds one that wasn't
+        size_t offset = 0, count = 0;
+        try {
+            while (offset < records.size()) {
+                size_t end = getRecordEnd(records, offset);
+                if (end == offset)
+                    throw runtime_error("Journal record is truncated");
+
+                applyRecord(records.substr(offset, end - offset));
+                offset = end;
+                count++;
+            }
+        } catch (exception &exception) {
+            writeRecords(records.substr(0, offset));
+            throw;
+        }
+
+        writeRecords(records);
+        return count;
+    }
+
+    /*----------FOLLOWERS----------*/
+
+    Follower::Follower(uint64_t generation) : generation(generation), offset(sizeof(FileHeader)) {
+        file = ::open(getPath(generation).c_str(), O_RDONLY);
+        if (file < 0)
+            throw runtime_error("There is no journal of that generation");
+    }
+
+    Follower::~Follower() {
+        ::close(file);
+    }
+
+    string Follower::read(size_t max_size, chrono::milliseconds timeout) {
+        uint64_t end;
+        bool is_rotated;
+        {
+            unique_lock<mutex> lock(write_mutex);
+            records_written.wait_for(lock, timeout, [this]() {
+                return current_generation != generation || current_size > offset;
+            });
+
+            // A journal that was rotated is no longer written, and every record it holds is complete
+            is_rotated = current_generation != generation;
+            end = is_rotated ? numeric_limits<uint64_t>::max() : current_size;
+        }
+
+        string records;
+        if (end > offset) {
+            records.resize(min<uint64_t>(end - offset, max(max_size, sizeof(uint32_t) + 1)));
+            ssize_t size = pread(file, records.data(), records.size(), offset);
+            if (size < 0)
+                throw runtime_error("Could not read the journal");
+
+            records.resize(size);
+
+            size_t complete = 0;
+            for (size_t next; (next = getRecordEnd(records, complete)) != complete;)
+                complete = next;
+
+            // A record larger than max_size is read on its own
+            if (complete == 0 && records.size() >= sizeof(uint32_t)) {
+                uint32_t length;
+                memcpy(&length, records.data(), sizeof(length));
+
+                records.resize(sizeof(length) + length);
+                size = pread(file, records.data(), records.size(), offset);
+                if (size < 0)
+                    throw runtime_error("Could not read the journal");
+
+                records.resize(size);
+                complete = getRecordEnd(records, 0);
+            }
+
+            records.resize(complete);
+            offset += complete;
+        }
+
+        // What is left of a rotated journal is a record that was only partially written, which replaying it would skip too
+        if (records.empty() && is_rotated)
+            is_finished = true;
+
+        return records;
+    }
+
+    bool Follower::isFinished() const {
+        return is_finished;
+    }
+
+    Position Follower::getPosition() const {
+        return { generation, offset };
+    }
+
+    /*----------PATCHES----------*/
+
+    void Patch::putPlane(string_view license_plate, string_view type, unsigned int capacity) {
+        RecordWriter(Operation::PUT_PLANE)
+            .putString(license_plate)
+            .putString(type)
+            .putUnsigned(capacity)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::putServices(string_view license_plate, const vector<ServiceEntry> &finished, const vector<ServiceEntry> &scheduled) {
+        RecordWriter record(Operation::PUT_SERVICES);
+        record.putString(license_plate).putUnsigned(finished.size()).putUnsigned(scheduled.size());
+
+        for (const vector<ServiceEntry> *services : { &finished, &scheduled }) {
+            for (const ServiceEntry &service : *services) {
+                record.putUnsigned(static_cast<uint32_t>(service.type))
+                    .putDatetime(service.datetime)
+                    .putString(service.worker);
+            }
+        }
+
+        record.appendTo(this->records);
+        this->record_count++;
+    }
+
+    void Patch::scheduleService(string_view license_plate, const ServiceEntry &service) {
+        RecordWriter(Operation::SCHEDULE_SERVICE)
+            .putString(license_plate)
+            .putUnsigned(static_cast<uint32_t>(service.type))
+            .putDatetime(service.datetime)
+            .putString(service.worker)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::completeService(string_view license_plate) {
+        RecordWriter(Operation::COMPLETE_SERVICE)
+            .putString(license_plate)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::deletePlane(string_view license_plate) {
+        RecordWriter(Operation::DELETE_PLANE)
+            .putString(license_plate)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::createFlight(string_view flight_id, const Datetime &departure_time, const Time &duration,
+                             string_view origin, string_view destination, string_view license_plate) {
+        RecordWriter(Operation::CREATE_FLIGHT)
+            .putFlightKey(flight_id, departure_time)
+            .putTime(duration)
+            .putString(origin)
+            .putString(destination)
+            .putString(license_plate)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::updateFlight(string_view flight_id, const Datetime &departure_time, const Datetime &new_departure_time,
+                             const Time &duration, string_view origin, string_view destination) {
+        RecordWriter(Operation::UPDATE_FLIGHT)
+            .putFlightKey(flight_id, departure_time)
+            .putDatetime(new_departure_time)
+            .putTime(duration)
+            .putString(origin)
+            .putString(destination)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::deleteFlight(string_view flight_id, const Datetime &departure_time) {
+        RecordWriter(Operation::DELETE_FLIGHT)
+            .putFlightKey(flight_id, departure_time)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::putTicket(string_view flight_id, const Datetime &departure_time, unsigned int seat_number,
+                          string_view customer_name, unsigned int customer_age) {
+        RecordWriter(Operation::PUT_TICKET)
+            .putFlightKey(flight_id, departure_time)
+            .putUnsigned(seat_number)
+            .putString(customer_name)
+            .putUnsigned(customer_age)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::deleteTicket(string_view flight_id, const Datetime &departure_time, unsigned int seat_number) {
+        RecordWriter(Operation::DELETE_TICKET)
+            .putFlightKey(flight_id, departure_time)
+            .putUnsigned(seat_number)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::putFlightLuggage(string_view flight_id, const Datetime &departure_time, const vector<LuggageEntry> &luggage) {
+        RecordWriter record(Operation::PUT_FLIGHT_LUGGAGE);
+        record.putFlightKey(flight_id, departure_time).putUnsigned(luggage.size());
+
+        for (const LuggageEntry &bag : luggage)
+            record.putUnsigned(bag.seat_number).putFloat(bag.weight);
+
+        record.appendTo(this->records);
+        this->record_count++;
+    }
+
+    void Patch::putAirport(string_view name, const set<TransportPlace> &places) {
+        RecordWriter record(Operation::PUT_AIRPORT);
+
+        record.putString(name).putUnsigned(places.size());
+        for (const TransportPlace &place : places) {
+            record.putString(place.name)
+                .putFloat(place.latitude)
+                .putFloat(place.longitude)
+                .putFloat(place.airport_distance)
+                .putUnsigned(place.transport_type)
+                .putUnsigned(place.schedule.size());
+
+            for (const Time &time : place.schedule)
+                record.putTime(time);
+        }
+
+        record.appendTo(this->records);
+        this->record_count++;
+    }
+
+    void Patch::deleteAirport(string_view name) {
+        RecordWriter(Operation::DELETE_AIRPORT)
+            .putString(name)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::createHandlingCar(unsigned int number_of_carriages, unsigned int stacks_per_carriage, unsigned int luggage_per_stack) {
+        RecordWriter(Operation::CREATE_HANDLING_CAR)
+            .putUnsigned(number_of_carriages)
+            .putUnsigned(stacks_per_carriage)
+            .putUnsigned(luggage_per_stack)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::setHandlingCarFlight(uint32_t car, string_view flight_id, const Datetime &departure_time) {
+        RecordWriter(Operation::SET_HANDLING_CAR_FLIGHT)
+            .putUnsigned(car)
+            .putFlightKey(flight_id, departure_time)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::loadLuggage(uint32_t car, unsigned int seat_number, float weight) {
+        RecordWriter(Operation::LOAD_LUGGAGE)
+            .putUnsigned(car)
+            .putUnsigned(seat_number)
+            .putFloat(weight)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::unloadHandlingCar(uint32_t car) {
+        RecordWriter(Operation::UNLOAD_HANDLING_CAR)
+            .putUnsigned(car)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::clearHandlingCar(uint32_t car) {
+        RecordWriter(Operation::CLEAR_HANDLING_CAR)
+            .putUnsigned(car)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::deleteHandlingCar(uint32_t car) {
+        RecordWriter(Operation::DELETE_HANDLING_CAR)
+            .putUnsigned(car)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    void Patch::archiveBefore(const Datetime &cutoff) {
+        RecordWriter(Operation::ARCHIVE_BEFORE)
+            .putDatetime(cutoff)
+            .appendTo(this->records);
+
+        this->record_count++;
+    }
+
+    const string &Patch::getRecords() const {
+        return this->records;
+    }
+
+    size_t Patch::getRecordCount() const {
+        return this->record_count;
+    }
+
+    bool Patch::isEmpty() const {
+        return this->record_count == 0;
+    }
+
+    PatchWriter::PatchWriter(const string &path) : file(path, ios::binary | ios::trunc) {
+        PatchHeader header = {};
+        memcpy(header.magic, PATCH_MAGIC, sizeof(PATCH_MAGIC));
+
+        this->file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!this->file)
+            throw runtime_error("Could not create the patch");
+    }
+
+    void PatchWriter::append(const Patch &patch) {
+        this->file.write(patch.getRecords().data(), patch.getRecords().size());
+        this->record_count += patch.getRecordCount();
+    }
+
+    uint64_t PatchWriter::finish() {
+        this->file.seekp(offsetof(PatchHeader, record_count));
+        this->file.write(reinterpret_cast<const char*>(&this->record_count), sizeof(this->record_count));
+        this->file.close();
+
+        if (!this->file)
+            throw runtime_error("Could not write the patch");
+
+        return this->record_count;
+    }
+
+    uint64_t applyPatch(const string &path) {
+        MappedFile mapping(path);
+        string_view bytes = mapping.view();
+
+        PatchHeader header;
+        if (bytes.size() < sizeof(header))
+            throw runtime_error("Not a patch file");
+
+        memcpy(&header, bytes.data(), sizeof(header));
+        if (memcmp(header.magic, PATCH_MAGIC, sizeof(PATCH_MAGIC)) != 0)
+            throw runtime_error("Not a patch file");
+
+        // Every record is checked to be complete before any of them is applied
+        vector<size_t> ends;
+        ends.reserve(header.record_count);
+
+        size_t offset = sizeof(header);
+        for (size_t end; (end = getRecordEnd(bytes, offset)) != offset;) {
+            ends.push_back(end);
+            offset = end;
+        }
+
+        if (offset != bytes.size() || ends.size() != header.record_count)
+            throw runtime_error("Patch is incomplete");
+
+        offset = sizeof(header);
+        for (size_t end : ends) {
+            applyRecord(bytes.substr(offset, end - offset));
+            offset = end;
+        }
+
+        return ends.size();
+    }
+
+    /*----------RECORDS----------*/
+
+    /**
+     * @brief Appends the records of a change to the journal
+     */
+    void commit(const Patch &patch) {
+        writeRecords(patch.getRecords());
+    }
+
+    void logPlane(const Plane &plane) {
+        Patch patch;
+        patch.putPlane(plane.getLicensePlate(), plane.getType(), plane.getCapacity());
+        commit(patch);
+    }
+
+    void logServiceScheduled(const Service &service) {
+        Patch patch;
+        patch.scheduleService(service.getPlane().getLicensePlate(), { service.getType(), service.getDatetime(), service.getWorker() });
+        commit(patch);
+    }
+
+    void logServiceCompleted(const Plane &plane) {
+        Patch patch;
+        patch.completeService(plane.getLicensePlate());
+        commit(patch);
+    }
+
+    void logPlaneDeleted(const Plane &plane) {
+        Patch patch;
+        patch.deletePlane(plane.getLicensePlate());
+        commit(patch);
+    }
+
+    void logFlightCreated(const Flight &flight) {
+        Patch patch;
+        patch.createFlight(flight.getFlightId(), flight.getDepartureTime(), flight.getDuration(),
+                           flight.getOrigin().getName(), flight.getDestination().getName(), flight.getPlane().getLicensePlate());
+        commit(patch);
+    }
+
+    void logFlightUpdated(const Flight &flight, const Datetime &departure_time) {
+        Patch patch;
+        patch.updateFlight(flight.getFlightId(), departure_time, flight.getDepartureTime(), flight.getDuration(),
+                           flight.getOrigin().getName(), flight.getDestination().getName());
+        commit(patch);
+    }
+
+    void logFlightDeleted(const Flight &flight) {
+        Patch patch;
+        patch.deleteFlight(flight.getFlightId(), flight.getDepartureTime());
+        commit(patch);
+    }
+
+    void logTicket(const Ticket &ticket) {
+        Patch patch;
+        patch.putTicket(ticket.getFlight().getFlightId(), ticket.getFlight().getDepartureTime(), ticket.getSeatNumber(),
+                        ticket.getCustomerName(), ticket.getCustomerAge());
+        commit(patch);
+    }
+
+    void logTicketDeleted(const Ticket &ticket) {
+        Patch patch;
+        patch.deleteTicket(ticket.getFlight().getFlightId(), ticket.getFlight().getDepartureTime(), ticket.getSeatNumber());
+        commit(patch);
+    }
+
+    void logAirport(const Airport &airport) {
+        Patch patch;
+        patch.putAirport(airport.getName(), airport.getTransportPlaceInfo());
+        commit(patch);
+    }
+
+    void logAirportDeleted(const Airport &airport) {
+        Patch patch;
+        patch.deleteAirport(airport.getName());
+        commit(patch);
+    }
+
+    void logHandlingCarCreated(const HandlingCar &car) {
+        Patch patch;
+        patch.createHandlingCar(car.getNumberOfCarriages(), car.getStacksPerCarriage(), car.getLuggagePerStack());
+        commit(patch);
+    }
+
+    void logHandlingCarFlight(const HandlingCar &car) {
+        Patch patch;
+        patch.setHandlingCarFlight(getCarIndex(car), car.getFlight()->getFlightId(), car.getFlight()->getDepartureTime());
+        commit(patch);
+    }
+
+    void logLuggageLoaded(const HandlingCar &car, const Ticket &ticket, float weight) {
+        Patch patch;
+        patch.loadLuggage(getCarIndex(car), ticket.getSeatNumber(), weight);
+        commit(patch);
+    }
+
+    void logHandlingCarUnloaded(const HandlingCar &car) {
+        Patch patch;
+        patch.unloadHandlingCar(getCarIndex(car));
+        commit(patch);
+    }
+
+    void logHandlingCarDeleted(const HandlingCar &car) {
+        Patch patch;
+        patch.deleteHandlingCar(getCarIndex(car));
+        commit(patch);
+    }
+
+    void logArchived(const Datetime &cutoff) {
+        Patch patch;
+        patch.archiveBefore(cutoff);
+        commit(patch);
+    }
+}
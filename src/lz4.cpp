@@ -0,0 +1,237 @@
+#include "lz4.h"
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+namespace lz4 {
+
+    constexpr size_t MIN_MATCH = 4;
+    /** The last bytes of a block are always literals */
+    constexpr size_t LAST_LITERALS = 5;
+    /** No match starts this close to the end of a block */
+    constexpr size_t MATCH_FIND_LIMIT = 12;
+    constexpr size_t MAX_OFFSET = 65535;
+
+    constexpr unsigned int HASH_BITS = 14;
+    /** After this many misses in a row, the search starts skipping ahead, faster and faster, through data that doesn't compress */
+    constexpr unsigned int SKIP_TRIGGER = 6;
+
+    uint32_t read32(const uint8_t *data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint64_t read64(const uint8_t *data) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    uint32_t hash(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /**
+     * @brief Counts how many bytes match from the given positions, stopping at the limit
+     */
+    size_t countMatching(const uint8_t *position, const uint8_t *match, const uint8_t *limit) {
+        const uint8_t *start = position;
+
+        while (limit - position >= 8) {
+            uint64_t difference = read64(position) ^ read64(match);
+            if (difference != 0)
+                return position - start + countr_zero(difference) / 8;
+
+            position += 8;
+            match += 8;
+        }
+
+        while (position < limit && *position == *match) {
+            position++;
+            match++;
+        }
+
+        return position - start;
+    }
+
+    /**
+     * @brief Writes the part of a length that doesn't fit in its token: bytes of 255 followed by the remainder
+     */
+    uint8_t *writeLength(uint8_t *output, size_t length) {
+        for (; length >= 255; length -= 255)
+            *output++ = 255;
+
+        *output++ = static_cast<uint8_t>(length);
+        return output;
+    }
+
+    /**
+     * @brief Writes a run of literals followed by a match, or only the literals at the end of the block when match_length is 0
+     * @return Where the sequence ends, or nullptr if it doesn't fit before output_end
+     */
+    uint8_t *writeSequence(uint8_t *output, uint8_t *output_end, const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length) {
+        size_t needed = 1 + literal_length + literal_length / 255 + 1 + (match_length == 0 ? 0 : 2 + match_length / 255 + 1);
+        if (needed > static_cast<size_t>(output_end - output))
+            return nullptr;
+
+        uint8_t *token = output++;
+        *token = static_cast<uint8_t>(min<size_t>(literal_length, 15) << 4);
+        if (literal_length >= 15)
+            output = writeLength(output, literal_length - 15);
+
+        memcpy(output, literals, literal_length);
+        output += literal_length;
+
+        if (match_length == 0)
+            return output;
+
+        *output++ = static_cast<uint8_t>(offset);
+        *output++ = static_cast<uint8_t>(offset >> 8);
+
+        size_t extra = match_length - MIN_MATCH;
+        *token |= static_cast<uint8_t>(min<size_t>(extra, 15));
+        if (extra >= 15)
+            output = writeLength(output, extra - 15);
+
+        return output;
+    }
+
+    size_t compress(const char *source, size_t size, char *destination, size_t capacity) {
+        const uint8_t *input = reinterpret_cast<const uint8_t*>(source);
+        const uint8_t *input_end = input + size;
+        uint8_t *output = reinterpret_cast<uint8_t*>(destination);
+        uint8_t *output_end = output + capacity;
+        const uint8_t *anchor = input;
+
+        // Blocks too small to hold a match are stored as literals
+        if (size > MATCH_FIND_LIMIT) {
+            // Positions of the last sequence of 4 bytes seen with each hash, relative to the start of the block
+            array<uint32_t, 1 << HASH_BITS> table = {};
+
+            const uint8_t *match_start_limit = input_end - MATCH_FIND_LIMIT;
+            const uint8_t *match_end_limit = input_end - LAST_LITERALS;
+            const uint8_t *position = input + 1;
+
+            while (true) {
+                const uint8_t *match;
+                unsigned int attempts = 1 << SKIP_TRIGGER;
+
+                while (true) {
+                    if (position > match_start_limit)
+                        goto end;
+
+                    uint32_t &slot = table[hash(read32(position))];
+                    match = input + slot;
+                    slot = position - input;
+
+                    if (position - match <= static_cast<ptrdiff_t>(MAX_OFFSET) && match < position && read32(match) == read32(position))
+                        break;
+
+                    position += attempts++ >> SKIP_TRIGGER;
+                }
+
+                // Matches often start a little before the sequence that was found
+                while (position > anchor && match > input && position[-1] == match[-1]) {
+                    position--;
+                    match--;
+                }
+
+                size_t match_length = MIN_MATCH + countMatching(position + MIN_MATCH, match + MIN_MATCH, match_end_limit);
+                output = writeSequence(output, output_end, anchor, position - anchor, position - match, match_length);
+                if (output == nullptr)
+                    return 0;
+
+                position += match_length;
+                anchor = position;
+
+                if (position > match_start_limit)
+                    break;
+
+                table[hash(read32(position - 2))] = position - 2 - input;
+            }
+        }
+
+    end:
+        output = writeSequence(output, output_end, anchor, input_end - anchor, 0, 0);
+        if (output == nullptr)
+            return 0;
+
+        return output - reinterpret_cast<uint8_t*>(destination);
+    }
+
+    /**
+     * @brief Reads the part of a length that didn't fit in its token
+     * @return false if the block ends in the middle of it
+     */
+    bool readLength(const uint8_t *&input, const uint8_t *input_end, size_t &length) {
+        uint8_t byte;
+        do {
+            if (input == input_end)
+                return false;
+
+            byte = *input++;
+            length += byte;
+        } while (byte == 255);
+
+        return true;
+    }
+
+    bool decompress(const char *source, size_t size, char *destination, size_t destination_size) {
+        const uint8_t *input = reinterpret_cast<const uint8_t*>(source);
+        const uint8_t *input_end = input + size;
+        uint8_t *output = reinterpret_cast<uint8_t*>(destination);
+        uint8_t *output_end = output + destination_size;
+
+        while (true) {
+            if (input == input_end)
+                return false;
+
+            uint8_t token = *input++;
+
+            size_t literal_length = token >> 4;
+            if (literal_length == 15 && !readLength(input, input_end, literal_length))
+                return false;
+
+            if (literal_length > static_cast<size_t>(input_end - input) || literal_length > static_cast<size_t>(output_end - output))
+                return false;
+
+            memcpy(output, input, literal_length);
+            input += literal_length;
+            output += literal_length;
+
+            // Only the last sequence has no match
+            if (input == input_end)
+                break;
+
+            if (input_end - input < 2)
+                return false;
+
+            size_t offset = input[0] | input[1] << 8;
+            input += 2;
+
+            size_t match_length = token & 15;
+            if (match_length == 15 && !readLength(input, input_end, match_length))
+                return false;
+
+            match_length += MIN_MATCH;
+            if (offset == 0 || offset > static_cast<size_t>(output - reinterpret_cast<uint8_t*>(destination))
+                || match_length > static_cast<size_t>(output_end - output))
+                return false;
+
+            // A match may overlap the bytes it produces, repeating its first offset bytes. Whatever was copied repeats
+            // with twice the period too, so every copy can take twice as many bytes as the one before without overlapping.
+            for (size_t distance = offset; match_length > 0; distance *= 2) {
+                size_t length = min(distance, match_length);
+                memcpy(output, output - distance, length);
+                output += length;
+                match_length -= length;
+            }
+        }
+
+        return output == output_end;
+    }
+}
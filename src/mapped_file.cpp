@@ -0,0 +1,55 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile(const string &path, bool is_sequential) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw runtime_error("Could not open file");
+
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+        close(fd);
+        throw runtime_error("Could not read the file size");
+    }
+
+    this->size = info.st_size;
+
+    // mmap refuses empty mappings, but an empty file is still a valid (empty) view
+    if (this->size > 0) {
+        void *address = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw runtime_error("Could not map file into memory");
+        }
+
+        madvise(address, this->size, is_sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+
+        this->data = static_cast<const char*>(address);
+    }
+
+    // The mapping keeps its own reference to the file
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (this->data != nullptr)
+        munmap(const_cast<char*>(this->data), this->size);
+}
+
+const char *MappedFile::getData() const {
+    return this->data;
+}
+
+size_t MappedFile::getSize() const {
+    return this->size;
+}
+
+string_view MappedFile::view() const {
+    return string_view(this->data, this->size);
+}
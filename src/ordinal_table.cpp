@@ -0,0 +1,50 @@
+#include "ordinal_table.h"
+#include "state.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+OrdinalTable::OrdinalTable() {
+    if (data::airports.size() > UINT32_MAX || data::flights.size() > UINT32_MAX)
+        throw runtime_error("Too many airports or flights to number");
+
+    this->airports.reserve(data::airports.size());
+    for (const Airport *airport : data::airports)
+        this->airports.emplace(airport, this->airports.size());
+
+    this->flights.reserve(data::flights.size());
+    for (const Plane *plane : data::planes) {
+        for (const Flight *flight : plane->getFlights())
+            this->flights.emplace(flight, this->flights.size());
+    }
+}
+
+uint32_t OrdinalTable::getAirport(const Airport &airport) const {
+    auto it = this->airports.find(&airport);
+    if (it == this->airports.end())
+        throw runtime_error("Unknown airport");
+
+    return it->second;
+}
+
+uint32_t OrdinalTable::getFlight(const Flight &flight) const {
+    auto it = this->flights.find(&flight);
+    if (it == this->flights.end())
+        throw runtime_error("Unknown flight");
+
+    return it->second;
+}
+
+uint32_t OrdinalTable::getTicket(const Flight &flight, const Ticket &ticket) const {
+    // A flight's tickets are kept sorted by seat, so the ticket is found without numbering every ticket up front
+    const vector<Ticket*> &tickets = flight.getTickets();
+    auto it = lower_bound(tickets.begin(), tickets.end(), ticket.getSeatNumber(), [](const Ticket *ticket, unsigned int seat_number) {
+        return ticket->getSeatNumber() < seat_number;
+    });
+
+    if (it == tickets.end() || *it != &ticket)
+        throw runtime_error("Owner of luggage doesn't have a ticket");
+
+    return static_cast<uint32_t>(it - tickets.begin());
+}
@@ -0,0 +1,66 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace parallel {
+
+    static unsigned int thread_count = 0;
+
+    unsigned int getThreadCount() {
+        if (thread_count != 0)
+            return thread_count;
+
+        return max(1u, thread::hardware_concurrency());
+    }
+
+    void setThreadCount(unsigned int count) {
+        thread_count = count;
+    }
+
+    void forEach(size_t count, const function<void(size_t)> &task) {
+        size_t worker_count = min<size_t>(getThreadCount(), count);
+        if (worker_count <= 1) {
+            for (size_t i = 0; i < count; i++)
+                task(i);
+
+            return;
+        }
+
+        atomic<size_t> next_index = 0;
+        atomic<bool> failed = false;
+        exception_ptr error;
+        mutex error_mutex;
+
+        auto work = [&]() {
+            for (size_t i = next_index++; i < count && !failed; i = next_index++) {
+                try {
+                    task(i);
+                } catch (...) {
+                    lock_guard<mutex> lock(error_mutex);
+                    if (!failed.exchange(true))
+                        error = current_exception();
+                }
+            }
+        };
+
+        vector<thread> workers;
+        workers.reserve(worker_count - 1);
+        for (size_t i = 1; i < worker_count; i++)
+            workers.emplace_back(work);
+
+        // The calling thread does its share of the work too
+        work();
+
+        for (thread &worker : workers)
+            worker.join();
+
+        if (error)
+            rethrow_exception(error);
+    }
+}
@@ -10,11 +10,11 @@ Plane::Plane(const string &license_plate, const string &type, const unsigned int
     this->capacity = capacity;
 }
 
-string Plane::getLicensePlate() const {
+const string &Plane::getLicensePlate() const {
     return this->license_plate;
 }
 
-string Plane::getType() const {
+const string &Plane::getType() const {
     return this->type;
 }
 
@@ -22,15 +22,15 @@ unsigned int Plane::getCapacity() const {
     return this->capacity;
 }
 
-list<Flight*> Plane::getFlights() const {
+const list<Flight*> &Plane::getFlights() const {
     return this->flights;
 }
 
-queue<Service*> Plane::getScheduledServices() const {
+const queue<Service*> &Plane::getScheduledServices() const {
     return this->scheduled_services;
 }
 
-vector<Service*> Plane::getFinishedServices() const {
+const vector<Service*> &Plane::getFinishedServices() const {
     return this->finished_services;
 }
 
@@ -67,15 +67,7 @@ bool Plane::removeFirstFlight(const std::function<bool(const Flight &)>& selecto
 }
 
 bool Plane::removeAllFlights(const function<bool(const Flight&)>& selector) {
-    bool removed_any = false;
-    for (auto it = flights.begin(), end = flights.end(); it != end; it++) {
-        if (selector(**it)) {
-            it = this->flights.erase(it);
-            it--;
-            removed_any = true;
-        }
-    }
-    return removed_any;
+    return this->flights.remove_if([&selector](const Flight *flight) { return selector(*flight); }) != 0;
 }
 
 void Plane::scheduleService(Service& service) {
@@ -100,6 +92,16 @@ bool Plane::completeService() {
     return true;
 }
 
+bool Plane::removeAllFinishedServices(const function<bool(const Service&)> &selector) {
+    auto it = remove_if(this->finished_services.begin(), this->finished_services.end(), [&selector](const Service *service) {
+        return selector(*service);
+    });
+
+    bool removed_any = it != this->finished_services.end();
+    this->finished_services.erase(it, this->finished_services.end());
+    return removed_any;
+}
+
 ostream &operator<<(ostream &os, const Plane &plane) {
     os << plane.str();
     return os;
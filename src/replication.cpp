@@ -0,0 +1,671 @@
+#include "replication.h"
+#include "files.h"
+#include "journal.h"
+#include "snapshot.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace replication {
+
+    constexpr char MAGIC[8] = { 'A', 'I', 'R', 'R', 'E', 'P', 'L', '\0' };
+    constexpr uint32_t VERSION = 1;
+
+    /** How long the primary waits for new records before telling a standby that it is still there */
+    static const chrono::milliseconds HEARTBEAT_INTERVAL(500);
+
+    /** How long either side waits for the other before giving up on the connection */
+    static const chrono::seconds CONNECTION_TIMEOUT(5);
+
+    static const chrono::seconds RECONNECT_INTERVAL(1);
+    static const chrono::seconds REPORT_INTERVAL(1);
+
+    /** How long the primary waits for the snapshot that folds a rotated journal, after which it sends the one it has */
+    static const chrono::seconds SNAPSHOT_TIMEOUT(30);
+
+    /** Bytes of records sent in one message, unless a single record is larger */
+    static const size_t BATCH_SIZE = 256 << 10;
+
+    /** How often waits wake up to check whether they should stop */
+    static const chrono::milliseconds POLL_INTERVAL(200);
+
+    using Clock = chrono::steady_clock;
+
+    /** Sent by a standby once it connects */
+    struct Hello {
+        char magic[8];
+        uint32_t version;
+        uint32_t padding;
+    };
+
+    enum class MessageType : uint32_t {
+        /** The primary's snapshot, which replaces the standby's data */
+        SNAPSHOT = 1,
+        /** Complete journal records, which follow the ones sent before */
+        RECORDS,
+        /** Sent by the primary when there are no new records */
+        HEARTBEAT,
+        /** Sent by a standby once it has applied some records */
+        ACKNOWLEDGEMENT
+    };
+
+    struct Message {
+        MessageType type;
+        uint32_t padding;
+        /** Where the records start, or where the applied ones end. For a snapshot, the generation of the journal that follows it. */
+        journal::Position position;
+        /** Bytes that follow the message, or that were applied */
+        uint64_t size;
+        /** Where the primary's journal ended when the message was sent */
+        journal::Position end;
+        /** When the primary sent the message, or the records that were applied, in nanoseconds of the steady clock, which every process shares */
+        int64_t sent_at;
+    };
+
+    int64_t now() {
+        return chrono::duration_cast<chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+    }
+
+    double millisecondsSince(int64_t time) {
+        return (now() - time) / 1e6;
+    }
+
+    Message makeMessage(MessageType type, journal::Position position, uint64_t size) {
+        Message message = {};
+        message.type = type;
+        message.position = position;
+        message.size = size;
+        message.end = journal::getPosition();
+        message.sent_at = now();
+        return message;
+    }
+
+    sockaddr_un getAddress(const string &socket_path) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (socket_path.size() >= sizeof(address.sun_path))
+            throw runtime_error("The socket path is too long");
+
+        memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+        return address;
+    }
+
+    /**
+     * @brief Makes sends and receives on a socket fail instead of waiting forever for the other side
+     */
+    void setTimeouts(int socket) {
+        timeval timeout = { chrono::duration_cast<chrono::seconds>(CONNECTION_TIMEOUT).count(), 0 };
+        setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+
+    /**
+     * @brief Waits until a socket has something to read, or for POLL_INTERVAL
+     * @return Whether it has something to read
+     */
+    bool waitForInput(int socket) {
+        pollfd descriptor = { socket, POLLIN, 0 };
+        int ready = poll(&descriptor, 1, POLL_INTERVAL.count());
+        if (ready < 0 && errno != EINTR)
+            throw runtime_error("Could not wait for the connection");
+
+        return ready > 0;
+    }
+
+    void sendAll(int socket, const void *data, size_t size) {
+        const char *bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR)
+                continue;
+
+            if (sent <= 0)
+                throw runtime_error("The connection was lost");
+
+            bytes += sent;
+            size -= sent;
+        }
+    }
+
+    /*----------PRIMARY----------*/
+
+    static int listener = -1;
+    static string listener_path;
+    static thread accept_thread;
+    static atomic<bool> is_stopping = false;
+
+    /** Threads serving each standby, joined once the primary stops */
+    static mutex connections_mutex;
+    static vector<thread> connections;
+
+    static mutex primary_mutex;
+    static PrimaryStats primary_stats;
+    /** Where the records applied by the standby which acknowledged last end */
+    static journal::Position acknowledged_position = {};
+
+    /**
+     * @brief Opens the snapshot on the disk and reads the generation of the journal that follows it
+     * @return The descriptor of the snapshot, or -1 if there is no valid snapshot
+     */
+    int openSnapshot(uint64_t &generation) {
+        int file = open(files::getSnapshotPath().c_str(), O_RDONLY);
+        if (file < 0)
+            return -1;
+
+        snapshot::Header header;
+        if (pread(file, &header, sizeof(header), 0) != sizeof(header) || memcmp(header.magic, snapshot::MAGIC, sizeof(snapshot::MAGIC)) != 0) {
+            close(file);
+            return -1;
+        }
+
+        generation = header.journal_generation;
+        return file;
+    }
+
+    /**
+     * @brief Sends the snapshot to a standby
+     * @return A follower of the journal that comes after the snapshot
+     */
+    unique_ptr<journal::Follower> sendSnapshot(int connection) {
+        while (true) {
+            if (is_stopping)
+                throw runtime_error("The primary is stopping");
+
+            uint64_t generation;
+            int file = openSnapshot(generation);
+            if (file < 0)
+                throw runtime_error("There is no snapshot to send");
+
+            // A save may replace the snapshot and remove the journal after it in the meantime, and then the new ones are sent.
+            // Once both are open, they can be read until the end, even if they are replaced.
+            unique_ptr<journal::Follower> follower;
+            try {
+                follower = make_unique<journal::Follower>(generation);
+            } catch (runtime_error &exception) {
+                close(file);
+                this_thread::sleep_for(POLL_INTERVAL);
+                continue;
+            }
+
+            struct stat info;
+            if (fstat(file, &info) != 0) {
+                close(file);
+                throw runtime_error("Could not read the snapshot");
+            }
+
+            try {
+                Message message = makeMessage(MessageType::SNAPSHOT, { generation, 0 }, info.st_size);
+                sendAll(connection, &message, sizeof(message));
+
+                for (off_t offset = 0; offset < info.st_size;) {
+                    ssize_t sent = sendfile(connection, file, &offset, info.st_size - offset);
+                    if (sent < 0 && errno == EINTR)
+                        continue;
+
+                    if (sent <= 0)
+                        throw runtime_error("The connection was lost");
+                }
+            } catch (runtime_error &exception) {
+                close(file);
+                throw;
+            }
+
+            close(file);
+
+            lock_guard<mutex> lock(primary_mutex);
+            primary_stats.snapshots++;
+            return follower;
+        }
+    }
+
+    /**
+     * @brief Reads the acknowledgements of a standby until the connection is closed
+     */
+    void receiveAcknowledgements(int connection) {
+        string pending;
+        char bytes[4096];
+
+        while (true) {
+            ssize_t received = recv(connection, bytes, sizeof(bytes), 0);
+            if (received < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+
+            if (received <= 0)
+                return;
+
+            pending.append(bytes, received);
+
+            size_t count = pending.size() / sizeof(Message);
+            for (size_t i = 0; i < count; i++) {
+                Message message;
+                memcpy(&message, pending.data() + i * sizeof(Message), sizeof(Message));
+                if (message.type != MessageType::ACKNOWLEDGEMENT)
+                    return;
+
+                lock_guard<mutex> lock(primary_mutex);
+                primary_stats.acknowledged_bytes += message.size;
+                primary_stats.lag = millisecondsSince(message.sent_at);
+                acknowledged_position = message.position;
+            }
+
+            pending.erase(0, count * sizeof(Message));
+        }
+    }
+
+    /**
+     * @brief Sends the snapshot and then the journal to a standby, until either of them stops
+     */
+    void serveStandby(int connection) {
+        {
+            lock_guard<mutex> lock(primary_mutex);
+            primary_stats.standbys++;
+        }
+
+        thread acknowledgements;
+        try {
+            Hello hello;
+            if (recv(connection, &hello, sizeof(hello), MSG_WAITALL) != sizeof(hello)
+                || memcmp(hello.magic, MAGIC, sizeof(MAGIC)) != 0 || hello.version != VERSION)
+                throw runtime_error("Not a standby");
+
+            // Acknowledgements are read on their own thread, so they are counted as soon as they arrive
+            acknowledgements = thread(receiveAcknowledgements, connection);
+
+            while (!is_stopping) {
+                unique_ptr<journal::Follower> follower = sendSnapshot(connection);
+
+                while (!is_stopping && !follower->isFinished()) {
+                    journal::Position position = follower->getPosition();
+                    string records = follower->read(BATCH_SIZE, HEARTBEAT_INTERVAL);
+
+                    Message message = makeMessage(records.empty() ? MessageType::HEARTBEAT : MessageType::RECORDS, position, records.size());
+                    sendAll(connection, &message, sizeof(message));
+                    sendAll(connection, records.data(), records.size());
+
+                    if (!records.empty()) {
+                        lock_guard<mutex> lock(primary_mutex);
+                        primary_stats.shipped_bytes += records.size();
+                    }
+                }
+
+                // The journal was rotated to be folded into a new snapshot, which may hold changes the journal doesn't,
+                // so the standby is sent that snapshot once it is written
+                uint64_t finished_generation = follower->getPosition().generation;
+                follower.reset();
+
+                for (Clock::time_point deadline = Clock::now() + SNAPSHOT_TIMEOUT; !is_stopping && Clock::now() < deadline;) {
+                    uint64_t generation;
+                    int file = openSnapshot(generation);
+                    if (file >= 0)
+                        close(file);
+
+                    if (file >= 0 && generation > finished_generation)
+                        break;
+
+                    Message message = makeMessage(MessageType::HEARTBEAT, { finished_generation + 1, 0 }, 0);
+                    sendAll(connection, &message, sizeof(message));
+
+                    this_thread::sleep_for(POLL_INTERVAL);
+                }
+            }
+        } catch (exception &exception) {
+            // The standby reconnects and starts over from a snapshot
+        }
+
+        shutdown(connection, SHUT_RDWR);
+        if (acknowledgements.joinable())
+            acknowledgements.join();
+
+        close(connection);
+
+        lock_guard<mutex> lock(primary_mutex);
+        primary_stats.standbys--;
+    }
+
+    void acceptStandbys() {
+        while (!is_stopping) {
+            if (!waitForInput(listener))
+                continue;
+
+            int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection < 0)
+                continue;
+
+            setTimeouts(connection);
+
+            lock_guard<mutex> lock(connections_mutex);
+            connections.emplace_back(serveStandby, connection);
+        }
+    }
+
+    void startPrimary(const string &socket_path) {
+        sockaddr_un address = getAddress(socket_path);
+
+        if (!filesystem::exists(files::getSnapshotPath()))
+            files::write();
+
+        // A socket left behind by a primary that didn't stop cleanly would keep this one from listening
+        unlink(socket_path.c_str());
+
+        listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0)
+            throw runtime_error("Could not create the socket");
+
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 4) != 0) {
+            close(listener);
+            listener = -1;
+            throw runtime_error("Could not listen on the socket");
+        }
+
+        listener_path = socket_path;
+        is_stopping = false;
+        accept_thread = thread(acceptStandbys);
+    }
+
+    void stopPrimary() {
+        if (listener < 0)
+            return;
+
+        is_stopping = true;
+        accept_thread.join();
+
+        {
+            lock_guard<mutex> lock(connections_mutex);
+            for (thread &connection : connections)
+                connection.join();
+
+            connections.clear();
+        }
+
+        close(listener);
+        unlink(listener_path.c_str());
+        listener = -1;
+    }
+
+    PrimaryStats getPrimaryStats() {
+        journal::Position end = journal::getPosition();
+
+        lock_guard<mutex> lock(primary_mutex);
+        PrimaryStats stats = primary_stats;
+        if (stats.snapshots != 0)
+            stats.bytes_behind = end.offset - (end.generation == acknowledged_position.generation ? min(end.offset, acknowledged_position.offset) : 0);
+
+        return stats;
+    }
+
+    /*----------STANDBY----------*/
+
+    static volatile sig_atomic_t is_promotion_requested = 0;
+
+    static mutex standby_mutex;
+    static StandbyStats standby_stats;
+
+    /** Thrown out of whatever a standby is waiting for once it is sent SIGUSR1 */
+    struct Promotion {};
+
+    void requestPromotion(int) {
+        is_promotion_requested = 1;
+    }
+
+    class Standby {
+        int connection = -1;
+        const function<void(const StandbyStats&)> &report;
+
+        Clock::time_point last_report = Clock::now();
+        uint64_t records_at_last_report = 0;
+
+        /**
+         * @brief Stops if the standby was promoted, and reports the figures if it is time to
+         */
+        void checkIn() {
+            if (is_promotion_requested)
+                throw Promotion();
+
+            Clock::time_point time = Clock::now();
+            if (time - last_report < REPORT_INTERVAL)
+                return;
+
+            {
+                lock_guard<mutex> lock(standby_mutex);
+                standby_stats.throughput = (standby_stats.records - records_at_last_report) / chrono::duration<double>(time - last_report).count();
+                records_at_last_report = standby_stats.records;
+            }
+
+            last_report = time;
+            if (report)
+                report(getStandbyStats());
+        }
+
+        void connect(const string &socket_path) {
+            sockaddr_un address = getAddress(socket_path);
+
+            connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (connection < 0)
+                throw runtime_error("Could not create the socket");
+
+            if (::connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+                throw runtime_error("Could not connect to the primary");
+
+            setTimeouts(connection);
+
+            Hello hello = {};
+            memcpy(hello.magic, MAGIC, sizeof(MAGIC));
+            hello.version = VERSION;
+            sendAll(connection, &hello, sizeof(hello));
+        }
+
+        void disconnect() {
+            if (connection >= 0)
+                close(connection);
+
+            connection = -1;
+
+            lock_guard<mutex> lock(standby_mutex);
+            standby_stats.is_connected = false;
+        }
+
+        void receive(void *data, size_t size) {
+            char *bytes = static_cast<char*>(data);
+            Clock::time_point last_received = Clock::now();
+
+            while (size > 0) {
+                checkIn();
+
+                if (!waitForInput(connection)) {
+                    if (Clock::now() - last_received >= CONNECTION_TIMEOUT)
+                        throw runtime_error("The primary stopped responding");
+
+                    continue;
+                }
+
+                ssize_t received = recv(connection, bytes, size, 0);
+                if (received < 0 && (errno == EINTR || errno == EAGAIN))
+                    continue;
+
+                if (received <= 0)
+                    throw runtime_error("The connection was lost");
+
+                bytes += received;
+                size -= received;
+                last_received = Clock::now();
+            }
+        }
+
+        void acknowledge(const Message &message, uint64_t size) {
+            Message acknowledgement = {};
+            acknowledgement.type = MessageType::ACKNOWLEDGEMENT;
+            acknowledgement.position = journal::getPosition();
+            acknowledgement.size = size;
+            acknowledgement.sent_at = message.sent_at;
+            sendAll(connection, &acknowledgement, sizeof(acknowledgement));
+        }
+
+        /**
+         * @brief Counts how much of the primary's journal wasn't applied yet
+         */
+        void updateBytesBehind(const Message &message) {
+            journal::Position applied = journal::getPosition();
+            uint64_t behind = message.end.generation == applied.generation ? message.end.offset - min(message.end.offset, applied.offset) : message.end.offset;
+
+            lock_guard<mutex> lock(standby_mutex);
+            standby_stats.bytes_behind = behind;
+            if (behind == 0)
+                standby_stats.lag = 0;
+        }
+
+        /**
+         * @brief Replaces the data, the snapshot and the journals with the primary's snapshot
+         */
+        void receiveSnapshot(const Message &message) {
+            string temporary_path = files::getSnapshotPath() + ".standby";
+            int file = open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (file < 0)
+                throw runtime_error("Could not write the snapshot");
+
+            try {
+                vector<char> buffer(1 << 20);
+                for (uint64_t left = message.size; left > 0;) {
+                    size_t size = min<uint64_t>(left, buffer.size());
+                    receive(buffer.data(), size);
+
+                    if (::write(file, buffer.data(), size) != static_cast<ssize_t>(size))
+                        throw runtime_error("Could not write the snapshot");
+
+                    left -= size;
+                }
+
+                if (fdatasync(file) != 0)
+                    throw runtime_error("Could not write the snapshot");
+            } catch (...) {
+                close(file);
+                remove(temporary_path.c_str());
+                throw;
+            }
+
+            close(file);
+
+            // The journals of the old snapshot don't apply to the new one, so they are removed before it takes its place
+            journal::close();
+            journal::removeBefore(numeric_limits<uint64_t>::max());
+            if (rename(temporary_path.c_str(), files::getSnapshotPath().c_str()) != 0)
+                throw runtime_error("Could not replace the snapshot");
+
+            files::read();
+            if (journal::getPosition().generation != message.position.generation)
+                throw runtime_error("The snapshot of the primary could not be loaded");
+
+            lock_guard<mutex> lock(standby_mutex);
+            standby_stats.snapshots++;
+        }
+
+        void applyRecords(const Message &message) {
+            string records(message.size, '\0');
+            receive(records.data(), records.size());
+
+            journal::Position applied = journal::getPosition();
+            if (applied.generation != message.position.generation || applied.offset != message.position.offset)
+                throw runtime_error("The records of the primary don't follow the ones that were applied");
+
+            Clock::time_point start = Clock::now();
+            size_t count = journal::applyRecords(records);
+
+            lock_guard<mutex> lock(standby_mutex);
+            standby_stats.records += count;
+            standby_stats.bytes += records.size();
+            standby_stats.apply_time += chrono::duration<double, milli>(Clock::now() - start).count();
+            standby_stats.lag = millisecondsSince(message.sent_at);
+        }
+
+    public:
+        explicit Standby(const function<void(const StandbyStats&)> &report) : report(report) {}
+
+        ~Standby() {
+            disconnect();
+        }
+
+        void run(const string &socket_path) {
+            while (true) {
+                try {
+                    connect(socket_path);
+
+                    {
+                        lock_guard<mutex> lock(standby_mutex);
+                        standby_stats.is_connected = true;
+                    }
+
+                    while (true) {
+                        Message message;
+                        receive(&message, sizeof(message));
+
+                        switch (message.type) {
+                            case MessageType::SNAPSHOT:
+                                receiveSnapshot(message);
+                                break;
+
+                            case MessageType::RECORDS:
+                                applyRecords(message);
+                                break;
+
+                            case MessageType::HEARTBEAT:
+                                break;
+
+                            default:
+                                throw runtime_error("The primary sent an unexpected message");
+                        }
+
+                        acknowledge(message, message.type == MessageType::RECORDS ? message.size : 0);
+                        updateBytesBehind(message);
+                    }
+                } catch (exception &exception) {
+                    // Whatever went wrong, the primary sends a snapshot again once the standby reconnects
+                }
+
+                disconnect();
+
+                for (Clock::time_point retry = Clock::now() + RECONNECT_INTERVAL; Clock::now() < retry;) {
+                    checkIn();
+                    this_thread::sleep_for(POLL_INTERVAL);
+                }
+            }
+        }
+    };
+
+    void runStandby(const string &socket_path, const function<void(const StandbyStats&)> &report) {
+        struct sigaction action = {};
+        action.sa_handler = requestPromotion;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGUSR1, &action, nullptr);
+
+        try {
+            Standby(report).run(socket_path);
+        } catch (Promotion &promotion) {}
+
+        // Once promoted, the signal has nothing left to do
+        signal(SIGUSR1, SIG_IGN);
+    }
+
+    StandbyStats getStandbyStats() {
+        lock_guard<mutex> lock(standby_mutex);
+        return standby_stats;
+    }
+}
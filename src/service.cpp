@@ -13,7 +13,7 @@ Datetime Service::getDatetime() const {
     return this->datetime;
 }
 
-std::string Service::getWorker() const {
+const std::string &Service::getWorker() const {
     return this->worker;
 }
 
@@ -0,0 +1,2755 @@
+#include "snapshot.h"
+#include "crc32c.h"
+#include "lz4.h"
+#include "files.h"
+#include "journal.h"
+#include "mapped_file.h"
+#include "ordinal_table.h"
+#include "parallel.h"
+#include "state.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdio>
+#include <climits>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <tuple>
+#include <stdexcept>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace snapshot {
+
+    static_assert(sizeof(Header) == 32);
+    static_assert(sizeof(SectionHeader) == 16);
+    static_assert(sizeof(PackedDatetime) == 8);
+    static_assert(sizeof(FlightRecord) == 36);
+    static_assert(sizeof(PlaneBlockRecord) == 32);
+    static_assert(sizeof(IndexNode) == INDEX_NODE_SIZE);
+
+    constexpr size_t ALIGNMENT = 8;
+    constexpr size_t SECTION_COUNT = static_cast<size_t>(SectionTag::FLIGHT_INDEX) + 1;
+
+    size_t alignUp(size_t value) {
+        return (value + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    PackedDatetime pack(const Datetime &datetime) {
+        Date date = datetime;
+        PackedDatetime packed = {};
+        packed.year = date.getYear();
+        packed.month = date.getMonth();
+        packed.day = date.getDay();
+        packed.hour = datetime.getHour();
+        packed.minute = datetime.getMinute();
+
+        return packed;
+    }
+
+    PackedTime pack(const Time &time) {
+        return PackedTime { static_cast<uint8_t>(time.getHour()), static_cast<uint8_t>(time.getMinute()) };
+    }
+
+    Datetime unpack(const PackedDatetime &packed) {
+        return Datetime(packed.year, packed.month, packed.day, packed.hour, packed.minute);
+    }
+
+    IndexEntry makeIndexEntry(const string &flight_id, const Datetime &departure_time, uint32_t target, uint32_t plane) {
+        IndexEntry entry = {};
+        memcpy(entry.flight_id, flight_id.data(), min(flight_id.size(), INDEX_KEY_LENGTH));
+        entry.departure_time = pack(departure_time);
+        entry.target = target;
+        entry.plane = plane;
+
+        return entry;
+    }
+
+    /**
+     * @brief Orders index entries by flight id, as strings are ordered, and then by departure time
+     */
+    int compareKeys(const IndexEntry &a, const IndexEntry &b) {
+        int order = memcmp(a.flight_id, b.flight_id, INDEX_KEY_LENGTH);
+        if (order != 0)
+            return order;
+
+        const PackedDatetime &x = a.departure_time, &y = b.departure_time;
+        auto fields = [](const PackedDatetime &datetime) {
+            return make_tuple(datetime.year, datetime.month, datetime.day, datetime.hour, datetime.minute);
+        };
+
+        return fields(x) < fields(y) ? -1 : fields(y) < fields(x) ? 1 : 0;
+    }
+
+    Time unpack(const PackedTime &packed) {
+        return Time(packed.hour, packed.minute);
+    }
+
+    /*----------READING----------*/
+
+    /**
+     * @brief Thrown when a record or string lies in a chunk whose checksum doesn't match
+     */
+    class corrupt_data_error : public runtime_error {
+    public:
+        using runtime_error::runtime_error;
+    };
+
+    static mutex quarantine_mutex;
+
+    /**
+     * @brief Records a part of the snapshot that was left out because it is corrupt
+     */
+    void quarantine(const string &what) {
+        lock_guard<mutex> lock(quarantine_mutex);
+        files::load_stats.quarantined.push_back(what);
+    }
+
+    /**
+     * @brief Asks for a range of a mapped file to be read in one go.
+     * Mappings that are read at random would otherwise read it a page at a time, as each page is touched.
+     */
+    void prefetch(const char *data, size_t size) {
+        static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+
+        uintptr_t first = reinterpret_cast<uintptr_t>(data) & ~(page_size - 1);
+        madvise(reinterpret_cast<void*>(first), reinterpret_cast<uintptr_t>(data) + size - first, MADV_WILLNEED);
+    }
+
+    /**
+     * @brief Adds back to every byte the byte `stride` bytes before it, in place, undoing the delta filter of an LZ4 chunk
+     */
+    void undoDelta(char *data, size_t size, size_t stride) {
+        if (stride == 0)
+            return;
+
+        size_t i = stride;
+
+        // Adds 8 bytes at a time, keeping the carries of the low 7 bits of every byte from reaching the next one
+        if (stride >= sizeof(uint64_t)) {
+            constexpr uint64_t LOW_BITS = 0x7F7F7F7F7F7F7F7F, HIGH_BITS = ~LOW_BITS;
+
+            for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+                uint64_t value, previous;
+                memcpy(&value, data + i, sizeof(value));
+                memcpy(&previous, data + i - stride, sizeof(previous));
+
+                value = ((value & LOW_BITS) + (previous & LOW_BITS)) ^ ((value ^ previous) & HIGH_BITS);
+                memcpy(data + i, &value, sizeof(value));
+            }
+        }
+
+        for (; i < size; i++)
+            data[i] = static_cast<char>(data[i] + data[i - stride]);
+    }
+
+    /**
+     * @brief The chunks of a section: their checksums, which of them were already verified, and, when the section is compressed,
+     * the memory they are decompressed into
+     */
+    class SectionChunks {
+        static constexpr uint8_t UNVERIFIED = 0, INTACT = 1, CORRUPT = 2, IN_PROGRESS = 3;
+
+        /** The records, or the stored chunks of a compressed section */
+        const char *data;
+        /** The size of the records */
+        size_t size;
+        const char *expected;
+        size_t chunk_count;
+
+        /** Where every stored chunk ends, as offsets from data, or nullptr if the section isn't compressed */
+        const char *chunk_ends = nullptr;
+        uint32_t delta_stride = 0;
+        char *records = nullptr;
+
+        unique_ptr<atomic<uint8_t>[]> states;
+
+        pair<uint32_t, uint32_t> getStoredRange(size_t chunk) const {
+            uint32_t first = 0, last;
+            if (chunk > 0)
+                memcpy(&first, this->chunk_ends + (chunk - 1) * sizeof(uint32_t), sizeof(first));
+
+            memcpy(&last, this->chunk_ends + chunk * sizeof(uint32_t), sizeof(last));
+            return { first, last };
+        }
+
+        /**
+         * @brief Verifies a chunk, and decompresses it if the section is compressed
+         */
+        bool check(size_t chunk) const {
+            size_t offset = chunk * CHECKSUM_CHUNK_SIZE;
+            size_t length = min(CHECKSUM_CHUNK_SIZE, this->size - offset);
+
+            uint32_t checksum;
+            memcpy(&checksum, this->expected + chunk * sizeof(uint32_t), sizeof(checksum));
+
+            if (this->chunk_ends == nullptr) {
+                prefetch(this->data + offset, length);
+                return crc32c::compute(this->data + offset, length) == checksum;
+            }
+
+            auto [first, last] = this->getStoredRange(chunk);
+            const char *stored = this->data + first;
+            prefetch(stored, last - first);
+
+            if (crc32c::compute(stored, last - first) != checksum)
+                return false;
+
+            if (last - first == length) {
+                memcpy(this->records + offset, stored, length);
+                return true;
+            }
+
+            if (!lz4::decompress(stored, last - first, this->records + offset, length))
+                return false;
+
+            undoDelta(this->records + offset, length, this->delta_stride);
+            return true;
+        }
+
+        /**
+         * @brief Verifies a chunk unless it was verified before. Threads that need a chunk that is being verified wait for it.
+         */
+        uint8_t settle(size_t chunk) const {
+            uint8_t state = this->states[chunk].load(memory_order_acquire);
+            if (state == INTACT || state == CORRUPT)
+                return state;
+
+            state = UNVERIFIED;
+            if (!this->states[chunk].compare_exchange_strong(state, IN_PROGRESS, memory_order_acquire)) {
+                while (state == IN_PROGRESS) {
+                    this_thread::yield();
+                    state = this->states[chunk].load(memory_order_acquire);
+                }
+
+                return state;
+            }
+
+            state = this->check(chunk) ? INTACT : CORRUPT;
+            this->states[chunk].store(state, memory_order_release);
+            return state;
+        }
+
+    public:
+        /**
+         * @brief The chunks of a section that is stored as it is
+         */
+        SectionChunks(const char *data, size_t size, const char *expected)
+                : data(data), size(size), expected(expected), chunk_count((size + CHECKSUM_CHUNK_SIZE - 1) / CHECKSUM_CHUNK_SIZE),
+                  states(new atomic<uint8_t>[chunk_count]) {
+            for (size_t i = 0; i < chunk_count; i++)
+                states[i] = UNVERIFIED;
+        }
+
+        /**
+         * @brief The chunks of an LZ4 section
+         * @param stored The section as stored in the file, starting with its table of chunks
+         * @param size The size of its records
+         *
+         * @throws std::runtime_error if its table of chunks is malformed, or there isn't enough memory to decompress it
+         */
+        SectionChunks(const char *stored, size_t stored_size, size_t size, const char *expected, uint32_t delta_stride)
+                : SectionChunks(stored, size, expected) {
+            size_t table_size = this->chunk_count * sizeof(uint32_t);
+            this->chunk_ends = stored;
+            this->data = stored + table_size;
+            this->delta_stride = delta_stride;
+
+            // Chunks that grew or overlap could only come from a malformed file
+            for (size_t chunk = 0, previous_end = 0; chunk < this->chunk_count; chunk++) {
+                auto [first, last] = this->getStoredRange(chunk);
+                size_t length = min(CHECKSUM_CHUNK_SIZE, size - chunk * CHECKSUM_CHUNK_SIZE);
+
+                if (first != previous_end || last < first || last - first > length || last > stored_size - table_size)
+                    throw runtime_error("Snapshot section is malformed");
+
+                previous_end = last;
+            }
+
+            if (delta_stride >= CHECKSUM_CHUNK_SIZE)
+                throw runtime_error("Snapshot section is malformed");
+
+            // Only the pages of the chunks that get decompressed take up memory
+            if (size != 0) {
+                void *memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (memory == MAP_FAILED)
+                    throw runtime_error("Not enough memory to decompress the snapshot");
+
+                this->records = static_cast<char*>(memory);
+            }
+        }
+
+        SectionChunks(const SectionChunks &) = delete;
+        SectionChunks &operator=(const SectionChunks &) = delete;
+
+        ~SectionChunks() {
+            if (this->records != nullptr)
+                munmap(this->records, this->size);
+        }
+
+        size_t getChunkCount() const {
+            return this->chunk_count;
+        }
+
+        /**
+         * @brief Returns where the records can be read once their chunks are verified
+         */
+        const char *getRecords() const {
+            return this->records != nullptr ? this->records : this->data;
+        }
+
+        /**
+         * @brief Verifies every chunk that overlaps the bytes in [first, last), unless it was verified before
+         * @return Whether all of them are intact
+         */
+        bool verify(size_t first, size_t last) const {
+            if (first >= last)
+                return true;
+
+            bool is_intact = true;
+            for (size_t chunk = first / CHECKSUM_CHUNK_SIZE; chunk <= (last - 1) / CHECKSUM_CHUNK_SIZE; chunk++)
+                is_intact = this->settle(chunk) == INTACT && is_intact;
+
+            return is_intact;
+        }
+
+        /**
+         * @brief Verifies every chunk, on several threads
+         */
+        bool verifyAll() const {
+            atomic<bool> is_intact = true;
+            parallel::forEach(this->chunk_count, [this, &is_intact](size_t chunk) {
+                if (this->settle(chunk) != INTACT)
+                    is_intact = false;
+            });
+
+            return is_intact;
+        }
+    };
+
+    struct Section {
+        const char *records = nullptr;
+        uint64_t record_count = 0;
+        uint32_t record_size = 0;
+        /** Missing in snapshots written before checksums existed */
+        shared_ptr<const SectionChunks> chunks;
+
+        /**
+         * @brief Verifies the chunks that hold the records in [first, last)
+         */
+        bool verify(uint64_t first, uint64_t last) const {
+            return this->chunks == nullptr || this->chunks->verify(first * this->record_size, last * this->record_size);
+        }
+
+        bool verifyAll() const {
+            return this->chunks == nullptr || this->chunks->verifyAll();
+        }
+    };
+
+    /**
+     * @brief Walks the records of a section, or of a range of it, in order
+     */
+    template <typename T>
+    class RecordCursor {
+        const Section &section;
+        uint64_t position = 0;
+        uint64_t end;
+
+    public:
+        explicit RecordCursor(const Section &section) : section(section), end(section.record_count) {}
+
+        /**
+         * @brief Walks the records in [first, last)
+         */
+        RecordCursor(const Section &section, uint64_t first, uint64_t last) : section(section), position(first), end(last) {
+            if (first > last || last > section.record_count)
+                throw runtime_error("Snapshot table of contents is out of bounds");
+        }
+
+        T next() {
+            if (position >= end)
+                throw runtime_error("Snapshot section is shorter than expected");
+
+            T record;
+            memcpy(&record, section.records + position++ * sizeof(T), sizeof(T));
+            return record;
+        }
+
+        bool atEnd() const {
+            return position == end;
+        }
+    };
+
+    class SnapshotReader {
+        array<Section, SECTION_COUNT> sections;
+        uint64_t journal_generation;
+
+        template <typename T>
+        void expectRecordSize(const SectionHeader &header) {
+            if (header.record_size != sizeof(T))
+                throw runtime_error("Snapshot section has an unexpected record size");
+        }
+
+    public:
+        explicit SnapshotReader(const MappedFile &file) {
+            const char *begin = file.getData();
+            size_t size = file.getSize();
+
+            Header header;
+            if (size < sizeof(header))
+                throw runtime_error("Snapshot is too small");
+
+            memcpy(&header, begin, sizeof(header));
+            if (memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+                throw runtime_error("Not a snapshot file");
+
+            if (header.version < MIN_VERSION || header.version > VERSION)
+                throw runtime_error("Unsupported snapshot version");
+
+            if (header.file_size != size)
+                throw runtime_error("Snapshot is truncated");
+
+            this->journal_generation = header.journal_generation;
+
+            // The headers are checksummed as a whole, and every other section chunk by chunk, in file order
+            uint32_t header_checksum = crc32c::compute(begin, sizeof(header));
+            vector<size_t> file_order;
+            array<SectionEncoding, SECTION_COUNT> encodings = {};
+
+            size_t offset = sizeof(header);
+            for (uint32_t i = 0; i < header.section_count; i++) {
+                SectionHeader section_header;
+                if (offset + sizeof(section_header) > size)
+                    throw runtime_error("Snapshot is truncated");
+
+                memcpy(&section_header, begin + offset, sizeof(section_header));
+                header_checksum = crc32c::extend(header_checksum, begin + offset, sizeof(section_header));
+                offset += sizeof(section_header);
+
+                auto index = static_cast<size_t>(section_header.tag);
+                if (index == 0 || index >= SECTION_COUNT)
+                    throw runtime_error("Unknown snapshot section");
+
+                switch (section_header.tag) {
+                    case SectionTag::STRINGS: expectRecordSize<char>(section_header); break;
+                    case SectionTag::AIRPORTS: expectRecordSize<AirportRecord>(section_header); break;
+                    case SectionTag::TRANSPORT_PLACES: expectRecordSize<TransportPlaceRecord>(section_header); break;
+                    case SectionTag::SCHEDULES: expectRecordSize<PackedTime>(section_header); break;
+                    case SectionTag::PLANES: expectRecordSize<PlaneRecord>(section_header); break;
+                    case SectionTag::SERVICES: expectRecordSize<ServiceRecord>(section_header); break;
+                    case SectionTag::FLIGHTS: expectRecordSize<FlightRecord>(section_header); break;
+                    case SectionTag::TICKETS: expectRecordSize<TicketRecord>(section_header); break;
+                    case SectionTag::LUGGAGE: expectRecordSize<LuggageRecord>(section_header); break;
+                    case SectionTag::HANDLING_CARS: expectRecordSize<HandlingCarRecord>(section_header); break;
+                    case SectionTag::CAR_LUGGAGE: expectRecordSize<LuggageRecord>(section_header); break;
+                    case SectionTag::PLANE_BLOCKS: expectRecordSize<PlaneBlockRecord>(section_header); break;
+                    case SectionTag::CHECKSUMS: expectRecordSize<uint32_t>(section_header); break;
+                    case SectionTag::FLIGHT_ORDER: expectRecordSize<uint32_t>(section_header); break;
+                    case SectionTag::FLIGHT_INDEX: expectRecordSize<IndexNode>(section_header); break;
+                }
+
+                if (section_header.record_count > UINT64_MAX / section_header.record_size)
+                    throw runtime_error("Snapshot section is malformed");
+
+                uint64_t length = section_header.record_size * section_header.record_count;
+
+                // Snapshots written before sections could be compressed store every section as it is
+                SectionEncoding encoding = { Encoding::RAW, 0, length };
+                if (header.version >= 7) {
+                    if (offset + sizeof(encoding) > size)
+                        throw runtime_error("Snapshot is truncated");
+
+                    memcpy(&encoding, begin + offset, sizeof(encoding));
+                    header_checksum = crc32c::extend(header_checksum, begin + offset, sizeof(encoding));
+                    offset += sizeof(encoding);
+                }
+
+                if (encoding.stored_size > size - offset)
+                    throw runtime_error("Snapshot is truncated");
+
+                if (encoding.encoding == Encoding::RAW) {
+                    if (encoding.stored_size != length)
+                        throw runtime_error("Snapshot section is malformed");
+                } else if (encoding.encoding == Encoding::LZ4 && section_header.tag != SectionTag::CHECKSUMS) {
+                    // The table of chunks is checksummed along with the headers
+                    uint64_t table_size = (length + CHECKSUM_CHUNK_SIZE - 1) / CHECKSUM_CHUNK_SIZE * sizeof(uint32_t);
+                    if (table_size > encoding.stored_size)
+                        throw runtime_error("Snapshot section is malformed");
+
+                    header_checksum = crc32c::extend(header_checksum, begin + offset, table_size);
+                } else {
+                    throw runtime_error("Unknown snapshot section encoding");
+                }
+
+                this->sections[index] = Section { begin + offset, section_header.record_count, section_header.record_size, nullptr };
+                encodings[index] = encoding;
+                if (section_header.tag != SectionTag::CHECKSUMS)
+                    file_order.push_back(index);
+
+                offset = alignUp(offset + encoding.stored_size);
+            }
+
+            if (header.version < 4)
+                return;
+
+            const Section &checksums = this->getSection(SectionTag::CHECKSUMS);
+            if (checksums.record_count == 0)
+                throw runtime_error("Snapshot has no checksums");
+
+            uint32_t expected_header_checksum;
+            memcpy(&expected_header_checksum, checksums.records, sizeof(expected_header_checksum));
+
+            const char *chunk_checksums = checksums.records + sizeof(uint32_t);
+            size_t chunk_checksum_count = checksums.record_count - 1;
+
+            header_checksum = crc32c::extend(header_checksum, chunk_checksums, chunk_checksum_count * sizeof(uint32_t));
+            if (header_checksum != expected_header_checksum)
+                throw runtime_error("Snapshot headers are corrupt");
+
+            for (size_t index : file_order) {
+                Section &section = this->sections[index];
+                const SectionEncoding &encoding = encodings[index];
+                size_t length = section.record_count * section.record_size;
+
+                shared_ptr<const SectionChunks> chunks;
+                if (encoding.encoding == Encoding::LZ4)
+                    chunks = make_shared<const SectionChunks>(section.records, encoding.stored_size, length, chunk_checksums, encoding.delta_stride);
+                else
+                    chunks = make_shared<const SectionChunks>(section.records, length, chunk_checksums);
+
+                if (chunks->getChunkCount() > chunk_checksum_count)
+                    throw runtime_error("Snapshot checksums don't match its sections");
+
+                chunk_checksums += chunks->getChunkCount() * sizeof(uint32_t);
+                chunk_checksum_count -= chunks->getChunkCount();
+                section.records = chunks->getRecords();
+                section.chunks = move(chunks);
+            }
+
+            if (chunk_checksum_count != 0)
+                throw runtime_error("Snapshot checksums don't match its sections");
+        }
+
+        uint64_t getJournalGeneration() const {
+            return this->journal_generation;
+        }
+
+        const Section &getSection(SectionTag tag) const {
+            return this->sections[static_cast<size_t>(tag)];
+        }
+
+        /**
+         * @brief Forgets every section but the given ones, which gives back the memory of the others once no reader needs them
+         */
+        void retain(initializer_list<SectionTag> tags) {
+            array<Section, SECTION_COUNT> kept;
+            for (SectionTag tag : tags)
+                kept[static_cast<size_t>(tag)] = move(this->sections[static_cast<size_t>(tag)]);
+
+            this->sections = move(kept);
+        }
+
+        /**
+         * @brief Returns a string where it lies in the snapshot, which must stay mapped while it is used
+         * @throws corrupt_data_error if the string lies in a corrupt chunk
+         */
+        string_view viewString(const StringRef &ref) const {
+            const Section &strings = this->getSection(SectionTag::STRINGS);
+            if (static_cast<uint64_t>(ref.offset) + ref.length > strings.record_count)
+                throw runtime_error("Snapshot string reference is out of bounds");
+
+            if (!strings.verify(ref.offset, static_cast<uint64_t>(ref.offset) + ref.length))
+                throw corrupt_data_error("Snapshot string is corrupt");
+
+            return string_view(strings.records + ref.offset, ref.length);
+        }
+
+        /**
+         * @throws corrupt_data_error if the string lies in a corrupt chunk
+         */
+        string getString(const StringRef &ref) const {
+            return string(this->viewString(ref));
+        }
+    };
+
+    ServiceType toServiceType(uint32_t value) {
+        switch (value) {
+            case static_cast<uint32_t>(ServiceType::MAINTENANCE):
+                return ServiceType::MAINTENANCE;
+            case static_cast<uint32_t>(ServiceType::CLEANING):
+                return ServiceType::CLEANING;
+            default:
+                throw runtime_error("Unknown service type");
+        }
+    }
+
+    TransportType toTransportType(uint32_t value) {
+        switch (value) {
+            case TransportType::SUBWAY:
+                return TransportType::SUBWAY;
+            case TransportType::BUS:
+                return TransportType::BUS;
+            case TransportType::TRAIN:
+                return TransportType::TRAIN;
+            default:
+                throw runtime_error("Unknown transport type");
+        }
+    }
+
+    /**
+     * @brief Creates a flight's tickets and luggage straight from the snapshot, which stays mapped while any flight needs it.
+     * When any of a flight's tickets or luggage is corrupt, all of them are left out, and a copy of the snapshot is kept next to it.
+     */
+    class SnapshotPassengers : public PassengerLoader {
+        shared_ptr<const MappedFile> file;
+        SnapshotReader reader;
+        string path;
+        mutable once_flag copy_saved;
+
+        void quarantineFlight(const Flight &flight) const {
+            quarantine("Tickets and luggage of flight " + flight.getFlightId() + " at " + flight.getDepartureTime().str());
+
+            // By now the snapshot may have been replaced, so the copy is written from the mapping
+            call_once(this->copy_saved, [this]() {
+                string kept = files::getQuarantinePath(this->path);
+                ofstream copy(kept, ios::binary | ios::trunc);
+                copy.write(this->file->getData(), this->file->getSize());
+                copy.close();
+
+                if (!copy) {
+                    remove(kept.c_str());
+                    return;
+                }
+
+                lock_guard<mutex> lock(quarantine_mutex);
+                files::load_stats.kept_copies.push_back(kept);
+            });
+        }
+
+    public:
+        SnapshotPassengers(shared_ptr<const MappedFile> file, const SnapshotReader &reader, const string &path)
+                : file(move(file)), reader(reader), path(path) {
+            // The other sections are only needed while the snapshot is loaded, and compressed ones hold memory until then
+            this->reader.retain({ SectionTag::STRINGS, SectionTag::TICKETS, SectionTag::LUGGAGE });
+        }
+
+        const SnapshotReader &getReader() const {
+            return this->reader;
+        }
+
+        void load(Flight &flight, const PassengerRange &range) const override {
+            const Section &ticket_section = reader.getSection(SectionTag::TICKETS);
+            const Section &luggage_section = reader.getSection(SectionTag::LUGGAGE);
+
+            if (!ticket_section.verify(range.first_ticket, range.first_ticket + range.ticket_count)
+                || !luggage_section.verify(range.first_luggage, range.first_luggage + range.luggage_count)) {
+                quarantineFlight(flight);
+                return;
+            }
+
+            RecordCursor<TicketRecord> tickets(ticket_section, range.first_ticket, range.first_ticket + range.ticket_count);
+            RecordCursor<LuggageRecord> luggage(luggage_section, range.first_luggage, range.first_luggage + range.luggage_count);
+
+            // Tickets are stored sorted by seat, so their position here matches their position in the flight
+            vector<Ticket*> flight_tickets;
+            flight_tickets.reserve(range.ticket_count);
+
+            try {
+                for (uint32_t i = 0; i < range.ticket_count; i++) {
+                    TicketRecord ticket_record = tickets.next();
+                    Ticket *ticket = new Ticket(flight, reader.getString(ticket_record.customer_name), ticket_record.customer_age, ticket_record.seat_number);
+                    flight.addTicket(*ticket);
+                    flight_tickets.push_back(ticket);
+                }
+
+                for (uint32_t i = 0; i < range.luggage_count; i++) {
+                    LuggageRecord luggage_record = luggage.next();
+                    if (luggage_record.ticket >= flight_tickets.size())
+                        throw corrupt_data_error("Snapshot luggage refers to an unknown ticket");
+
+                    flight.addLuggage(*new Luggage(*flight_tickets[luggage_record.ticket], luggage_record.weight));
+                }
+            } catch (corrupt_data_error &error) {
+                // Luggage and handling cars refer to tickets by position, so the flight's tickets and luggage are left out together
+                for (Luggage *piece : flight.getLuggage())
+                    delete piece;
+
+                flight.clearLuggage();
+                flight.clearTickets();
+                for (Ticket *ticket : flight_tickets)
+                    delete ticket;
+
+                quarantineFlight(flight);
+                return;
+            }
+        }
+
+        bool visitTickets(const Flight &flight, const PassengerRange &range, const function<void(const Ticket&)> &visitor) const override {
+            const Section &ticket_section = reader.getSection(SectionTag::TICKETS);
+            const Section &string_section = reader.getSection(SectionTag::STRINGS);
+
+            if (!ticket_section.verify(range.first_ticket, range.first_ticket + range.ticket_count))
+                return false;
+
+            // Every string is checked before the first ticket is visited, so that a corrupt flight isn't visited halfway
+            uint64_t first_string = UINT64_MAX, last_string = 0;
+            RecordCursor<TicketRecord> bounds(ticket_section, range.first_ticket, range.first_ticket + range.ticket_count);
+            for (uint32_t i = 0; i < range.ticket_count; i++) {
+                StringRef name = bounds.next().customer_name;
+                first_string = min<uint64_t>(first_string, name.offset);
+                last_string = max<uint64_t>(last_string, static_cast<uint64_t>(name.offset) + name.length);
+            }
+
+            if (range.ticket_count != 0 && (last_string > string_section.record_count || !string_section.verify(first_string, last_string)))
+                return false;
+
+            // Flights are never created const, as in Flight::loadPassengers
+            Flight &owner = const_cast<Flight&>(flight);
+            RecordCursor<TicketRecord> tickets(ticket_section, range.first_ticket, range.first_ticket + range.ticket_count);
+            for (uint32_t i = 0; i < range.ticket_count; i++) {
+                TicketRecord record = tickets.next();
+                Ticket ticket(owner, reader.getString(record.customer_name), record.customer_age, record.seat_number);
+                visitor(ticket);
+            }
+
+            return true;
+        }
+    };
+
+    /**
+     * @brief Returns where each plane's records start, followed by the end of every section.
+     * The table of contents is rebuilt from the record counts for snapshots written before the PLANE_BLOCKS section existed,
+     * and when it is corrupt. Without the flights, only the services can be located.
+     */
+    vector<PlaneBlockRecord> getPlaneBlocks(const SnapshotReader &reader, bool use_table, bool use_flights) {
+        const Section &plane_section = reader.getSection(SectionTag::PLANES);
+
+        vector<PlaneBlockRecord> blocks;
+        blocks.reserve(plane_section.record_count + 1);
+
+        const Section &block_section = reader.getSection(SectionTag::PLANE_BLOCKS);
+        if (use_table && block_section.records != nullptr) {
+            if (block_section.record_count != plane_section.record_count)
+                throw runtime_error("Snapshot table of contents doesn't match its sections");
+
+            RecordCursor<PlaneBlockRecord> cursor(block_section);
+            for (uint64_t i = 0; i < block_section.record_count; i++)
+                blocks.push_back(cursor.next());
+
+            if (!blocks.empty() && (blocks[0].service != 0 || blocks[0].flight != 0 || blocks[0].ticket != 0 || blocks[0].luggage != 0))
+                throw runtime_error("Snapshot table of contents doesn't match its sections");
+        } else {
+            RecordCursor<PlaneRecord> planes(plane_section);
+            RecordCursor<FlightRecord> flights(reader.getSection(SectionTag::FLIGHTS));
+
+            PlaneBlockRecord block = {};
+            for (uint64_t i = 0; i < plane_section.record_count; i++) {
+                blocks.push_back(block);
+
+                PlaneRecord record = planes.next();
+                block.service += record.finished_service_count + record.scheduled_service_count;
+
+                if (!use_flights)
+                    continue;
+
+                block.flight += record.flight_count;
+                for (uint32_t j = 0; j < record.flight_count; j++) {
+                    FlightRecord flight_record = flights.next();
+                    block.ticket += flight_record.ticket_count;
+                    block.luggage += flight_record.luggage_count;
+                }
+            }
+        }
+
+        blocks.push_back(PlaneBlockRecord {
+            reader.getSection(SectionTag::SERVICES).record_count,
+            reader.getSection(SectionTag::FLIGHTS).record_count,
+            reader.getSection(SectionTag::TICKETS).record_count,
+            reader.getSection(SectionTag::LUGGAGE).record_count
+        });
+
+        return blocks;
+    }
+
+    /**
+     * @brief Fills `data::flights` in the order given by the FLIGHT_ORDER section, leaving out the flights that weren't loaded
+     * @return false, if the section doesn't list every flight exactly once, in which case `data::flights` is left empty
+     */
+    bool restoreFlightOrder(const Section &order_section, const vector<Flight*> &flight_slots) {
+        if (order_section.record_count != flight_slots.size() || flight_slots.empty())
+            return false;
+
+        vector<bool> is_placed(flight_slots.size(), false);
+        vector<Flight*> flights;
+        flights.reserve(flight_slots.size());
+
+        RecordCursor<uint32_t> order(order_section);
+        for (size_t i = 0; i < flight_slots.size(); i++) {
+            uint32_t index = order.next();
+            if (index >= flight_slots.size() || is_placed[index])
+                return false;
+
+            is_placed[index] = true;
+            if (flight_slots[index] != nullptr)
+                flights.push_back(flight_slots[index]);
+        }
+
+        data::flights = move(flights);
+        return true;
+    }
+
+    uint64_t read(const string &path) {
+        optional<files::LoadTimer> timer(in_place, files::load_stats.mapping);
+        auto file = make_shared<const MappedFile>(path);
+        SnapshotReader reader(*file);
+        auto passengers = make_shared<const SnapshotPassengers>(file, reader, path);
+
+        // Tickets, luggage and the strings they use are verified when their flight is loaded
+        timer.emplace(files::load_stats.verification);
+        auto isIntact = [&reader](SectionTag tag, const string &name) {
+            if (reader.getSection(tag).verifyAll())
+                return true;
+
+            quarantine(name + " section");
+            return false;
+        };
+
+        bool airports_intact = isIntact(SectionTag::AIRPORTS, "Airports");
+        bool places_intact = isIntact(SectionTag::TRANSPORT_PLACES, "Transport places") && isIntact(SectionTag::SCHEDULES, "Schedules");
+        bool planes_intact = isIntact(SectionTag::PLANES, "Planes");
+        bool blocks_intact = isIntact(SectionTag::PLANE_BLOCKS, "Table of contents");
+        bool services_intact = isIntact(SectionTag::SERVICES, "Services");
+        bool flights_intact = isIntact(SectionTag::FLIGHTS, "Flights");
+        bool cars_intact = isIntact(SectionTag::HANDLING_CARS, "Handling cars");
+        bool car_luggage_intact = isIntact(SectionTag::CAR_LUGGAGE, "Handling car luggage");
+        bool order_intact = isIntact(SectionTag::FLIGHT_ORDER, "Flight order");
+
+        timer.emplace(files::load_stats.airports);
+        RecordCursor<AirportRecord> airports(reader.getSection(SectionTag::AIRPORTS));
+        RecordCursor<TransportPlaceRecord> places(reader.getSection(SectionTag::TRANSPORT_PLACES));
+        RecordCursor<PackedTime> schedules(reader.getSection(SectionTag::SCHEDULES));
+
+        // Airports that had to be left out stay as null, so that flights can still refer to the others by index
+        uint64_t airport_count = reader.getSection(SectionTag::AIRPORTS).record_count;
+        vector<Airport*> airport_slots;
+        airport_slots.reserve(airport_count);
+
+        for (uint64_t i = 0; airports_intact && i < airport_count; i++) {
+            AirportRecord record = airports.next();
+
+            Airport *airport = nullptr;
+            try {
+                airport = new Airport(reader.getString(record.name));
+            } catch (corrupt_data_error &error) {
+                quarantine("Airport #" + to_string(i + 1));
+            }
+
+            airport_slots.push_back(airport);
+
+            for (uint32_t j = 0; places_intact && j < record.place_count; j++) {
+                TransportPlaceRecord place_record = places.next();
+
+                TransportPlace place = {
+                    .name = {},
+                    .latitude = place_record.latitude,
+                    .longitude = place_record.longitude,
+                    .transport_type = toTransportType(place_record.transport_type),
+                    .airport_distance = place_record.airport_distance,
+                    .schedule = {}
+                };
+
+                for (uint32_t k = 0; k < place_record.schedule_count; k++)
+                    place.schedule.insert(unpack(schedules.next()));
+
+                try {
+                    place.name = reader.getString(place_record.name);
+                } catch (corrupt_data_error &error) {
+                    quarantine("A transport place of airport #" + to_string(i + 1));
+                    continue;
+                }
+
+                if (airport != nullptr)
+                    airport->addTransportPlaceInfo(place);
+            }
+        }
+
+        for (Airport *airport : airport_slots) {
+            if (airport != nullptr)
+                data::airports.push_back(airport);
+        }
+
+        timer.emplace(files::load_stats.flights);
+        const Section &plane_section = reader.getSection(SectionTag::PLANES);
+        const Section &service_section = reader.getSection(SectionTag::SERVICES);
+        const Section &flight_section = reader.getSection(SectionTag::FLIGHTS);
+
+        uint64_t plane_count = planes_intact ? plane_section.record_count : 0;
+        vector<PlaneBlockRecord> blocks;
+        if (planes_intact)
+            blocks = getPlaneBlocks(reader, blocks_intact, flights_intact);
+
+        // Every plane and flight gets its final position up front, so the result doesn't depend on which thread loads it.
+        // Those that have to be left out stay as null.
+        vector<Plane*> plane_slots(plane_count, nullptr);
+        vector<Flight*> flight_slots(planes_intact && flights_intact ? flight_section.record_count : 0, nullptr);
+
+        try {
+            parallel::forEach(plane_count, [&](size_t i) {
+                const PlaneBlockRecord &block = blocks[i];
+                const PlaneBlockRecord &next_block = blocks[i + 1];
+
+                PlaneRecord record = RecordCursor<PlaneRecord>(plane_section, i, i + 1).next();
+
+                Plane *plane;
+                try {
+                    plane = new Plane(reader.getString(record.license_plate), reader.getString(record.type), record.capacity);
+                } catch (corrupt_data_error &error) {
+                    quarantine("Plane #" + to_string(i + 1) + ", with its services and flights");
+                    return;
+                }
+
+                plane_slots[i] = plane;
+
+                if (services_intact) {
+                    RecordCursor<ServiceRecord> services(service_section, block.service, next_block.service);
+
+                    for (uint32_t j = 0; j < record.finished_service_count + record.scheduled_service_count; j++) {
+                        ServiceRecord service_record = services.next();
+
+                        Service *service;
+                        try {
+                            service = new Service(toServiceType(service_record.type), unpack(service_record.datetime), reader.getString(service_record.worker), *plane);
+                        } catch (corrupt_data_error &error) {
+                            quarantine("A service of plane " + plane->getLicensePlate());
+                            continue;
+                        }
+
+                        // Finished services come first, so the service completed here is always the one just scheduled
+                        plane->scheduleService(*service);
+                        if (j < record.finished_service_count)
+                            plane->completeService();
+                    }
+
+                    if (!services.atEnd())
+                        throw runtime_error("Snapshot table of contents doesn't match its sections");
+                }
+
+                if (!flights_intact)
+                    return;
+
+                RecordCursor<FlightRecord> flights(flight_section, block.flight, next_block.flight);
+
+                // Tickets and luggage are only counted here; they are loaded when their flight first needs them
+                uint64_t next_ticket = block.ticket;
+                uint64_t next_luggage = block.luggage;
+
+                for (uint32_t j = 0; j < record.flight_count; j++) {
+                    FlightRecord flight_record = flights.next();
+                    if (flight_record.origin >= airport_count || flight_record.destination >= airport_count)
+                        throw runtime_error("Unknown origin or destination airports");
+
+                    PassengerRange range = { next_ticket, flight_record.ticket_count, next_luggage, flight_record.luggage_count };
+                    next_ticket += flight_record.ticket_count;
+                    next_luggage += flight_record.luggage_count;
+
+                    Airport *origin = airports_intact ? airport_slots[flight_record.origin] : nullptr;
+                    Airport *destination = airports_intact ? airport_slots[flight_record.destination] : nullptr;
+
+                    Flight *flight;
+                    try {
+                        if (origin == nullptr || destination == nullptr)
+                            throw corrupt_data_error("Flight airports are corrupt");
+
+                        flight = new Flight(reader.getString(flight_record.flight_id), unpack(flight_record.departure_time), unpack(flight_record.duration),
+                                            *origin, *destination, *plane);
+                    } catch (corrupt_data_error &error) {
+                        quarantine("Flight #" + to_string(j + 1) + " of plane " + plane->getLicensePlate());
+                        continue;
+                    }
+
+                    flight->setPassengerLoader(passengers, range);
+                    plane->addFlight(*flight);
+                    flight_slots[block.flight + j] = flight;
+                }
+
+                if (!flights.atEnd() || next_ticket != next_block.ticket || next_luggage != next_block.luggage)
+                    throw runtime_error("Snapshot table of contents doesn't match its sections");
+            });
+        } catch (...) {
+            // None of these reached `data` yet, so files::clear wouldn't free them
+            for (Flight *flight : flight_slots)
+                delete flight;
+
+            for (Plane *plane : plane_slots) {
+                if (plane == nullptr)
+                    continue;
+
+                for (Service *service : plane->getFinishedServices())
+                    delete service;
+
+                queue<Service*> services = plane->getScheduledServices();
+                for (; !services.empty(); services.pop())
+                    delete services.front();
+
+                delete plane;
+            }
+
+            throw;
+        }
+
+        for (Plane *plane : plane_slots) {
+            if (plane != nullptr)
+                data::planes.push_back(plane);
+        }
+
+        timer.emplace(files::load_stats.handling_cars);
+        RecordCursor<HandlingCarRecord> cars(reader.getSection(SectionTag::HANDLING_CARS));
+        RecordCursor<LuggageRecord> car_luggage(reader.getSection(SectionTag::CAR_LUGGAGE));
+
+        uint64_t car_count = cars_intact ? reader.getSection(SectionTag::HANDLING_CARS).record_count : 0;
+        data::handlingCars.reserve(car_count);
+
+        for (uint64_t i = 0; i < car_count; i++) {
+            HandlingCarRecord record = cars.next();
+            HandlingCar *car = new HandlingCar(record.number_of_carriages, record.stacks_per_carriage, record.luggage_per_stack);
+            data::handlingCars.push_back(car);
+
+            if (record.flight == NONE)
+                continue;
+
+            if (record.flight >= flight_section.record_count)
+                throw runtime_error("Handling car refers to an unknown flight");
+
+            Flight *flight = record.flight < flight_slots.size() ? flight_slots[record.flight] : nullptr;
+            if (flight != nullptr)
+                car->setFlight(*flight);
+
+            if (!car_luggage_intact)
+                continue;
+
+            bool is_complete = flight != nullptr;
+            for (uint32_t j = 0; j < record.luggage_count; j++) {
+                LuggageRecord luggage_record = car_luggage.next();
+                if (flight == nullptr)
+                    continue;
+
+                // The flight's tickets may have been left out
+                const vector<Ticket*> &flight_tickets = flight->getTickets();
+                if (luggage_record.ticket >= flight_tickets.size()) {
+                    is_complete = false;
+                    continue;
+                }
+
+                car->addLuggage(*new Luggage(*flight_tickets[luggage_record.ticket], luggage_record.weight));
+            }
+
+            if (!is_complete)
+                quarantine("Luggage of handling car #" + to_string(i + 1));
+        }
+
+        timer.emplace(files::load_stats.indexing);
+
+        // Flights are stored in plane order, but the lookups expect them sorted by id, so they are only sorted again when
+        // the order they were saved in is missing
+        if (!order_intact || !restoreFlightOrder(reader.getSection(SectionTag::FLIGHT_ORDER), flight_slots)) {
+            for (Flight *flight : flight_slots) {
+                if (flight != nullptr)
+                    data::flights.push_back(flight);
+            }
+
+            stable_sort(data::flights.begin(), data::flights.end(), [](const Flight *a, const Flight *b) {
+                return a->getFlightId() < b->getFlightId();
+            });
+        }
+
+        return reader.getJournalGeneration();
+    }
+
+    /**
+     * @brief Reads a single record, verifying the chunks it lies in
+     * @throws std::runtime_error if it is out of bounds or corrupt
+     */
+    template <typename T>
+    T readRecord(const Section &section, uint64_t index) {
+        if (index >= section.record_count)
+            throw runtime_error("Snapshot reference is out of bounds");
+
+        if (!section.verify(index, index + 1))
+            throw runtime_error("Snapshot record is corrupt");
+
+        return RecordCursor<T>(section, index, index + 1).next();
+    }
+
+    /**
+     * @brief Builds a flight, along with copies of its plane and airports, and its tickets and luggage
+     */
+    FlightManifest readManifest(const SnapshotReader &reader, const FlightRecord &flight_record, uint32_t flight, uint32_t plane) {
+        const Section &flight_section = reader.getSection(SectionTag::FLIGHTS);
+        const Section &ticket_section = reader.getSection(SectionTag::TICKETS);
+        const Section &luggage_section = reader.getSection(SectionTag::LUGGAGE);
+
+        // The flight's passengers start after those of the flights before it on the same plane
+        PlaneBlockRecord block = readRecord<PlaneBlockRecord>(reader.getSection(SectionTag::PLANE_BLOCKS), plane);
+        if (flight < block.flight || !flight_section.verify(block.flight, flight))
+            throw runtime_error("Snapshot flights are corrupt");
+
+        PassengerRange range = { block.ticket, flight_record.ticket_count, block.luggage, flight_record.luggage_count };
+        RecordCursor<FlightRecord> previous_flights(flight_section, block.flight, flight);
+        for (uint32_t i = block.flight; i < flight; i++) {
+            FlightRecord previous = previous_flights.next();
+            range.first_ticket += previous.ticket_count;
+            range.first_luggage += previous.luggage_count;
+        }
+
+        if (!ticket_section.verify(range.first_ticket, range.first_ticket + range.ticket_count)
+            || !luggage_section.verify(range.first_luggage, range.first_luggage + range.luggage_count))
+            throw runtime_error("Snapshot tickets and luggage of the flight are corrupt");
+
+        const Section &airport_section = reader.getSection(SectionTag::AIRPORTS);
+        PlaneRecord plane_record = readRecord<PlaneRecord>(reader.getSection(SectionTag::PLANES), plane);
+
+        FlightManifest manifest;
+        manifest.origin = make_unique<Airport>(reader.getString(readRecord<AirportRecord>(airport_section, flight_record.origin).name));
+        manifest.destination = make_unique<Airport>(reader.getString(readRecord<AirportRecord>(airport_section, flight_record.destination).name));
+        manifest.plane = make_unique<Plane>(reader.getString(plane_record.license_plate), reader.getString(plane_record.type), plane_record.capacity);
+        manifest.flight = make_unique<Flight>(reader.getString(flight_record.flight_id), unpack(flight_record.departure_time), unpack(flight_record.duration),
+                                              *manifest.origin, *manifest.destination, *manifest.plane);
+        manifest.plane->addFlight(*manifest.flight);
+
+        RecordCursor<TicketRecord> tickets(ticket_section, range.first_ticket, range.first_ticket + range.ticket_count);
+        manifest.tickets.reserve(range.ticket_count);
+        for (uint32_t i = 0; i < range.ticket_count; i++) {
+            TicketRecord ticket_record = tickets.next();
+            manifest.tickets.push_back(make_unique<Ticket>(*manifest.flight, reader.getString(ticket_record.customer_name),
+                                                           ticket_record.customer_age, ticket_record.seat_number));
+            manifest.flight->addTicket(*manifest.tickets.back());
+        }
+
+        RecordCursor<LuggageRecord> luggage(luggage_section, range.first_luggage, range.first_luggage + range.luggage_count);
+        manifest.luggage.reserve(range.luggage_count);
+        for (uint32_t i = 0; i < range.luggage_count; i++) {
+            LuggageRecord luggage_record = luggage.next();
+            if (luggage_record.ticket >= manifest.tickets.size())
+                throw runtime_error("Snapshot luggage refers to an unknown ticket");
+
+            manifest.luggage.push_back(make_unique<Luggage>(*manifest.tickets[luggage_record.ticket], luggage_record.weight));
+            manifest.flight->addLuggage(*manifest.luggage.back());
+        }
+
+        return manifest;
+    }
+
+    optional<FlightManifest> findFlight(const string &path, const string &flight_id, const Datetime &departure_time) {
+        MappedFile file(path, false);
+        SnapshotReader reader(file);
+
+        const Section &index_section = reader.getSection(SectionTag::FLIGHT_INDEX);
+        const Section &flight_section = reader.getSection(SectionTag::FLIGHTS);
+        if (index_section.records == nullptr)
+            throw runtime_error("Snapshot has no flight index");
+
+        if (index_section.record_count == 0)
+            return nullopt;
+
+        IndexEntry key = makeIndexEntry(flight_id, departure_time, 0, 0);
+        auto isBefore = [](const IndexEntry &entry, const IndexEntry &key) {
+            return compareKeys(entry, key) < 0;
+        };
+
+        auto readNode = [&index_section](uint64_t position) {
+            IndexNode node = readRecord<IndexNode>(index_section, position);
+            if (node.entry_count == 0 || node.entry_count > size(node.entries))
+                throw runtime_error("Snapshot flight index is malformed");
+
+            return node;
+        };
+
+        // The first match is in the last child whose smallest key comes before the key, or at the start of the child after it
+        uint64_t position = index_section.record_count - 1;
+        IndexNode node = readNode(position);
+        while (node.level > 0) {
+            const IndexEntry *child = partition_point(node.entries + 1, node.entries + node.entry_count, [&key, &isBefore](const IndexEntry &entry) {
+                return isBefore(entry, key);
+            }) - 1;
+
+            // Children always come before their parents, which also rules out cycles
+            if (child->target >= position)
+                throw runtime_error("Snapshot flight index is malformed");
+
+            position = child->target;
+            node = readNode(position);
+        }
+
+        // Flights whose keys match may run into the following leaves, and only differ in the rest of their ids
+        uint32_t i = lower_bound(node.entries, node.entries + node.entry_count, key, isBefore) - node.entries;
+        while (true) {
+            if (i == node.entry_count) {
+                if (++position == index_section.record_count)
+                    break;
+
+                node = readNode(position);
+                if (node.level > 0)
+                    break;
+
+                i = 0;
+            }
+
+            const IndexEntry &entry = node.entries[i++];
+            if (compareKeys(entry, key) != 0)
+                break;
+
+            FlightRecord flight_record = readRecord<FlightRecord>(flight_section, entry.target);
+            if (reader.getString(flight_record.flight_id) == flight_id)
+                return readManifest(reader, flight_record, entry.target, entry.plane);
+        }
+
+        return nullopt;
+    }
+
+    /*----------WRITING----------*/
+
+    /**
+     * @brief Subtracts from every byte the byte `stride` bytes before it, which undoDelta reverses
+     * @param stride The distance, or 0 to copy the bytes as they are
+     */
+    void applyDelta(const char *source, char *destination, size_t size, size_t stride) {
+        size_t i = stride == 0 ? size : min(stride, size);
+        memcpy(destination, source, i);
+
+        for (; i < size; i++)
+            destination[i] = static_cast<char>(source[i] - source[i - stride]);
+    }
+
+    /**
+     * @brief Returns the distance of the delta filter for a section: a record, so that alike records leave mostly zeros behind.
+     * Strings aren't made of records, and index nodes are made of entries that are alike.
+     */
+    uint32_t getDeltaStride(const SectionHeader &header) {
+        if (header.tag == SectionTag::FLIGHT_INDEX)
+            return sizeof(IndexEntry);
+
+        return header.record_size > 1 ? header.record_size : 0;
+    }
+
+    class SectionBuffer {
+        SectionTag tag;
+        uint32_t record_size;
+        uint64_t record_count = 0;
+        string bytes;
+
+    public:
+        SectionBuffer(SectionTag tag, uint32_t record_size) : tag(tag), record_size(record_size) {}
+
+        template <typename T>
+        void add(const T &record) {
+            this->bytes.append(reinterpret_cast<const char*>(&record), sizeof(T));
+            this->record_count++;
+        }
+
+        void reserve(uint64_t record_count) {
+            this->bytes.reserve(record_count * this->record_size);
+        }
+
+        /**
+         * @brief Appends raw bytes to a section whose records are single bytes
+         */
+        void addBytes(string_view value) {
+            this->bytes.append(value);
+            this->record_count += value.size();
+        }
+
+        SectionTag getTag() const {
+            return this->tag;
+        }
+
+        uint32_t getRecordSize() const {
+            return this->record_size;
+        }
+
+        uint64_t getRecordCount() const {
+            return this->record_count;
+        }
+
+        const string &getBytes() const {
+            return this->bytes;
+        }
+
+        /**
+         * @brief Calls change(record) for every record, keeping what it changes
+         */
+        template <typename T, typename F>
+        void update(F change) {
+            for (size_t offset = 0; offset < this->bytes.size(); offset += sizeof(T)) {
+                T record;
+                memcpy(&record, this->bytes.data() + offset, sizeof(T));
+                change(record);
+                memcpy(this->bytes.data() + offset, &record, sizeof(T));
+            }
+        }
+    };
+
+    /**
+     * @brief Adds strings to a STRINGS buffer, storing each distinct string once
+     */
+    class StringTable {
+        SectionBuffer &section;
+        /** Views of the strings that were added, which belong to the data or to a mapped snapshot and outlive the table */
+        unordered_map<string_view, StringRef> known;
+
+    public:
+        explicit StringTable(SectionBuffer &section) : section(section) {}
+
+        StringRef add(string_view value) {
+            if (value.size() > UINT32_MAX)
+                throw runtime_error("A string is too long to be saved in a snapshot");
+
+            auto [it, is_new] = this->known.try_emplace(value);
+            if (is_new) {
+                it->second = StringRef { static_cast<uint32_t>(section.getRecordCount()), static_cast<uint32_t>(value.size()) };
+                section.addBytes(value);
+            }
+
+            return it->second;
+        }
+    };
+
+    /**
+     * @brief The records of every section that belong to one plane, rendered independently of the other planes
+     */
+    struct PlaneChunk {
+        SectionBuffer strings { SectionTag::STRINGS, sizeof(char) };
+        SectionBuffer passenger_strings { SectionTag::STRINGS, sizeof(char) };
+        SectionBuffer planes { SectionTag::PLANES, sizeof(PlaneRecord) };
+        SectionBuffer plane_blocks { SectionTag::PLANE_BLOCKS, sizeof(PlaneBlockRecord) };
+        SectionBuffer services { SectionTag::SERVICES, sizeof(ServiceRecord) };
+        SectionBuffer flights { SectionTag::FLIGHTS, sizeof(FlightRecord) };
+        SectionBuffer tickets { SectionTag::TICKETS, sizeof(TicketRecord) };
+        SectionBuffer luggage { SectionTag::LUGGAGE, sizeof(LuggageRecord) };
+    };
+
+    /**
+     * @brief Reads the records of a flight's tickets and luggage, and views the names of its passengers,
+     * straight from the snapshot they weren't loaded from yet, so that saving doesn't have to create them
+     * @return false, if they weren't loaded from a snapshot or some of them are corrupt, in which case they have to be loaded to be saved
+     */
+    bool readStoredPassengers(const Flight &flight, vector<pair<TicketRecord, string_view>> &tickets, vector<LuggageRecord> &luggage) {
+        tickets.clear();
+        luggage.clear();
+
+        auto passengers = dynamic_cast<const SnapshotPassengers*>(flight.getPassengerLoader());
+        if (passengers == nullptr)
+            return false;
+
+        const SnapshotReader &reader = passengers->getReader();
+        const Section &ticket_section = reader.getSection(SectionTag::TICKETS);
+        const Section &luggage_section = reader.getSection(SectionTag::LUGGAGE);
+        const PassengerRange &range = flight.getPassengerRange();
+
+        if (!ticket_section.verify(range.first_ticket, range.first_ticket + range.ticket_count)
+            || !luggage_section.verify(range.first_luggage, range.first_luggage + range.luggage_count))
+            return false;
+
+        tickets.reserve(range.ticket_count);
+        RecordCursor<TicketRecord> ticket_cursor(ticket_section, range.first_ticket, range.first_ticket + range.ticket_count);
+        try {
+            for (uint32_t i = 0; i < range.ticket_count; i++) {
+                TicketRecord record = ticket_cursor.next();
+                tickets.emplace_back(record, reader.viewString(record.customer_name));
+            }
+        } catch (corrupt_data_error &error) {
+            return false;
+        }
+
+        luggage.reserve(range.luggage_count);
+        RecordCursor<LuggageRecord> luggage_cursor(luggage_section, range.first_luggage, range.first_luggage + range.luggage_count);
+        for (uint32_t i = 0; i < range.luggage_count; i++) {
+            luggage.push_back(luggage_cursor.next());
+            if (luggage.back().ticket >= range.ticket_count)
+                return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief Counts the records a plane adds to each section, loading the passengers that can't be copied from their snapshot
+     */
+    PlaneBlockRecord measurePlane(const Plane &plane) {
+        PlaneBlockRecord records = { plane.getFinishedServices().size() + plane.getScheduledServices().size(), plane.getFlights().size(), 0, 0 };
+
+        vector<pair<TicketRecord, string_view>> stored_tickets;
+        vector<LuggageRecord> stored_luggage;
+
+        for (const Flight *flight : plane.getFlights()) {
+            // Passengers that can't be copied from their snapshot are loaded now, since loading leaves out the corrupt ones
+            if (!flight->hasPassengersLoaded() && !readStoredPassengers(*flight, stored_tickets, stored_luggage))
+                flight->getTickets();
+
+            records.ticket += flight->getTicketCount();
+            records.luggage += flight->getLuggageCount();
+        }
+
+        return records;
+    }
+
+    /**
+     * @brief Renders a plane's records, given where they start in each section.
+     * Its strings, and its passengers' strings, are each referred to as if they started the STRINGS section, until relocateStrings.
+     */
+    void renderPlane(const Plane &plane, const PlaneBlockRecord &block, const OrdinalTable &ordinals, PlaneChunk &chunk) {
+        StringTable string_table(chunk.strings);
+        StringTable passenger_string_table(chunk.passenger_strings);
+
+        const vector<Service*> &finished_services = plane.getFinishedServices();
+        queue<Service*> scheduled_services = plane.getScheduledServices();
+        const list<Flight*> &plane_flights = plane.getFlights();
+        vector<pair<TicketRecord, string_view>> stored_tickets;
+        vector<LuggageRecord> stored_luggage;
+
+        chunk.plane_blocks.add(block);
+        chunk.planes.add(PlaneRecord {
+            string_table.add(plane.getLicensePlate()),
+            string_table.add(plane.getType()),
+            plane.getCapacity(),
+            static_cast<uint32_t>(finished_services.size()),
+            static_cast<uint32_t>(scheduled_services.size()),
+            static_cast<uint32_t>(plane_flights.size())
+        });
+
+        auto addService = [&chunk, &string_table](const Service *service) {
+            chunk.services.add(ServiceRecord { string_table.add(service->getWorker()), pack(service->getDatetime()), static_cast<uint32_t>(service->getType()) });
+        };
+
+        for (const Service *service : finished_services)
+            addService(service);
+
+        for (; !scheduled_services.empty(); scheduled_services.pop())
+            addService(scheduled_services.front());
+
+        for (const Flight *flight : plane_flights) {
+            FlightRecord record = {};
+            record.flight_id = string_table.add(flight->getFlightId());
+            record.departure_time = pack(flight->getDepartureTime());
+            record.duration = pack(flight->getDuration());
+            record.origin = ordinals.getAirport(flight->getOrigin());
+            record.destination = ordinals.getAirport(flight->getDestination());
+            record.ticket_count = flight->getTicketCount();
+            record.luggage_count = flight->getLuggageCount();
+            chunk.flights.add(record);
+
+            // measurePlane already loaded the passengers that can't be copied
+            if (!flight->hasPassengersLoaded() && readStoredPassengers(*flight, stored_tickets, stored_luggage)) {
+                for (auto &[ticket_record, name] : stored_tickets) {
+                    ticket_record.customer_name = passenger_string_table.add(name);
+                    chunk.tickets.add(ticket_record);
+                }
+
+                for (const LuggageRecord &luggage_record : stored_luggage)
+                    chunk.luggage.add(luggage_record);
+
+                continue;
+            }
+
+            const vector<Ticket*> &flight_tickets = flight->getTickets();
+            const vector<Luggage*> &flight_luggage = flight->getLuggage();
+
+            for (const Ticket *ticket : flight_tickets)
+                chunk.tickets.add(TicketRecord { passenger_string_table.add(ticket->getCustomerName()), ticket->getCustomerAge(), ticket->getSeatNumber() });
+
+            for (Luggage *bag : flight_luggage)
+                chunk.luggage.add(LuggageRecord { ordinals.getTicket(*flight, bag->getTicket()), bag->getWeight() });
+        }
+    }
+
+    /**
+     * @brief Moves the string references of a plane's records to where its strings and its passengers' strings really start
+     */
+    void relocateStrings(PlaneChunk &chunk, uint32_t string_base, uint32_t passenger_string_base) {
+        chunk.planes.update<PlaneRecord>([string_base](PlaneRecord &record) {
+            record.license_plate.offset += string_base;
+            record.type.offset += string_base;
+        });
+
+        chunk.services.update<ServiceRecord>([string_base](ServiceRecord &record) {
+            record.worker.offset += string_base;
+        });
+
+        chunk.flights.update<FlightRecord>([string_base](FlightRecord &record) {
+            record.flight_id.offset += string_base;
+        });
+
+        chunk.tickets.update<TicketRecord>([passenger_string_base](TicketRecord &record) {
+            record.customer_name.offset += passenger_string_base;
+        });
+    }
+
+    /**
+     * @brief Lays out a snapshot whose sections are made of several buffers, and writes it with as few system calls as possible
+     */
+    class SnapshotFile {
+        Header header = {};
+        deque<SectionHeader> section_headers;
+        deque<SectionEncoding> section_encodings;
+        /** The table of chunks of every compressed section, followed by its stored chunks */
+        deque<vector<string>> stored_chunks;
+        /** Everything that is checksummed along with the headers, after the header itself and in file order */
+        vector<pair<const void*, size_t>> header_parts;
+        vector<iovec> parts;
+
+        /** The checksum of the headers, which is only known at the end, followed by the checksum of every chunk */
+        string checksums = string(sizeof(uint32_t), '\0');
+
+        void addPart(const void *data, size_t size) {
+            if (size != 0)
+                this->parts.push_back(iovec { const_cast<void*>(data), size });
+
+            this->header.file_size += size;
+        }
+
+        void addHeaderPart(const void *data, size_t size) {
+            this->header_parts.emplace_back(data, size);
+            this->addPart(data, size);
+        }
+
+        void addPadding(size_t size) {
+            static const char padding[ALIGNMENT] = {};
+            this->addPart(padding, alignUp(size) - size);
+        }
+
+        void addChecksum(uint32_t checksum) {
+            this->checksums.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        }
+
+        /**
+         * @brief Adds the records of a section as they are
+         */
+        void addRaw(const vector<const SectionBuffer*> &buffers) {
+            // Chunks run across the buffers, as if the section had been rendered in one piece
+            size_t size = 0;
+            uint32_t chunk_checksum = 0;
+            for (const SectionBuffer *buffer : buffers) {
+                const string &bytes = buffer->getBytes();
+                this->addPart(bytes.data(), bytes.size());
+
+                for (size_t offset = 0; offset < bytes.size();) {
+                    size_t length = min(bytes.size() - offset, CHECKSUM_CHUNK_SIZE - size % CHECKSUM_CHUNK_SIZE);
+                    chunk_checksum = crc32c::extend(chunk_checksum, bytes.data() + offset, length);
+                    offset += length;
+                    size += length;
+
+                    if (size % CHECKSUM_CHUNK_SIZE == 0) {
+                        this->addChecksum(chunk_checksum);
+                        chunk_checksum = 0;
+                    }
+                }
+            }
+
+            if (size % CHECKSUM_CHUNK_SIZE != 0)
+                this->addChecksum(chunk_checksum);
+        }
+
+        /**
+         * @brief Compresses the records of a section, a chunk at a time on several threads
+         * @param size The size of the records
+         *
+         * @return false, having added nothing, if compressing saves too little to be worth decompressing,
+         * or stores more than the 32-bit offsets of its table of chunks reach
+         */
+        bool addCompressed(const vector<const SectionBuffer*> &buffers, size_t size, uint32_t delta_stride, SectionEncoding &encoding) {
+            if (size == 0)
+                return false;
+
+            size_t chunk_count = (size + CHECKSUM_CHUNK_SIZE - 1) / CHECKSUM_CHUNK_SIZE;
+
+            // Where each buffer starts within the section
+            vector<size_t> starts;
+            starts.reserve(buffers.size());
+            for (size_t start = 0; const SectionBuffer *buffer : buffers) {
+                starts.push_back(start);
+                start += buffer->getBytes().size();
+            }
+
+            // The table of chunks comes first
+            vector<string> chunks(chunk_count + 1);
+            parallel::forEach(chunk_count, [&](size_t chunk) {
+                size_t offset = chunk * CHECKSUM_CHUNK_SIZE;
+                size_t length = min(CHECKSUM_CHUNK_SIZE, size - offset);
+
+                string records(length, '\0');
+                size_t buffer = upper_bound(starts.begin(), starts.end(), offset) - starts.begin() - 1;
+                for (size_t copied = 0; copied < length; buffer++) {
+                    const string &bytes = buffers[buffer]->getBytes();
+                    size_t first = offset + copied - starts[buffer];
+                    size_t count = min(bytes.size() - first, length - copied);
+
+                    memcpy(records.data() + copied, bytes.data() + first, count);
+                    copied += count;
+                }
+
+                string filtered(length, '\0');
+                applyDelta(records.data(), filtered.data(), length, delta_stride);
+
+                // A chunk that doesn't get smaller is stored as it is
+                string &stored = chunks[chunk + 1];
+                stored.resize(length);
+                size_t compressed_size = lz4::compress(filtered.data(), length, stored.data(), length - 1);
+                if (compressed_size == 0)
+                    stored = move(records);
+                else
+                    stored.resize(compressed_size);
+            });
+
+            // The table holds 32-bit offsets, so a section that would store more than they reach is left uncompressed
+            string &table = chunks.front();
+            uint64_t chunk_end = 0;
+            for (size_t chunk = 1; chunk < chunks.size(); chunk++) {
+                chunk_end += chunks[chunk].size();
+                if (chunk_end > UINT32_MAX)
+                    return false;
+
+                uint32_t stored_end = static_cast<uint32_t>(chunk_end);
+                table.append(reinterpret_cast<const char*>(&stored_end), sizeof(stored_end));
+            }
+
+            size_t stored_size = table.size() + chunk_end;
+            if (stored_size > size - size / 8)
+                return false;
+
+            encoding = SectionEncoding { Encoding::LZ4, delta_stride, stored_size };
+
+            const vector<string> &kept = this->stored_chunks.emplace_back(move(chunks));
+            this->addHeaderPart(kept.front().data(), kept.front().size());
+            for (size_t chunk = 1; chunk < kept.size(); chunk++) {
+                this->addPart(kept[chunk].data(), kept[chunk].size());
+                this->addChecksum(crc32c::compute(kept[chunk].data(), kept[chunk].size()));
+            }
+
+            return true;
+        }
+
+    public:
+        explicit SnapshotFile(uint64_t journal_generation) {
+            memcpy(this->header.magic, MAGIC, sizeof(MAGIC));
+            this->header.version = VERSION;
+            this->header.journal_generation = journal_generation;
+            this->addPart(&this->header, sizeof(this->header));
+        }
+
+        /**
+         * @brief Adds a section made of the concatenation of the given buffers, which must all share its tag.
+         * The section is compressed unless that saves too little.
+         */
+        void addSection(const vector<const SectionBuffer*> &buffers) {
+            SectionHeader &section_header = this->section_headers.emplace_back();
+            section_header.tag = buffers.front()->getTag();
+            section_header.record_size = buffers.front()->getRecordSize();
+            section_header.record_count = 0;
+
+            size_t size = 0;
+            for (const SectionBuffer *buffer : buffers) {
+                section_header.record_count += buffer->getRecordCount();
+                size += buffer->getBytes().size();
+            }
+
+            this->addHeaderPart(&section_header, sizeof(section_header));
+
+            SectionEncoding &encoding = this->section_encodings.emplace_back(SectionEncoding { Encoding::RAW, 0, size });
+            this->addHeaderPart(&encoding, sizeof(encoding));
+
+            if (!this->addCompressed(buffers, size, getDeltaStride(section_header), encoding))
+                this->addRaw(buffers);
+
+            this->addPadding(encoding.stored_size);
+            this->header.section_count++;
+        }
+
+        /**
+         * @brief Adds the CHECKSUMS section. No section can be added after it.
+         */
+        void finish() {
+            SectionHeader &section_header = this->section_headers.emplace_back();
+            section_header.tag = SectionTag::CHECKSUMS;
+            section_header.record_size = sizeof(uint32_t);
+            section_header.record_count = this->checksums.size() / sizeof(uint32_t);
+            this->addHeaderPart(&section_header, sizeof(section_header));
+
+            SectionEncoding &encoding = this->section_encodings.emplace_back(SectionEncoding { Encoding::RAW, 0, this->checksums.size() });
+            this->addHeaderPart(&encoding, sizeof(encoding));
+
+            this->addPart(this->checksums.data(), this->checksums.size());
+            this->addPadding(this->checksums.size());
+            this->header.section_count++;
+
+            uint32_t header_checksum = crc32c::compute(&this->header, sizeof(this->header));
+            for (const auto &[data, size] : this->header_parts)
+                header_checksum = crc32c::extend(header_checksum, data, size);
+
+            header_checksum = crc32c::extend(header_checksum, this->checksums.data() + sizeof(uint32_t), this->checksums.size() - sizeof(uint32_t));
+            memcpy(this->checksums.data(), &header_checksum, sizeof(header_checksum));
+        }
+
+        void writeTo(const string &path) const {
+            int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (file < 0)
+                throw runtime_error("Could not open file");
+
+            size_t first = 0;
+            size_t offset = 0;
+            while (first < this->parts.size()) {
+                // writev takes at most IOV_MAX parts at a time, and may write fewer bytes than asked
+                vector<iovec> batch(this->parts.begin() + first, this->parts.begin() + min(this->parts.size(), first + IOV_MAX));
+                batch.front().iov_base = static_cast<char*>(batch.front().iov_base) + offset;
+                batch.front().iov_len -= offset;
+
+                ssize_t written = writev(file, batch.data(), batch.size());
+                if (written <= 0) {
+                    close(file);
+                    throw runtime_error("Could not write snapshot");
+                }
+
+                for (size_t remaining = written; remaining > 0;) {
+                    size_t left_in_part = this->parts[first].iov_len - offset;
+                    if (remaining < left_in_part) {
+                        offset += remaining;
+                        break;
+                    }
+
+                    remaining -= left_in_part;
+                    offset = 0;
+                    first++;
+                }
+            }
+
+            // The snapshot must be on the disk before it replaces the old one, since the journals it holds are deleted next
+            bool flushed = fdatasync(file) == 0;
+            if (close(file) != 0 || !flushed)
+                throw runtime_error("Could not write snapshot");
+        }
+    };
+
+    /**
+     * @brief Builds the flight index from its leaf entries, sorted by key, one level at a time from the leaves up
+     */
+    void buildFlightIndex(vector<IndexEntry> entries, SectionBuffer &section) {
+        constexpr size_t CAPACITY = size(IndexNode().entries);
+
+        // The inner levels together have far fewer nodes than the leaves
+        section.reserve((entries.size() + CAPACITY - 1) / CAPACITY * 2 + 1);
+
+        for (uint32_t level = 0; !entries.empty(); level++) {
+            vector<IndexEntry> parents;
+            parents.reserve((entries.size() + CAPACITY - 1) / CAPACITY);
+
+            for (size_t first = 0; first < entries.size(); first += CAPACITY) {
+                IndexNode node = {};
+                node.level = level;
+                node.entry_count = min(CAPACITY, entries.size() - first);
+                copy_n(entries.begin() + first, node.entry_count, node.entries);
+
+                IndexEntry parent = entries[first];
+                parent.target = section.getRecordCount();
+                parent.plane = 0;
+                parents.push_back(parent);
+
+                section.add(node);
+            }
+
+            // The root is the only node of the last level
+            if (parents.size() == 1)
+                break;
+
+            entries = move(parents);
+        }
+    }
+
+    void write(const string &path, uint64_t journal_generation) {
+        SectionBuffer strings(SectionTag::STRINGS, sizeof(char));
+        SectionBuffer airports(SectionTag::AIRPORTS, sizeof(AirportRecord));
+        SectionBuffer places(SectionTag::TRANSPORT_PLACES, sizeof(TransportPlaceRecord));
+        SectionBuffer schedules(SectionTag::SCHEDULES, sizeof(PackedTime));
+        SectionBuffer cars(SectionTag::HANDLING_CARS, sizeof(HandlingCarRecord));
+        SectionBuffer car_luggage(SectionTag::CAR_LUGGAGE, sizeof(LuggageRecord));
+
+        StringTable string_table(strings);
+        OrdinalTable ordinals;
+
+        for (const Airport *airport : data::airports) {
+            const set<TransportPlace> &transport_places = airport->getTransportPlaceInfo();
+            airports.add(AirportRecord { string_table.add(airport->getName()), static_cast<uint32_t>(transport_places.size()) });
+
+            for (const TransportPlace &place : transport_places) {
+                places.add(TransportPlaceRecord {
+                    string_table.add(place.name),
+                    place.latitude, place.longitude, place.airport_distance,
+                    static_cast<uint32_t>(place.transport_type),
+                    static_cast<uint32_t>(place.schedule.size())
+                });
+
+                for (const Time &time : place.schedule)
+                    schedules.add(pack(time));
+            }
+        }
+
+        // Planes are rendered on several threads. Counting their records first tells each one where its records start,
+        // so the result is the same as rendering them one after the other. Where their strings start is only known once
+        // every plane has stored its distinct strings, so their references are moved afterwards.
+        size_t plane_count = data::planes.size();
+        vector<PlaneBlockRecord> blocks(plane_count);
+
+        parallel::forEach(plane_count, [&](size_t i) {
+            blocks[i] = measurePlane(*data::planes[i]);
+        });
+
+        PlaneBlockRecord next_block = {};
+        for (size_t i = 0; i < plane_count; i++) {
+            PlaneBlockRecord records = blocks[i];
+            blocks[i] = next_block;
+
+            next_block.service += records.service;
+            next_block.flight += records.flight;
+            next_block.ticket += records.ticket;
+            next_block.luggage += records.luggage;
+        }
+
+        vector<PlaneChunk> chunks(plane_count);
+        vector<IndexEntry> index_entries(next_block.flight);
+        parallel::forEach(plane_count, [&](size_t i) {
+            renderPlane(*data::planes[i], blocks[i], ordinals, chunks[i]);
+
+            uint32_t flight = blocks[i].flight;
+            for (const Flight *plane_flight : data::planes[i]->getFlights()) {
+                index_entries[flight] = makeIndexEntry(plane_flight->getFlightId(), plane_flight->getDepartureTime(), flight, i);
+                flight++;
+            }
+        });
+
+        // The strings of tickets come after every other string
+        vector<uint32_t> string_bases(plane_count);
+        vector<uint32_t> passenger_string_bases(plane_count);
+
+        uint64_t next_string = strings.getRecordCount();
+        for (size_t i = 0; i < plane_count; i++) {
+            string_bases[i] = next_string;
+            next_string += chunks[i].strings.getRecordCount();
+        }
+
+        for (size_t i = 0; i < plane_count; i++) {
+            passenger_string_bases[i] = next_string;
+            next_string += chunks[i].passenger_strings.getRecordCount();
+        }
+
+        // String references hold 32-bit offsets, which every offset fits in as long as the last string ends within them
+        if (next_string > UINT32_MAX)
+            throw runtime_error("The strings are too large to be saved in a snapshot");
+
+        parallel::forEach(plane_count, [&](size_t i) {
+            relocateStrings(chunks[i], string_bases[i], passenger_string_bases[i]);
+        });
+
+        for (const HandlingCar *car : data::handlingCars) {
+            HandlingCarRecord record = { car->getNumberOfCarriages(), car->getStacksPerCarriage(), car->getLuggagePerStack(), NONE, 0 };
+
+            const Flight *flight = car->getFlight();
+            if (flight == nullptr) {
+                cars.add(record);
+                continue;
+            }
+
+            record.flight = ordinals.getFlight(*flight);
+            for (const Carriage &carriage : car->getCarriages()) {
+                for (const LuggageStack &stack : carriage)
+                    record.luggage_count += stack.size();
+            }
+
+            cars.add(record);
+
+            // Carriages and stacks are stored in the order they must be loaded back into the car
+            for (const Carriage &carriage : car->getCarriages()) {
+                for (const LuggageStack &stack : carriage) {
+                    for (Luggage *bag : stack)
+                        car_luggage.add(LuggageRecord { ordinals.getTicket(*flight, bag->getTicket()), bag->getWeight() });
+                }
+            }
+        }
+
+        SectionBuffer flight_order(SectionTag::FLIGHT_ORDER, sizeof(uint32_t));
+        vector<uint32_t> flight_ordinals(data::flights.size());
+        parallel::forEach(data::flights.size(), [&](size_t i) {
+            flight_ordinals[i] = ordinals.getFlight(*data::flights[i]);
+        });
+
+        // Flights are kept sorted by id, so usually only the ones that share the start of their ids have to be sorted by departure
+        auto isBefore = [](const IndexEntry &a, const IndexEntry &b) {
+            return compareKeys(a, b) < 0;
+        };
+
+        vector<IndexEntry> index_keys;
+        index_keys.reserve(flight_ordinals.size());
+        flight_order.reserve(flight_ordinals.size());
+        for (uint32_t ordinal : flight_ordinals) {
+            flight_order.add(ordinal);
+            index_keys.push_back(index_entries[ordinal]);
+        }
+
+        for (auto first = index_keys.begin(); first != index_keys.end();) {
+            auto last = find_if(first, index_keys.end(), [&first](const IndexEntry &entry) {
+                return memcmp(entry.flight_id, first->flight_id, INDEX_KEY_LENGTH) != 0;
+            });
+
+            sort(first, last, isBefore);
+            first = last;
+        }
+
+        if (!is_sorted(index_keys.begin(), index_keys.end(), isBefore))
+            sort(index_keys.begin(), index_keys.end(), isBefore);
+
+        SectionBuffer flight_index(SectionTag::FLIGHT_INDEX, sizeof(IndexNode));
+        buildFlightIndex(move(index_keys), flight_index);
+
+        auto gather = [&chunks](SectionBuffer PlaneChunk::*member, const SectionBuffer *first) {
+            vector<const SectionBuffer*> buffers;
+            buffers.reserve(chunks.size() + 1);
+            buffers.push_back(first);
+
+            for (const PlaneChunk &chunk : chunks)
+                buffers.push_back(&(chunk.*member));
+
+            return buffers;
+        };
+
+        // Empty buffers that give the plane sections their tag even when there are no planes
+        PlaneChunk empty;
+
+        vector<const SectionBuffer*> all_strings = gather(&PlaneChunk::strings, &strings);
+        for (const PlaneChunk &chunk : chunks)
+            all_strings.push_back(&chunk.passenger_strings);
+
+        SnapshotFile file(journal_generation);
+        file.addSection(all_strings);
+        file.addSection({ &airports });
+        file.addSection({ &places });
+        file.addSection({ &schedules });
+        file.addSection(gather(&PlaneChunk::planes, &empty.planes));
+        file.addSection(gather(&PlaneChunk::plane_blocks, &empty.plane_blocks));
+        file.addSection(gather(&PlaneChunk::services, &empty.services));
+        file.addSection(gather(&PlaneChunk::flights, &empty.flights));
+        file.addSection(gather(&PlaneChunk::tickets, &empty.tickets));
+        file.addSection(gather(&PlaneChunk::luggage, &empty.luggage));
+        file.addSection({ &cars });
+        file.addSection({ &car_luggage });
+        file.addSection({ &flight_order });
+        file.addSection({ &flight_index });
+        file.finish();
+
+        string temporary_path = path + ".tmp";
+        file.writeTo(temporary_path);
+
+        if (rename(temporary_path.c_str(), path.c_str()) != 0)
+            throw runtime_error("Could not replace the old snapshot");
+
+        // The journals the snapshot replaces are deleted next, so the rename has to reach the disk first
+        files::syncDirectory(path);
+    }
+
+    /*----------COMPARING----------*/
+
+    /** How many changes a comparison describes in Difference::examples */
+    constexpr size_t MAX_EXAMPLES = 20;
+
+    /** How many flights are compared at a time, so that only their part of the patch is held in memory */
+    constexpr size_t COMPARED_FLIGHT_BATCH = 4096;
+
+    /**
+     * @brief Mixes values into a 64-bit hash, one at a time, so that the same values in another order give another hash
+     */
+    class Hasher {
+        uint64_t value = 0;
+
+    public:
+        Hasher &add(uint64_t next) {
+            // The finalizer of SplitMix64, which spreads every bit of its input over the whole hash
+            uint64_t x = (this->value ^ next) + 0x9E3779B97F4A7C15;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EB;
+            this->value = x ^ (x >> 31);
+            return *this;
+        }
+
+        Hasher &addString(string_view text) {
+            return this->add(hash<string_view>()(text));
+        }
+
+        Hasher &addFloat(float number) {
+            uint32_t bits;
+            memcpy(&bits, &number, sizeof(bits));
+            return this->add(bits);
+        }
+
+        Hasher &addDatetime(const PackedDatetime &datetime) {
+            return this->add(static_cast<uint64_t>(datetime.year) << 32 | datetime.month << 24 | datetime.day << 16 | datetime.hour << 8 | datetime.minute);
+        }
+
+        Hasher &addTime(const PackedTime &time) {
+            return this->add(time.hour << 8 | time.minute);
+        }
+
+        uint64_t get() const {
+            return this->value;
+        }
+    };
+
+    /**
+     * @brief Finds the entities of a snapshot by the hashes of their keys, with open addressing.
+     * Entities whose keys only share their hash are told apart by comparing the keys themselves.
+     */
+    class KeyTable {
+        const vector<uint64_t> &keys;
+        vector<uint32_t> slots;
+        size_t mask;
+
+    public:
+        /**
+         * @param keys The hash of the key of every entity
+         * @param is_same Tells whether two entities, whose keys share their hash, have the same key
+         *
+         * @throws std::runtime_error if two entities have the same key
+         */
+        template <typename Compare>
+        KeyTable(const vector<uint64_t> &keys, const Compare &is_same) : keys(keys) {
+            size_t size = bit_ceil(max<size_t>(keys.size() * 2, 16));
+            this->slots.assign(size, NONE);
+            this->mask = size - 1;
+
+            for (uint32_t i = 0; i < keys.size(); i++) {
+                size_t slot = keys[i] & this->mask;
+                for (; this->slots[slot] != NONE; slot = (slot + 1) & this->mask) {
+                    if (keys[this->slots[slot]] == keys[i] && is_same(this->slots[slot], i))
+                        throw runtime_error("Snapshot has two entities with the same key");
+                }
+
+                this->slots[slot] = i;
+            }
+        }
+
+        /**
+         * @param key The hash of the key
+         * @param is_match Tells whether an entity whose key has that hash has the key
+         *
+         * @return The entity with the key, or NONE
+         */
+        template <typename Match>
+        uint32_t find(uint64_t key, const Match &is_match) const {
+            for (size_t slot = key & this->mask; this->slots[slot] != NONE; slot = (slot + 1) & this->mask) {
+                if (this->keys[this->slots[slot]] == key && is_match(this->slots[slot]))
+                    return this->slots[slot];
+            }
+
+            return NONE;
+        }
+    };
+
+    /**
+     * @brief One of the snapshots being compared: its records, which are all verified up front, and the keys and hashes of its entities.
+     * Entities are referred to by their position in their sections.
+     */
+    class ComparedSnapshot {
+        MappedFile file;
+        SnapshotReader reader;
+
+        template <typename T>
+        T getRecord(SectionTag tag, uint64_t index) const {
+            return RecordCursor<T>(this->reader.getSection(tag), index, index + 1).next();
+        }
+
+        /**
+         * @brief Fills in where every airport's transport places and every place's schedules start, and hashes the airports
+         */
+        void hashAirports() {
+            uint64_t airport_count = this->getCount(SectionTag::AIRPORTS);
+            uint64_t place_count = this->getCount(SectionTag::TRANSPORT_PLACES);
+
+            this->first_places.assign(1, 0);
+            for (uint64_t i = 0; i < airport_count; i++)
+                this->first_places.push_back(this->first_places.back() + this->getRecord<AirportRecord>(SectionTag::AIRPORTS, i).place_count);
+
+            this->first_schedules.assign(1, 0);
+            for (uint64_t i = 0; i < place_count; i++)
+                this->first_schedules.push_back(this->first_schedules.back() + this->getRecord<TransportPlaceRecord>(SectionTag::TRANSPORT_PLACES, i).schedule_count);
+
+            if (this->first_places.back() != place_count || this->first_schedules.back() != this->getCount(SectionTag::SCHEDULES))
+                throw runtime_error("Snapshot airports don't match their transport places");
+
+            this->airport_keys.resize(airport_count);
+            this->airport_hashes.resize(airport_count);
+
+            parallel::forEach(airport_count, [this](size_t i) {
+                this->airport_keys[i] = Hasher().addString(this->getAirportName(i)).get();
+
+                Hasher hasher;
+                for (uint64_t j = this->first_places[i]; j < this->first_places[i + 1]; j++) {
+                    TransportPlaceRecord place = this->getRecord<TransportPlaceRecord>(SectionTag::TRANSPORT_PLACES, j);
+                    hasher.addString(this->getString(place.name))
+                        .addFloat(place.latitude)
+                        .addFloat(place.longitude)
+                        .addFloat(place.airport_distance)
+                        .add(place.transport_type)
+                        .add(place.schedule_count);
+
+                    for (uint64_t k = this->first_schedules[j]; k < this->first_schedules[j + 1]; k++)
+                        hasher.addTime(this->getRecord<PackedTime>(SectionTag::SCHEDULES, k));
+                }
+
+                this->airport_hashes[i] = hasher.get();
+            });
+        }
+
+        /**
+         * @brief Hashes every plane, its services and its flights, one plane per thread, and finds where every flight's records start
+         */
+        void hashPlanes() {
+            uint64_t plane_count = this->getCount(SectionTag::PLANES);
+            uint64_t flight_count = this->getCount(SectionTag::FLIGHTS);
+            uint64_t airport_count = this->airport_keys.size();
+
+            vector<PlaneBlockRecord> blocks = getPlaneBlocks(this->reader, true, true);
+
+            this->plane_keys.resize(plane_count);
+            this->plane_hashes.resize(plane_count);
+            this->service_hashes.resize(plane_count);
+            this->first_services.resize(plane_count + 1);
+
+            this->flight_planes.assign(flight_count, NONE);
+            this->first_tickets.resize(flight_count + 1);
+            this->first_luggage.resize(flight_count + 1);
+            this->flight_keys.resize(flight_count);
+            this->flight_hashes.resize(flight_count);
+
+            parallel::forEach(plane_count, [&](size_t i) {
+                const PlaneBlockRecord &block = blocks[i];
+                const PlaneBlockRecord &next_block = blocks[i + 1];
+
+                PlaneRecord plane = this->getRecord<PlaneRecord>(SectionTag::PLANES, i);
+                if (next_block.service - block.service != static_cast<uint64_t>(plane.finished_service_count) + plane.scheduled_service_count
+                    || next_block.flight - block.flight != plane.flight_count)
+                    throw runtime_error("Snapshot table of contents doesn't match its sections");
+
+                this->plane_keys[i] = Hasher().addString(this->getString(plane.license_plate)).get();
+                this->plane_hashes[i] = Hasher().addString(this->getString(plane.type)).add(plane.capacity).get();
+                this->first_services[i] = block.service;
+
+                Hasher services;
+                services.add(plane.finished_service_count);
+                for (uint64_t j = block.service; j < next_block.service; j++) {
+                    ServiceRecord service = this->getRecord<ServiceRecord>(SectionTag::SERVICES, j);
+                    services.add(service.type).addDatetime(service.datetime).addString(this->getString(service.worker));
+                }
+
+                this->service_hashes[i] = services.get();
+
+                uint64_t next_ticket = block.ticket, next_luggage = block.luggage;
+                for (uint64_t j = block.flight; j < next_block.flight; j++) {
+                    FlightRecord flight = this->getFlight(j);
+                    if (flight.origin >= airport_count || flight.destination >= airport_count)
+                        throw runtime_error("Unknown origin or destination airports");
+
+                    this->flight_planes[j] = i;
+                    this->first_tickets[j] = next_ticket;
+                    this->first_luggage[j] = next_luggage;
+                    next_ticket += flight.ticket_count;
+                    next_luggage += flight.luggage_count;
+
+                    // The plane is left out, since it is compared on its own
+                    this->flight_keys[j] = Hasher().addString(this->getString(flight.flight_id)).addDatetime(flight.departure_time).get();
+                    this->flight_hashes[j] = Hasher()
+                        .addTime(flight.duration)
+                        .add(this->airport_keys[flight.origin])
+                        .add(this->airport_keys[flight.destination])
+                        .get();
+                }
+
+                if (next_ticket != next_block.ticket || next_luggage != next_block.luggage)
+                    throw runtime_error("Snapshot table of contents doesn't match its sections");
+            });
+
+            if (find(this->flight_planes.begin(), this->flight_planes.end(), NONE) != this->flight_planes.end())
+                throw runtime_error("Snapshot table of contents doesn't match its sections");
+
+            this->first_services[plane_count] = blocks.back().service;
+            this->first_tickets[flight_count] = blocks.back().ticket;
+            this->first_luggage[flight_count] = blocks.back().luggage;
+        }
+
+        void hashHandlingCars() {
+            uint64_t car_count = this->getCount(SectionTag::HANDLING_CARS);
+
+            this->first_car_luggage.assign(1, 0);
+            for (uint64_t i = 0; i < car_count; i++)
+                this->first_car_luggage.push_back(this->first_car_luggage.back() + this->getCar(i).luggage_count);
+
+            if (this->first_car_luggage.back() != this->getCount(SectionTag::CAR_LUGGAGE))
+                throw runtime_error("Snapshot handling cars don't match their luggage");
+
+            this->car_hashes.resize(car_count);
+            parallel::forEach(car_count, [this](size_t i) {
+                HandlingCarRecord car = this->getCar(i);
+
+                Hasher hasher;
+                hasher.add(car.number_of_carriages).add(car.stacks_per_carriage).add(car.luggage_per_stack);
+
+                if (car.flight != NONE) {
+                    if (car.flight >= this->flight_keys.size())
+                        throw runtime_error("Handling car refers to an unknown flight");
+
+                    hasher.add(this->flight_keys[car.flight]);
+                }
+
+                for (const journal::LuggageEntry &bag : this->getCarLuggage(i))
+                    hasher.add(bag.seat_number).addFloat(bag.weight);
+
+                this->car_hashes[i] = hasher.get();
+            });
+        }
+
+    public:
+        /** Where the transport places of every airport start, followed by where the last one ends, and likewise for the rest */
+        vector<uint64_t> first_places, first_schedules, first_services, first_tickets, first_luggage, first_car_luggage;
+
+        vector<uint64_t> airport_keys, airport_hashes;
+        /** Services are hashed apart from the rest of their plane, since they are replaced on their own */
+        vector<uint64_t> plane_keys, plane_hashes, service_hashes;
+        vector<uint32_t> flight_planes;
+        vector<uint64_t> flight_keys, flight_hashes;
+        vector<uint64_t> car_hashes;
+
+        /**
+         * @throws std::runtime_error if the snapshot could not be read, is malformed or any part of it is corrupt
+         */
+        explicit ComparedSnapshot(const string &path) : file(path), reader(this->file) {
+            for (SectionTag tag : { SectionTag::STRINGS, SectionTag::AIRPORTS, SectionTag::TRANSPORT_PLACES, SectionTag::SCHEDULES,
+                                    SectionTag::PLANES, SectionTag::SERVICES, SectionTag::FLIGHTS, SectionTag::TICKETS, SectionTag::LUGGAGE,
+                                    SectionTag::HANDLING_CARS, SectionTag::CAR_LUGGAGE, SectionTag::PLANE_BLOCKS }) {
+                if (!this->reader.getSection(tag).verifyAll())
+                    throw runtime_error("Snapshot " + path + " is corrupt");
+            }
+
+            this->hashAirports();
+            this->hashPlanes();
+            this->hashHandlingCars();
+        }
+
+        uint64_t getCount(SectionTag tag) const {
+            return this->reader.getSection(tag).record_count;
+        }
+
+        string_view getString(const StringRef &ref) const {
+            return this->reader.viewString(ref);
+        }
+
+        string_view getAirportName(uint64_t airport) const {
+            return this->getString(this->getRecord<AirportRecord>(SectionTag::AIRPORTS, airport).name);
+        }
+
+        set<TransportPlace> getTransportPlaces(uint64_t airport) const {
+            set<TransportPlace> places;
+            for (uint64_t i = this->first_places[airport]; i < this->first_places[airport + 1]; i++) {
+                TransportPlaceRecord record = this->getRecord<TransportPlaceRecord>(SectionTag::TRANSPORT_PLACES, i);
+
+                TransportPlace place = {
+                    .name = string(this->getString(record.name)),
+                    .latitude = record.latitude,
+                    .longitude = record.longitude,
+                    .transport_type = toTransportType(record.transport_type),
+                    .airport_distance = record.airport_distance,
+                    .schedule = {}
+                };
+
+                for (uint64_t j = this->first_schedules[i]; j < this->first_schedules[i + 1]; j++)
+                    place.schedule.insert(unpack(this->getRecord<PackedTime>(SectionTag::SCHEDULES, j)));
+
+                places.insert(place);
+            }
+
+            return places;
+        }
+
+        PlaneRecord getPlane(uint64_t plane) const {
+            return this->getRecord<PlaneRecord>(SectionTag::PLANES, plane);
+        }
+
+        string_view getLicensePlate(uint64_t plane) const {
+            return this->getString(this->getPlane(plane).license_plate);
+        }
+
+        /**
+         * @brief Returns the services of a plane, finished ones first
+         */
+        vector<journal::ServiceEntry> getServices(uint64_t plane) const {
+            vector<journal::ServiceEntry> services;
+            for (uint64_t i = this->first_services[plane]; i < this->first_services[plane + 1]; i++) {
+                ServiceRecord record = this->getRecord<ServiceRecord>(SectionTag::SERVICES, i);
+                services.push_back({ toServiceType(record.type), unpack(record.datetime), string(this->getString(record.worker)) });
+            }
+
+            return services;
+        }
+
+        FlightRecord getFlight(uint64_t flight) const {
+            return this->getRecord<FlightRecord>(SectionTag::FLIGHTS, flight);
+        }
+
+        TicketRecord getTicket(uint64_t ticket) const {
+            return this->getRecord<TicketRecord>(SectionTag::TICKETS, ticket);
+        }
+
+        /**
+         * @brief Returns the seat of a ticket, given its position among the tickets of its flight
+         */
+        uint32_t getSeatNumber(uint64_t flight, uint32_t ticket) const {
+            if (ticket >= this->first_tickets[flight + 1] - this->first_tickets[flight])
+                throw runtime_error("Snapshot luggage refers to an unknown ticket");
+
+            return this->getTicket(this->first_tickets[flight] + ticket).seat_number;
+        }
+
+        vector<journal::LuggageEntry> getLuggage(uint64_t flight) const {
+            vector<journal::LuggageEntry> luggage;
+            for (uint64_t i = this->first_luggage[flight]; i < this->first_luggage[flight + 1]; i++) {
+                LuggageRecord record = this->getRecord<LuggageRecord>(SectionTag::LUGGAGE, i);
+                luggage.push_back({ this->getSeatNumber(flight, record.ticket), record.weight });
+            }
+
+            return luggage;
+        }
+
+        HandlingCarRecord getCar(uint64_t car) const {
+            return this->getRecord<HandlingCarRecord>(SectionTag::HANDLING_CARS, car);
+        }
+
+        /**
+         * @brief Returns the luggage of a handling car, in the order it is loaded into the car
+         */
+        vector<journal::LuggageEntry> getCarLuggage(uint64_t car) const {
+            uint32_t flight = this->getCar(car).flight;
+
+            vector<journal::LuggageEntry> luggage;
+            for (uint64_t i = this->first_car_luggage[car]; flight != NONE && i < this->first_car_luggage[car + 1]; i++) {
+                LuggageRecord record = this->getRecord<LuggageRecord>(SectionTag::CAR_LUGGAGE, i);
+                luggage.push_back({ this->getSeatNumber(flight, record.ticket), record.weight });
+            }
+
+            return luggage;
+        }
+
+        string describeFlight(uint64_t flight) const {
+            FlightRecord record = this->getFlight(flight);
+            return "flight " + string(this->getString(record.flight_id)) + " at " + unpack(record.departure_time).str();
+        }
+    };
+
+    bool isSameDatetime(const PackedDatetime &a, const PackedDatetime &b) {
+        return a.year == b.year && a.month == b.month && a.day == b.day && a.hour == b.hour && a.minute == b.minute;
+    }
+
+    bool isSameLuggage(const vector<journal::LuggageEntry> &a, const vector<journal::LuggageEntry> &b) {
+        return equal(a.begin(), a.end(), b.begin(), b.end(), [](const journal::LuggageEntry &x, const journal::LuggageEntry &y) {
+            return x.seat_number == y.seat_number && x.weight == y.weight;
+        });
+    }
+
+    /**
+     * @brief What changed about one flight of the new snapshot
+     */
+    struct FlightChanges {
+        journal::Patch patch;
+        ChangeCount flights;
+        ChangeCount tickets;
+        vector<string> examples;
+    };
+
+    /**
+     * @brief Whether a flight of the new snapshot is on another plane than the flight of the old one that has the same key
+     */
+    bool isMovedFlight(const ComparedSnapshot &before, const ComparedSnapshot &after, uint64_t flight, uint32_t match) {
+        return match != NONE && before.getLicensePlate(before.flight_planes[match]) != after.getLicensePlate(after.flight_planes[flight]);
+    }
+
+    /**
+     * @brief Compares a flight of the new snapshot with the flight of the old one that has the same key
+     * @param match The flight of the old snapshot, or NONE if it doesn't have the flight
+     * @param with_examples Whether the changes are described in the examples
+     */
+    void compareFlight(const ComparedSnapshot &before, const ComparedSnapshot &after, uint64_t flight, uint32_t match,
+                       bool with_examples, FlightChanges &changes) {
+        FlightRecord record = after.getFlight(flight);
+        string_view flight_id = after.getString(record.flight_id);
+        Datetime departure_time = unpack(record.departure_time);
+        journal::Patch &patch = changes.patch;
+
+        auto addExample = [&](char change, const string &what) {
+            if (with_examples && changes.examples.size() < MAX_EXAMPLES)
+                changes.examples.push_back(string(1, change) + ' ' + what);
+        };
+
+        auto createFlight = [&]() {
+            patch.createFlight(flight_id, departure_time, unpack(record.duration), after.getAirportName(record.origin),
+                               after.getAirportName(record.destination), after.getLicensePlate(after.flight_planes[flight]));
+
+            for (uint64_t i = after.first_tickets[flight]; i < after.first_tickets[flight + 1]; i++) {
+                TicketRecord ticket = after.getTicket(i);
+                patch.putTicket(flight_id, departure_time, ticket.seat_number, after.getString(ticket.customer_name), ticket.customer_age);
+            }
+
+            if (record.luggage_count != 0)
+                patch.putFlightLuggage(flight_id, departure_time, after.getLuggage(flight));
+        };
+
+        if (match == NONE) {
+            changes.flights.added = 1;
+            changes.tickets.added = record.ticket_count;
+            addExample('+', after.describeFlight(flight));
+            createFlight();
+            return;
+        }
+
+        // A flight can't be moved to another plane, so it is created again on the new one
+        bool is_moved = isMovedFlight(before, after, flight, match);
+        bool is_updated = before.flight_hashes[match] != after.flight_hashes[flight];
+        vector<journal::LuggageEntry> luggage = after.getLuggage(flight);
+        bool is_luggage_changed = !isSameLuggage(before.getLuggage(match), luggage);
+
+        if (is_moved || is_updated || is_luggage_changed) {
+            changes.flights.modified = 1;
+            addExample('~', after.describeFlight(flight));
+        }
+
+        if (is_moved) {
+            patch.deleteFlight(flight_id, departure_time);
+            createFlight();
+        } else {
+            if (is_updated) {
+                patch.updateFlight(flight_id, departure_time, departure_time, unpack(record.duration),
+                                   after.getAirportName(record.origin), after.getAirportName(record.destination));
+            }
+
+            // Luggage refers to tickets, so the old luggage goes before any of them does, and the new luggage comes after every one of them
+            if (is_luggage_changed && before.first_luggage[match] != before.first_luggage[match + 1])
+                patch.putFlightLuggage(flight_id, departure_time, {});
+        }
+
+        // Both flights have their tickets sorted by seat
+        uint64_t old_ticket = before.first_tickets[match], old_end = before.first_tickets[match + 1];
+        uint64_t new_ticket = after.first_tickets[flight], new_end = after.first_tickets[flight + 1];
+
+        while (old_ticket < old_end || new_ticket < new_end) {
+            optional<TicketRecord> old_record, new_record;
+            if (old_ticket < old_end)
+                old_record = before.getTicket(old_ticket);
+            if (new_ticket < new_end)
+                new_record = after.getTicket(new_ticket);
+
+            if (!new_record || (old_record && old_record->seat_number < new_record->seat_number)) {
+                changes.tickets.removed++;
+                addExample('-', "ticket of seat " + to_string(old_record->seat_number) + " on " + after.describeFlight(flight));
+                if (!is_moved)
+                    patch.deleteTicket(flight_id, departure_time, old_record->seat_number);
+
+                old_ticket++;
+                continue;
+            }
+
+            string_view customer_name = after.getString(new_record->customer_name);
+            if (!old_record || new_record->seat_number < old_record->seat_number) {
+                changes.tickets.added++;
+                addExample('+', "ticket of seat " + to_string(new_record->seat_number) + " on " + after.describeFlight(flight));
+                new_ticket++;
+            } else {
+                old_ticket++;
+                new_ticket++;
+
+                if (before.getString(old_record->customer_name) == customer_name && old_record->customer_age == new_record->customer_age)
+                    continue;
+
+                changes.tickets.modified++;
+                addExample('~', "ticket of seat " + to_string(new_record->seat_number) + " on " + after.describeFlight(flight));
+            }
+
+            if (!is_moved)
+                patch.putTicket(flight_id, departure_time, new_record->seat_number, customer_name, new_record->customer_age);
+        }
+
+        if (!is_moved && is_luggage_changed && !luggage.empty())
+            patch.putFlightLuggage(flight_id, departure_time, luggage);
+    }
+
+    /**
+     * @brief Sets the flight of a handling car that was just created or cleared, and loads its luggage
+     */
+    void loadHandlingCar(journal::Patch &patch, const ComparedSnapshot &snapshot, uint32_t car) {
+        HandlingCarRecord record = snapshot.getCar(car);
+        if (record.flight == NONE)
+            return;
+
+        FlightRecord flight = snapshot.getFlight(record.flight);
+        patch.setHandlingCarFlight(car, snapshot.getString(flight.flight_id), unpack(flight.departure_time));
+
+        for (const journal::LuggageEntry &bag : snapshot.getCarLuggage(car))
+            patch.loadLuggage(car, bag.seat_number, bag.weight);
+    }
+
+    void add(ChangeCount &total, const ChangeCount &changes) {
+        total.added += changes.added;
+        total.removed += changes.removed;
+        total.modified += changes.modified;
+    }
+
+    Difference diff(const string &old_path, const string &new_path, const string &patch_path) {
+        ComparedSnapshot before(old_path);
+        ComparedSnapshot after(new_path);
+
+        Difference difference;
+        optional<journal::PatchWriter> writer;
+        if (!patch_path.empty())
+            writer.emplace(patch_path);
+
+        // The patch is written as it is built, and its records are ordered so that every entity exists before it is referred to,
+        // and is only removed once nothing refers to it anymore
+        journal::Patch patch;
+        auto flush = [&](journal::Patch &records) {
+            difference.patch_records += records.getRecordCount();
+            if (writer)
+                writer->append(records);
+        };
+
+        auto addExample = [&difference](char change, const string &what) {
+            if (difference.examples.size() < MAX_EXAMPLES)
+                difference.examples.push_back(string(1, change) + ' ' + what);
+        };
+
+        // Airports
+        auto isSameAirport = [](const ComparedSnapshot &a, const ComparedSnapshot &b) {
+            return [&a, &b](uint32_t i, uint32_t j) { return a.getAirportName(i) == b.getAirportName(j); };
+        };
+
+        // The tables of the new snapshot are only built to check that none of its keys is there twice
+        KeyTable old_airports(before.airport_keys, isSameAirport(before, before));
+        KeyTable new_airports(after.airport_keys, isSameAirport(after, after));
+        vector<bool> is_airport_kept(before.airport_keys.size(), false);
+
+        for (uint32_t i = 0; i < after.airport_keys.size(); i++) {
+            string_view name = after.getAirportName(i);
+            uint32_t match = old_airports.find(after.airport_keys[i], [&](uint32_t j) { return before.getAirportName(j) == name; });
+
+            if (match == NONE) {
+                difference.airports.added++;
+                addExample('+', "airport " + string(name));
+            } else {
+                is_airport_kept[match] = true;
+                if (before.airport_hashes[match] == after.airport_hashes[i])
+                    continue;
+
+                difference.airports.modified++;
+                addExample('~', "airport " + string(name));
+            }
+
+            patch.putAirport(name, after.getTransportPlaces(i));
+        }
+
+        // Planes
+        auto isSamePlane = [](const ComparedSnapshot &a, const ComparedSnapshot &b) {
+            return [&a, &b](uint32_t i, uint32_t j) { return a.getLicensePlate(i) == b.getLicensePlate(j); };
+        };
+
+        KeyTable old_planes(before.plane_keys, isSamePlane(before, before));
+        KeyTable new_planes(after.plane_keys, isSamePlane(after, after));
+        vector<bool> is_plane_kept(before.plane_keys.size(), false);
+        vector<uint32_t> shrunk_planes;
+
+        for (uint32_t i = 0; i < after.plane_keys.size(); i++) {
+            string_view license_plate = after.getLicensePlate(i);
+            uint32_t match = old_planes.find(after.plane_keys[i], [&](uint32_t j) { return before.getLicensePlate(j) == license_plate; });
+
+            bool is_changed = match == NONE || before.plane_hashes[match] != after.plane_hashes[i];
+            bool are_services_changed = match == NONE ? after.first_services[i] != after.first_services[i + 1]
+                                                      : before.service_hashes[match] != after.service_hashes[i];
+
+            if (match == NONE) {
+                difference.planes.added++;
+                addExample('+', "plane " + string(license_plate));
+            } else {
+                is_plane_kept[match] = true;
+                if (is_changed || are_services_changed) {
+                    difference.planes.modified++;
+                    addExample('~', "plane " + string(license_plate));
+                }
+            }
+
+            if (is_changed) {
+                // Tickets of the seats a plane loses are only deleted along with the flights, so its capacity is lowered after them
+                PlaneRecord plane = after.getPlane(i);
+                auto capacity = plane.capacity;
+                if (match != NONE && before.getPlane(match).capacity > capacity) {
+                    capacity = before.getPlane(match).capacity;
+                    shrunk_planes.push_back(i);
+                }
+
+                patch.putPlane(license_plate, after.getString(plane.type), capacity);
+            }
+
+            if (are_services_changed) {
+                vector<journal::ServiceEntry> services = after.getServices(i);
+                auto scheduled = services.begin() + after.getPlane(i).finished_service_count;
+                patch.putServices(license_plate, vector<journal::ServiceEntry>(services.begin(), scheduled),
+                                  vector<journal::ServiceEntry>(scheduled, services.end()));
+            }
+        }
+
+        // Flights, along with their tickets and luggage
+        auto isSameFlight = [](const ComparedSnapshot &a, const ComparedSnapshot &b) {
+            return [&a, &b](uint32_t i, uint32_t j) {
+                FlightRecord x = a.getFlight(i), y = b.getFlight(j);
+                return a.getString(x.flight_id) == b.getString(y.flight_id) && isSameDatetime(x.departure_time, y.departure_time);
+            };
+        };
+
+        uint64_t old_flight_count = before.flight_keys.size(), new_flight_count = after.flight_keys.size();
+        KeyTable old_flights(before.flight_keys, isSameFlight(before, before));
+        KeyTable new_flights(after.flight_keys, isSameFlight(after, after));
+
+        vector<uint32_t> flight_matches(new_flight_count);
+        parallel::forEach(new_flight_count, [&](size_t i) {
+            flight_matches[i] = old_flights.find(after.flight_keys[i], [&](uint32_t j) { return isSameFlight(before, after)(j, i); });
+        });
+
+        vector<bool> is_flight_kept(old_flight_count, false);
+        for (uint32_t match : flight_matches) {
+            if (match != NONE)
+                is_flight_kept[match] = true;
+        }
+
+        for (uint64_t i = 0; i < old_flight_count; i++) {
+            if (is_flight_kept[i])
+                continue;
+
+            FlightRecord flight = before.getFlight(i);
+            difference.flights.removed++;
+            difference.tickets.removed += flight.ticket_count;
+            addExample('-', before.describeFlight(i));
+            patch.deleteFlight(before.getString(flight.flight_id), unpack(flight.departure_time));
+        }
+
+        flush(patch);
+        patch = journal::Patch();
+
+        for (uint64_t first = 0; first < new_flight_count; first += COMPARED_FLIGHT_BATCH) {
+            vector<FlightChanges> batch(min<uint64_t>(COMPARED_FLIGHT_BATCH, new_flight_count - first));
+            bool with_examples = difference.examples.size() < MAX_EXAMPLES;
+
+            parallel::forEach(batch.size(), [&](size_t i) {
+                compareFlight(before, after, first + i, flight_matches[first + i], with_examples, batch[i]);
+            });
+
+            for (FlightChanges &changes : batch) {
+                add(difference.flights, changes.flights);
+                add(difference.tickets, changes.tickets);
+                for (const string &example : changes.examples) {
+                    if (difference.examples.size() < MAX_EXAMPLES)
+                        difference.examples.push_back(example);
+                }
+
+                flush(changes.patch);
+            }
+        }
+
+        for (uint32_t i : shrunk_planes) {
+            PlaneRecord plane = after.getPlane(i);
+            patch.putPlane(after.getLicensePlate(i), after.getString(plane.type), plane.capacity);
+        }
+
+        // Handling cars can't be resized, and new ones always go at the end, so every car from the first one that was resized is created again
+        uint64_t old_car_count = before.car_hashes.size(), new_car_count = after.car_hashes.size();
+        uint64_t common_car_count = min(old_car_count, new_car_count);
+
+        uint64_t first_created_car = common_car_count;
+        for (uint64_t i = 0; i < common_car_count; i++) {
+            HandlingCarRecord old_car = before.getCar(i), new_car = after.getCar(i);
+            if (old_car.number_of_carriages != new_car.number_of_carriages || old_car.stacks_per_carriage != new_car.stacks_per_carriage
+                || old_car.luggage_per_stack != new_car.luggage_per_stack) {
+                first_created_car = i;
+                break;
+            }
+        }
+
+        // A car's hash only covers the key of its flight, but deleting a moved flight to create it again also clears the car
+        for (uint64_t i = 0; i < common_car_count; i++) {
+            if (before.car_hashes[i] == after.car_hashes[i]) {
+                uint32_t flight = after.getCar(i).flight;
+                if (i < first_created_car && flight != NONE && isMovedFlight(before, after, flight, flight_matches[flight])) {
+                    patch.clearHandlingCar(i);
+                    loadHandlingCar(patch, after, i);
+                }
+
+                continue;
+            }
+
+            difference.handling_cars.modified++;
+            addExample('~', "handling car #" + to_string(i + 1));
+
+            if (i < first_created_car) {
+                patch.clearHandlingCar(i);
+                loadHandlingCar(patch, after, i);
+            }
+        }
+
+        difference.handling_cars.removed = old_car_count - common_car_count;
+        difference.handling_cars.added = new_car_count - common_car_count;
+        for (uint64_t i = common_car_count; i < max(old_car_count, new_car_count); i++)
+            addExample(i < old_car_count ? '-' : '+', "handling car #" + to_string(i + 1));
+
+        for (uint64_t i = first_created_car; i < old_car_count; i++)
+            patch.deleteHandlingCar(first_created_car);
+
+        for (uint64_t i = first_created_car; i < new_car_count; i++) {
+            HandlingCarRecord car = after.getCar(i);
+            patch.createHandlingCar(car.number_of_carriages, car.stacks_per_carriage, car.luggage_per_stack);
+            loadHandlingCar(patch, after, i);
+        }
+
+        // Planes that are gone take the flights that weren't moved off them along, and airports go once no flight uses them
+        for (uint64_t i = 0; i < is_plane_kept.size(); i++) {
+            if (is_plane_kept[i])
+                continue;
+
+            difference.planes.removed++;
+            addExample('-', "plane " + string(before.getLicensePlate(i)));
+            patch.deletePlane(before.getLicensePlate(i));
+        }
+
+        for (uint64_t i = 0; i < is_airport_kept.size(); i++) {
+            if (is_airport_kept[i])
+                continue;
+
+            difference.airports.removed++;
+            addExample('-', "airport " + string(before.getAirportName(i)));
+            patch.deleteAirport(before.getAirportName(i));
+        }
+
+        flush(patch);
+        if (writer)
+            writer->finish();
+
+        return difference;
+    }
+}
@@ -24,7 +24,7 @@ unsigned int Ticket::getSeatNumber() const {
     return this->seat_number;
 }
 
-std::string Ticket::getCustomerName() const {
+const std::string &Ticket::getCustomerName() const {
     return this->customer_name;
 }
 